@@ -26,6 +26,16 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define INTERRUPTS_ADC_DEFAULT_INPUT_MODE                                      \
   INTERRUPTS_ADC_UNIPOLAR_MODE // Change the default here.
 
+// Number of photodiodes sampled by isr_function(), 1 to 4. With more than one,
+// sensors_init() makes the XADC sequencer cycle through the first
+// INTERRUPTS_XADC_SENSOR_COUNT channels of INTERRUPTS_XADC_SENSOR_CHANNELS and
+// detector() combines them (see diversity.h). The XADC makes about 960k
+// conversions per second with its 25 MHz clock, so four channels still get
+// over 200k each.
+#ifndef INTERRUPTS_XADC_SENSOR_COUNT
+#define INTERRUPTS_XADC_SENSOR_COUNT 1
+#endif
+
 #ifdef ZYBO_BOARD
 
 #include "xil_types.h"
@@ -49,6 +59,12 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // This line selects some other ADC input channel for the 330 baseboard.
 //#define SELECTED_XADC_CHANNEL XADC_AUX_CHANNEL_15
 
+// The XADC channels of the photodiodes, in sensor order (see
+// INTERRUPTS_XADC_SENSOR_COUNT).
+#define INTERRUPTS_XADC_SENSOR_CHANNELS                                        \
+  {XADC_AUX_CHANNEL_14, XADC_AUX_CHANNEL_15, XADC_AUX_CHANNEL_7,               \
+   XADC_AUX_CHANNEL_6}
+
 // Uses interval timer 0 to measure time spent in ISR.
 #define ENABLE_INTERVAL_TIMER_0_IN_TIMER_ISR 1
 
@@ -0,0 +1,240 @@
+#include "biquad.h"
+#include <complex.h>
+#include <math.h>
+
+#define BIQUAD_MAX_ORDER (2 * BIQUAD_MAX_SECTION_COUNT)
+
+// Clustered roots stop improving once the polynomial evaluation hits rounding
+// noise, so iterate until the step is tiny or the iteration count runs out, then
+// accept the roots if the last step was small enough.
+#define ROOT_MAX_ITERATIONS 200
+#define ROOT_CONVERGED_DELTA 1.0E-13
+#define ROOT_ACCEPTED_DELTA 1.0E-6
+#define ROOT_POLISH_ITERATIONS 3
+#define ROOT_REAL_TOLERANCE 1.0E-9
+#define NUMERATOR_TOLERANCE 1.0E-6
+#define MIN_SECTION_MAGNITUDE 1.0E-12
+
+// Starting point for the Durand-Kerner iteration. Any complex value that is
+// neither real nor a root of unity works.
+#define ROOT_SEED (0.4 + 0.9 * I)
+
+// Evaluates z^n + c[0]z^(n-1) + ... + c[n-1] (Horner's rule).
+static double complex evaluateMonic(const double c[], uint16_t n,
+                                    double complex z) {
+  double complex p = 1.0;
+  for (uint16_t i = 0; i < n; i++) {
+    p = p * z + c[i];
+  }
+  return p;
+}
+
+// Evaluates the derivative of the monic polynomial above.
+static double complex evaluateMonicDerivative(const double c[], uint16_t n,
+                                              double complex z) {
+  double complex p = 1.0;
+  double complex dp = 0.0;
+  for (uint16_t i = 0; i < n; i++) {
+    dp = dp * z + p;
+    p = p * z + c[i];
+  }
+  return dp;
+}
+
+static double magnitude(double complex z) { return hypot(creal(z), cimag(z)); }
+
+// Finds all n roots of the monic polynomial with Durand-Kerner, then polishes
+// each one with a few Newton steps against the original polynomial.
+// Returns false if the iteration does not settle.
+static bool findRoots(const double c[], uint16_t n, double complex roots[]) {
+  double complex seed = 1.0;
+  for (uint16_t k = 0; k < n; k++) {
+    roots[k] = seed;
+    seed *= ROOT_SEED;
+  }
+  double maxDelta = INFINITY;
+  for (uint16_t iteration = 0;
+       iteration < ROOT_MAX_ITERATIONS && maxDelta > ROOT_CONVERGED_DELTA;
+       iteration++) {
+    maxDelta = 0.0;
+    for (uint16_t k = 0; k < n; k++) {
+      double complex denominator = 1.0;
+      for (uint16_t j = 0; j < n; j++) {
+        if (j != k)
+          denominator *= roots[k] - roots[j];
+      }
+      double complex delta = evaluateMonic(c, n, roots[k]) / denominator;
+      roots[k] -= delta;
+      if (magnitude(delta) > maxDelta)
+        maxDelta = magnitude(delta);
+    }
+  }
+  for (uint16_t k = 0; k < n; k++) {
+    for (uint16_t i = 0; i < ROOT_POLISH_ITERATIONS; i++) {
+      double complex slope = evaluateMonicDerivative(c, n, roots[k]);
+      if (magnitude(slope) == 0.0)
+        break;
+      roots[k] -= evaluateMonic(c, n, roots[k]) / slope;
+    }
+  }
+  return maxDelta < ROOT_ACCEPTED_DELTA;
+}
+
+// Divides numerator[0..order] by (1 - z^-2) order/2 times. Returns true if
+// every division leaves no remainder and the quotient that is left is 1,
+// i.e. numerator == numerator[0] * (1 - z^-2)^(order/2).
+static bool isBandpassNumerator(const double numerator[], uint16_t order) {
+  if (numerator[0] == 0.0)
+    return false;
+  double p[BIQUAD_MAX_ORDER + 1];
+  for (uint16_t i = 0; i <= order; i++) {
+    p[i] = numerator[i] / numerator[0];
+  }
+  for (uint16_t length = order + 1; length > 1; length -= 2) {
+    double q[BIQUAD_MAX_ORDER + 1];
+    for (uint16_t i = 0; i < length - 2; i++) {
+      q[i] = p[i] + (i >= 2 ? q[i - 2] : 0.0);
+    }
+    for (uint16_t i = length - 2; i < length; i++) {
+      double remainder = p[i] + (i >= 2 ? q[i - 2] : 0.0);
+      if (fabs(remainder) > NUMERATOR_TOLERANCE)
+        return false;
+    }
+    for (uint16_t i = 0; i < length - 2; i++) {
+      p[i] = q[i];
+    }
+  }
+  return fabs(p[0] - 1.0) < NUMERATOR_TOLERANCE;
+}
+
+// Magnitude of a single section at frequency (radians/sample).
+static double sectionMagnitude(const biquad_section_t *s, double frequency) {
+  double complex z1 = cos(frequency) - I * sin(frequency);
+  double complex z2 = z1 * z1;
+  double complex numerator = s->b[0] + s->b[1] * z1 + s->b[2] * z2;
+  double complex denominator = 1.0 + s->a[0] * z1 + s->a[1] * z2;
+  return magnitude(numerator) / magnitude(denominator);
+}
+
+// Factors the filter with numerator b[0..order] and denominator
+// 1 + a[0]z^-1 + ... + a[order-1]z^-order (the same layout as the
+// coefficient tables in filter.c, without the leading 1) into order/2
+// sections. The numerator must be a gain times (1 - z^-2)^(order/2), which is
+// what every bandpass filter in this project uses. The gain is spread across
+// the sections so each has unity gain at centerFrequency (radians/sample),
+// which keeps the signal between sections close to the input level.
+// Returns false if the filter can't be factored this way.
+bool biquad_design(const double b[], const double a[], uint16_t order,
+                   double centerFrequency, biquad_section_t sections[],
+                   uint16_t *sectionCount) {
+  *sectionCount = 0;
+  if (order == 0 || order % 2 != 0 || order > BIQUAD_MAX_ORDER)
+    return false;
+  if (!isBandpassNumerator(b, order))
+    return false;
+  double complex roots[BIQUAD_MAX_ORDER];
+  if (!findRoots(a, order, roots))
+    return false;
+
+  // Pair each complex root with its conjugate, and real roots with each other.
+  bool used[BIQUAD_MAX_ORDER] = {false};
+  uint16_t count = 0;
+  for (uint16_t k = 0; k < order; k++) {
+    if (used[k])
+      continue;
+    used[k] = true;
+    bool isReal = fabs(cimag(roots[k])) < ROOT_REAL_TOLERANCE;
+    int16_t partner = -1;
+    double bestDistance = INFINITY;
+    for (uint16_t j = 0; j < order; j++) {
+      if (used[j])
+        continue;
+      double distance = isReal ? fabs(cimag(roots[j]))
+                               : magnitude(roots[j] - conj(roots[k]));
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        partner = j;
+      }
+    }
+    if (partner < 0)
+      return false;
+    used[partner] = true;
+    biquad_section_t *s = &sections[count++];
+    s->a[0] = -creal(roots[k] + roots[partner]);
+    s->a[1] = creal(roots[k] * roots[partner]);
+    s->b[0] = 1.0;
+    s->b[1] = 0.0;
+    s->b[2] = -1.0;
+  }
+
+  // Least-resonant sections first so the sharpest poles see the least noise.
+  for (uint16_t i = 1; i < count; i++) {
+    biquad_section_t s = sections[i];
+    int16_t j = i - 1;
+    while (j >= 0 && sections[j].a[1] > s.a[1]) {
+      sections[j + 1] = sections[j];
+      j--;
+    }
+    sections[j + 1] = s;
+  }
+
+  // Unity gain at the center frequency for all but the last section, which
+  // absorbs whatever is left of the overall gain b[0].
+  double appliedGain = 1.0;
+  for (uint16_t i = 0; i < count; i++) {
+    double sectionGain;
+    if (i < count - 1) {
+      double m = sectionMagnitude(&sections[i], centerFrequency);
+      if (m < MIN_SECTION_MAGNITUDE)
+        return false;
+      sectionGain = 1.0 / m;
+      appliedGain *= sectionGain;
+    } else {
+      sectionGain = b[0] / appliedGain;
+    }
+    for (uint16_t j = 0; j < 3; j++) {
+      sections[i].b[j] *= sectionGain;
+    }
+  }
+  *sectionCount = count;
+  return true;
+}
+
+// Returns the magnitude response of the cascade at frequency (radians/sample).
+double biquad_getMagnitudeResponse(const biquad_section_t sections[],
+                                   uint16_t sectionCount, double frequency) {
+  double response = 1.0;
+  for (uint16_t i = 0; i < sectionCount; i++) {
+    response *= sectionMagnitude(&sections[i], frequency);
+  }
+  return response;
+}
+
+// Rounds the designed sections to single precision and zeros their state.
+void biquad_initFloatSections(const biquad_section_t sections[],
+                              uint16_t sectionCount,
+                              biquad_floatSection_t floatSections[]) {
+  for (uint16_t i = 0; i < sectionCount; i++) {
+    for (uint16_t j = 0; j < 3; j++) {
+      floatSections[i].b[j] = (float)sections[i].b[j];
+    }
+    for (uint16_t j = 0; j < 2; j++) {
+      floatSections[i].a[j] = (float)sections[i].a[j];
+      floatSections[i].s[j] = 0.0f;
+    }
+  }
+}
+
+// Runs one input through the cascade and returns the output of the last
+// section. The state in floatSections is updated.
+float biquad_runFloatCascade(biquad_floatSection_t floatSections[],
+                             uint16_t sectionCount, float x) {
+  for (uint16_t i = 0; i < sectionCount; i++) {
+    biquad_floatSection_t *s = &floatSections[i];
+    float y = s->b[0] * x + s->s[0];
+    s->s[0] = s->b[1] * x - s->a[0] * y + s->s[1];
+    s->s[1] = s->b[2] * x - s->a[1] * y;
+    x = y;
+  }
+  return x;
+}
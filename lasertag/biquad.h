@@ -0,0 +1,66 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef BIQUAD_H_
+#define BIQUAD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Factors the direct-form IIR filters used by filter.c into a cascade of
+// second-order sections (biquads), and runs such a cascade in single
+// precision. A 10th-order direct-form filter needs double precision to stay
+// stable; the same filter split into five biquads tolerates single precision
+// and fixed point.
+
+// Largest cascade that biquad_design() will produce.
+#define BIQUAD_MAX_SECTION_COUNT 8
+
+// One second-order section:
+// H(z) = (b[0] + b[1]z^-1 + b[2]z^-2) / (1 + a[0]z^-1 + a[1]z^-2)
+typedef struct {
+  double b[3];
+  double a[2];
+} biquad_section_t;
+
+// One single-precision section in transposed direct form II, with its state.
+// Each section keeps two state values instead of four past inputs/outputs.
+typedef struct {
+  float b[3];
+  float a[2];
+  float s[2];
+} biquad_floatSection_t;
+
+// Factors the filter with numerator b[0..order] and denominator
+// 1 + a[0]z^-1 + ... + a[order-1]z^-order (the same layout as the
+// coefficient tables in filter.c, without the leading 1) into order/2
+// sections. The numerator must be a gain times (1 - z^-2)^(order/2), which is
+// what every bandpass filter in this project uses. The gain is spread across
+// the sections so each has unity gain at centerFrequency (radians/sample),
+// which keeps the signal between sections close to the input level.
+// Returns false if the filter can't be factored this way.
+bool biquad_design(const double b[], const double a[], uint16_t order,
+                   double centerFrequency, biquad_section_t sections[],
+                   uint16_t *sectionCount);
+
+// Returns the magnitude response of the cascade at frequency (radians/sample).
+double biquad_getMagnitudeResponse(const biquad_section_t sections[],
+                                   uint16_t sectionCount, double frequency);
+
+// Rounds the designed sections to single precision and zeros their state.
+void biquad_initFloatSections(const biquad_section_t sections[],
+                              uint16_t sectionCount,
+                              biquad_floatSection_t floatSections[]);
+
+// Runs one input through the cascade and returns the output of the last
+// section. The state in floatSections is updated.
+float biquad_runFloatCascade(biquad_floatSection_t floatSections[],
+                             uint16_t sectionCount, float x);
+
+#endif /* BIQUAD_H_ */
@@ -1,4 +1,6 @@
 #include "buffer.h"
+#include "filter.h"
+#include "typedQueue.h"
  
 // This implements a dedicated circular buffer for storing values
 // from the ADC until they are read and processed by the detector.
@@ -6,63 +8,68 @@
  
 #define BUFFER_SIZE 32768
  
-typedef struct {
-    uint32_t indexIn; // Points to the next open slot.
-    uint32_t indexOut; // Points to the next element to be removed.
-    uint32_t elementCount; // Number of elements in the buffer.
-    buffer_data_t data[BUFFER_SIZE]; // Values are stored here.
-} buffer_t;
+// Type of the stored values. 12-bit ADC values fit in 16 bits, half the size
+// of buffer_data_t; the CIC decimator outputs of FILTER_CIC_IN_ISR need 32.
+#ifdef FILTER_CIC_IN_ISR
+typedef uint32_t buffer_element_t;
+#else
+typedef uint16_t buffer_element_t;
+#endif
  
-volatile static buffer_t buf;
+TYPED_QUEUE_DEFINE(adcQueue, buffer_element_t)
  
+// Buffer 0 holds the only sensor, or sensor 0 of several (see
+// buffer_pushoverSensor()).
+volatile static adcQueue_t bufs[BUFFER_SENSOR_COUNT];
+static buffer_element_t storage[BUFFER_SENSOR_COUNT][QUEUE_STORAGE_SIZE(BUFFER_SIZE)];
  
-// Initialize the buffer to empty.
+ 
+// Initialize the buffers to empty.
 void buffer_init(void)
 {
-	// Always points to the next open slot.
-	buf.indexIn = 0;
-	// Always points to the next element to be removed
-	// from the queue (or "oldest" element).
-	buf.indexOut = 0;
-	// Keep track of the number of elements currently in queue.
-	buf.elementCount = 0;
+	for (uint16_t sensor = 0; sensor < BUFFER_SENSOR_COUNT; sensor++) {
+		adcQueue_init(&bufs[sensor], storage[sensor], BUFFER_SIZE);
+	}
 }
  
 // Add a value to the buffer. Overwrite the oldest value if full.
 void buffer_pushover(buffer_data_t value)
 {
-	if (buffer_elements() >= buffer_size())
-		buffer_pop();
-
-    buf.data[buf.indexIn] = value;
-    buf.indexIn = (buf.indexIn + 1) % buffer_size();
-    buf.elementCount++;
+	buffer_pushoverSensor(0, value);
 }
  
 // Remove a value from the buffer. Return zero if empty.
 buffer_data_t buffer_pop(void)
 {
-    // If buffer is empty, return 0. Else, pop a value and decrement the elementCount
-    if (buf.elementCount == 0) {
-        return 0;
-    } else {
-        buffer_data_t value = buf.data[buf.indexOut];
-
-        buf.indexOut = (buf.indexOut + 1) % buffer_size();
-        buf.elementCount--;
-
-        return value;
-    }
+	return buffer_popSensor(0);
 }
  
 // Return the number of elements in the buffer.
 uint32_t buffer_elements(void)
 {
-    return buf.elementCount;
+	return buffer_sensorElements(0);
+}
+ 
+// Add a value to a sensor's buffer. Overwrite the oldest value if full.
+void buffer_pushoverSensor(uint16_t sensor, buffer_data_t value)
+{
+	adcQueue_overwritePush(&bufs[sensor], (buffer_element_t)value);
+}
+ 
+// Remove a value from a sensor's buffer. Return zero if empty.
+buffer_data_t buffer_popSensor(uint16_t sensor)
+{
+	return adcQueue_pop(&bufs[sensor]);
+}
+ 
+// Return the number of elements in a sensor's buffer.
+uint32_t buffer_sensorElements(uint16_t sensor)
+{
+	return adcQueue_elementCount(&bufs[sensor]);
 }
  
 // Return the capacity of the buffer in elements.
 uint32_t buffer_size(void)
 {
-    return BUFFER_SIZE;
+	return BUFFER_SIZE;
 }
\ No newline at end of file
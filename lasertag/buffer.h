@@ -12,14 +12,25 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include <stdint.h>
 
+#include "interrupts.h"
+
 // This implements a dedicated circular buffer for storing values
 // from the ADC until they are read and processed by the detector.
 // The function of the buffer is similar to a queue or FIFO.
 
-// Type of elements in the buffer.
+// Type of values pushed to and popped from the buffer. The buffer stores them in
+// 16 bits, enough for the 12-bit ADC, unless FILTER_CIC_IN_ISR (filter.h) puts
+// 32-bit CIC decimator outputs in it.
 typedef uint32_t buffer_data_t;
 
-// Initialize the buffer to empty.
+// One buffer per sensor (photodiode) that isr_function() samples. The
+// functions without a sensor argument use the buffer of sensor 0.
+#define BUFFER_SENSOR_COUNT INTERRUPTS_XADC_SENSOR_COUNT
+#if BUFFER_SENSOR_COUNT < 1 || BUFFER_SENSOR_COUNT > 4
+#error "INTERRUPTS_XADC_SENSOR_COUNT must be 1 to 4, one per XADC sensor channel."
+#endif
+
+// Initialize the buffers to empty.
 void buffer_init(void);
 
 // Add a value to the buffer. Overwrite the oldest value if full.
@@ -31,7 +42,13 @@ buffer_data_t buffer_pop(void);
 // Return the number of elements in the buffer.
 uint32_t buffer_elements(void);
 
-// Return the capacity of the buffer in elements.
+// Same as buffer_pushover(), buffer_pop() and buffer_elements(), for the
+// buffer of one sensor.
+void buffer_pushoverSensor(uint16_t sensor, buffer_data_t value);
+buffer_data_t buffer_popSensor(uint16_t sensor);
+uint32_t buffer_sensorElements(uint16_t sensor);
+
+// Return the capacity of each buffer in elements.
 uint32_t buffer_size(void);
 
 #endif /* BUFFER_H_ */
@@ -0,0 +1,139 @@
+#include "cic.h"
+#include <math.h>
+#include <stdio.h>
+
+// Frequencies in the least-squares grid, from DC to the decimated Nyquist.
+#define DESIGN_GRID_COUNT 1000
+// Weight of the grid above the passband, where the compensator only needs to
+// stay small.
+#define STOPBAND_WEIGHT 0.01
+#define MAX_HALF_TAP_COUNT (CIC_MAX_COMPENSATOR_TAP_COUNT / 2 + 1)
+
+// Zeros the decimator for decimationFactor, at mid-scale.
+bool cic_init(cic_t *cic, uint16_t decimationFactor, uint32_t maxInput) {
+  uint64_t largestOutput = maxInput;
+  for (uint16_t k = 0; k < CIC_STAGE_COUNT; k++) {
+    largestOutput *= decimationFactor;
+  }
+  if (decimationFactor == 0 || largestOutput > UINT32_MAX) {
+    printf("cic_init(): decimation by %d overflows 32 bits.\n",
+           decimationFactor);
+    return false;
+  }
+  for (uint16_t k = 0; k < CIC_STAGE_COUNT; k++) {
+    cic->integrators[k] = 0;
+    cic->combDelays[k] = 0;
+  }
+  cic->inputOffset = (maxInput + 1) / 2;
+  cic->outputOffset = cic->inputOffset * cic_getGain(decimationFactor);
+  cic->decimationFactor = decimationFactor;
+  cic->phase = 0;
+  return true;
+}
+
+// Adds one input, and runs the combs every decimationFactor inputs.
+bool cic_addSample(cic_t *cic, uint32_t x, uint32_t *output) {
+  uint32_t v = x - cic->inputOffset; // Wraps below mid-scale.
+  for (uint16_t k = 0; k < CIC_STAGE_COUNT; k++) {
+    cic->integrators[k] += v;
+    v = cic->integrators[k];
+  }
+  if (++cic->phase < cic->decimationFactor)
+    return false;
+  cic->phase = 0;
+  for (uint16_t k = 0; k < CIC_STAGE_COUNT; k++) {
+    uint32_t previous = cic->combDelays[k];
+    cic->combDelays[k] = v;
+    v -= previous;
+  }
+  *output = v + cic->outputOffset;
+  return true;
+}
+
+// Returns the DC gain, decimationFactor^CIC_STAGE_COUNT.
+uint32_t cic_getGain(uint16_t decimationFactor) {
+  uint32_t gain = 1;
+  for (uint16_t k = 0; k < CIC_STAGE_COUNT; k++) {
+    gain *= decimationFactor;
+  }
+  return gain;
+}
+
+// |sin(R w / 2) / (R sin(w / 2))|^CIC_STAGE_COUNT.
+double cic_getMagnitude(uint16_t decimationFactor, double frequency) {
+  double denominator = decimationFactor * sin(frequency / 2.0);
+  if (denominator == 0.0)
+    return 1.0;
+  return pow(fabs(sin(decimationFactor * frequency / 2.0) / denominator),
+             CIC_STAGE_COUNT);
+}
+
+// Solves a[n][n] x = b in place (Gauss-Jordan with partial pivoting), leaving
+// x in b.
+static void solve(double a[][MAX_HALF_TAP_COUNT], double b[], uint16_t n) {
+  for (uint16_t c = 0; c < n; c++) {
+    uint16_t pivot = c;
+    for (uint16_t r = c + 1; r < n; r++) {
+      if (fabs(a[r][c]) > fabs(a[pivot][c]))
+        pivot = r;
+    }
+    for (uint16_t k = 0; k < n; k++) {
+      double t = a[c][k];
+      a[c][k] = a[pivot][k];
+      a[pivot][k] = t;
+    }
+    double t = b[c];
+    b[c] = b[pivot];
+    b[pivot] = t;
+    for (uint16_t r = 0; r < n; r++) {
+      if (r == c)
+        continue;
+      double factor = a[r][c] / a[c][c];
+      for (uint16_t k = 0; k < n; k++) {
+        a[r][k] -= factor * a[c][k];
+      }
+      b[r] -= factor * b[c];
+    }
+  }
+  for (uint16_t c = 0; c < n; c++) {
+    b[c] /= a[c][c];
+  }
+}
+
+// The symmetric response is h[0] + 2 sum h[k] cos(k w), so the normal
+// equations are over the center tap and one side.
+bool cic_designCompensator(double coefficients[], uint16_t tapCount,
+                           uint16_t decimationFactor, double passbandEdge) {
+  if (tapCount % 2 == 0 || tapCount > CIC_MAX_COMPENSATOR_TAP_COUNT)
+    return false;
+  uint16_t halfCount = tapCount / 2 + 1;
+  double a[MAX_HALF_TAP_COUNT][MAX_HALF_TAP_COUNT] = {{0.0}};
+  double b[MAX_HALF_TAP_COUNT] = {0.0};
+  for (uint16_t j = 0; j <= DESIGN_GRID_COUNT; j++) {
+    double w = M_PI * j / DESIGN_GRID_COUNT;
+    bool inPassband = (w <= passbandEdge);
+    double weight = inPassband ? 1.0 : STOPBAND_WEIGHT;
+    double desired =
+        inPassband
+            ? 1.0 / cic_getMagnitude(decimationFactor, w / decimationFactor)
+            : 0.0;
+    double basis[MAX_HALF_TAP_COUNT];
+    basis[0] = 1.0;
+    for (uint16_t k = 1; k < halfCount; k++) {
+      basis[k] = 2.0 * cos(k * w);
+    }
+    for (uint16_t r = 0; r < halfCount; r++) {
+      for (uint16_t c = 0; c < halfCount; c++) {
+        a[r][c] += weight * basis[r] * basis[c];
+      }
+      b[r] += weight * basis[r] * desired;
+    }
+  }
+  solve(a, b, halfCount);
+  uint16_t center = tapCount / 2;
+  for (uint16_t k = 0; k < halfCount; k++) {
+    coefficients[center - k] = b[k];
+    coefficients[center + k] = b[k];
+  }
+  return true;
+}
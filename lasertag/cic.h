@@ -0,0 +1,65 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef CIC_H_
+#define CIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cascaded integrator-comb (CIC) decimator: CIC_STAGE_COUNT integrators run on
+// every raw ADC value and CIC_STAGE_COUNT combs on every decimated output,
+// with integer adds only. Its response droops across the passband, so a short
+// symmetric compensation FIR at the decimated rate flattens it again. With 100
+// kHz sampling and decimation by 10, the pair meets the FIR specs in
+// filterDesign.h: under 0.5 dB loss at every player frequency and at least
+// 50 dB from 8 kHz up.
+// The arithmetic wraps modulo 2^32, which is exact as long as the output fits:
+// the DC gain decimationFactor^CIC_STAGE_COUNT times the largest input must be
+// below 2^32. Inputs are integrated less a mid-scale offset, so a zeroed
+// decimator starts as if it had always seen mid-scale, like a zeroed FIR
+// history, instead of ramping up from 0.
+
+#define CIC_STAGE_COUNT 5
+// Taps in the compensation FIR (odd, so it is symmetric around one tap).
+#define CIC_COMPENSATOR_TAP_COUNT 9
+#define CIC_MAX_COMPENSATOR_TAP_COUNT 15
+
+typedef struct {
+  uint32_t integrators[CIC_STAGE_COUNT];
+  uint32_t combDelays[CIC_STAGE_COUNT]; // Each comb's previous input.
+  uint32_t inputOffset;  // Mid-scale, taken off every input.
+  uint32_t outputOffset; // inputOffset times the DC gain, added back.
+  uint16_t decimationFactor;
+  uint16_t phase; // Inputs since the last output.
+} cic_t;
+
+// Zeros the decimator for decimationFactor, at the mid-scale of inputs from 0
+// to maxInput. Returns false (and prints why) if the output could overflow.
+bool cic_init(cic_t *cic, uint16_t decimationFactor, uint32_t maxInput);
+
+// Adds one input. Every decimationFactor inputs, writes the decimated output
+// to *output and returns true.
+bool cic_addSample(cic_t *cic, uint32_t x, uint32_t *output);
+
+// Returns the DC gain, decimationFactor^CIC_STAGE_COUNT.
+uint32_t cic_getGain(uint16_t decimationFactor);
+
+// Magnitude of the decimator, normalized to unity DC gain, at frequency
+// (radians/sample at the input rate).
+double cic_getMagnitude(uint16_t decimationFactor, double frequency);
+
+// Designs the tapCount-tap symmetric compensation FIR for the decimated rate
+// by least squares: the cascade is flat from DC to passbandEdge (radians/sample
+// at the decimated rate), and the compensator stays small above it. Returns
+// false if tapCount is even or above CIC_MAX_COMPENSATOR_TAP_COUNT.
+bool cic_designCompensator(double coefficients[], uint16_t tapCount,
+                           uint16_t decimationFactor, double passbandEdge);
+
+#endif /* CIC_H_ */
@@ -0,0 +1,32 @@
+#include "cycleCounter.h"
+
+#ifdef ZYBO_BOARD
+#include "xtime_l.h"
+// The global timer ticks once every two CPU cycles.
+#define CPU_CYCLES_PER_TIMER_COUNT 2
+#else
+#include <time.h>
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+#endif
+
+// Returns the current time in CPU cycles (nanoseconds off the board).
+uint64_t cycleCounter_read(void) {
+#ifdef ZYBO_BOARD
+  XTime now;
+  XTime_GetTime(&now);
+  return now * CPU_CYCLES_PER_TIMER_COUNT;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+#endif
+}
+
+// Returns the number of cycleCounter_read() counts in one second.
+uint64_t cycleCounter_getCountsPerSecond(void) {
+#ifdef ZYBO_BOARD
+  return (uint64_t)COUNTS_PER_SECOND * CPU_CYCLES_PER_TIMER_COUNT;
+#else
+  return NANOSECONDS_PER_SECOND;
+#endif
+}
@@ -0,0 +1,25 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef CYCLECOUNTER_H_
+#define CYCLECOUNTER_H_
+
+#include <stdint.h>
+
+// Lightweight timestamps for measuring how long short sections of code take.
+// On the ZYBO board this reads the 64-bit global timer, which runs at half the
+// CPU clock, and reports CPU cycles. Elsewhere it reports nanoseconds.
+
+// Returns the current time in CPU cycles (nanoseconds off the board).
+uint64_t cycleCounter_read(void);
+
+// Returns the number of cycleCounter_read() counts in one second.
+uint64_t cycleCounter_getCountsPerSecond(void);
+
+#endif /* CYCLECOUNTER_H_ */
@@ -1,5 +1,6 @@
 #include "detector.h"
 #include "buffer.h"
+#include "diversity.h"
 #include "interrupts.h"
 #include "filter.h"
 #include "lockoutTimer.h"
@@ -7,10 +8,9 @@
 #include <stdio.h>
 
 #define FUDGE_FACTOR_DEFAULT_INDEX 2
-#define ADC_MAX_VALUE 4095.0
-#define ADC_SCALAR 2.0
 #define MEDIAN_POWER_SCALAR 2
-#define DEFAULT_PLAYER_HIT 2
+#define DETECTOR_BATCH_SIZE 200 // Raw ADC values filtered per filter_processBlock() call.
+#define DETECTOR_TEST_VALUE_COUNT 10 // Channels given values by detector_runTest().
 
 #define FILTER_NUMBER_1 0
 #define FILTER_NUMBER_1_FIRST_VALUE 1050
@@ -50,14 +50,33 @@
 #define FUDGE_FACTOR_3 1000
 
 static uint32_t fudgeFactors[NUM_FUDGE_FACTORS] = {FUDGE_FACTOR_1, FUDGE_FACTOR_2, FUDGE_FACTOR_3};
+
+// The same three sensitivities for detector_detectHitSnr(), which compares the
+// strongest channel's power to its own noise floor rather than to the median
+// of the other channels. Calibrated with the ambients of
+// filterTest_runNoiseFloorTest(): on noise alone the strongest channel reaches
+// about 4 times its floor, and a steady lamp only about 1.1 times. A shot
+// reaches over 100 times its floor on a quiet channel, and about 40 times
+// when a lamp one sixth of its amplitude has raised that channel's floor.
+#define SNR_FACTOR_1 5
+#define SNR_FACTOR_2 10
+#define SNR_FACTOR_3 20
+
+static uint32_t snrFactors[NUM_FUDGE_FACTORS] = {SNR_FACTOR_1, SNR_FACTOR_2, SNR_FACTOR_3};
 static uint8_t fudgeFactorIndex = FUDGE_FACTOR_DEFAULT_INDEX;
 
 static bool detector_hitDetectedFlag = false;
 static bool detector_ignoreAllHitsFlag = false;
 
 static uint32_t invocation_count;
-static uint32_t sample_cnt;
+static buffer_data_t adcBatch[DETECTOR_BATCH_SIZE]; // Raw values drained from the ADC buffer.
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+// Raw values drained from each sensor's ADC buffer, for diversity_processBlock().
+static buffer_data_t sensorBatches[INTERRUPTS_XADC_SENSOR_COUNT][DETECTOR_BATCH_SIZE];
+static const buffer_data_t *sensorBatchPointers[INTERRUPTS_XADC_SENSOR_COUNT];
+#endif
 static uint16_t frequencyNumberOfLastHit;
+static uint16_t frequencyNumberOfValidHit; // Set by isValidHit().
 static uint16_t detector_hitArray[FILTER_FREQUENCY_COUNT];
 static bool ignored_frequencyArray[FILTER_FREQUENCY_COUNT];
 
@@ -81,8 +100,14 @@ void detector_init(void) {
     detector_ignoreAllHitsFlag = false;
 
     invocation_count = 0;
-    sample_cnt = 0;
     frequencyNumberOfLastHit = 0;
+
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+    for (uint16_t sensor = 0; sensor < INTERRUPTS_XADC_SENSOR_COUNT; sensor++) {
+        sensorBatchPointers[sensor] = sensorBatches[sensor];
+    }
+    diversity_init(INTERRUPTS_XADC_SENSOR_COUNT, diversity_maxRatio_e);
+#endif
 }
 
 // freqArray is indexed by frequency number. If an element is set to true,
@@ -124,77 +149,107 @@ bool detector_detectHit(double powerValues[]) {
     return (powerValuesCopy[0] > (medianValue * fudgeFactors[fudgeFactorIndex]));
 }
 
+// Returns the frequency with the highest power, and copies its power and its
+// noise floor to *power and *floor.
+static uint16_t findMaxPowerFrequency(const double powerValues[], double *power, double *floor) {
+    uint16_t best = 0;
+    for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (powerValues[i] > powerValues[best])
+            best = i;
+    }
+    double floors[FILTER_FREQUENCY_COUNT];
+    filter_getNoiseFloors(floors);
+    *power = powerValues[best];
+    *floor = floors[best];
+    return best;
+}
+
+// Returns true if the highest power exceeds its channel's noise floor times the
+// current SNR factor.
+bool detector_detectHitSnr(double powerValues[]) {
+    double power, floor;
+    findMaxPowerFrequency(powerValues, &power, &floor);
+    return power > floor * snrFactors[fudgeFactorIndex];
+}
+
+// Hit test passed to filter_processBlock(): a hit, by signal-to-noise ratio, on
+// a frequency that is not ignored, while hits are not being ignored altogether.
+// The hit goes to the channel with the highest power, as with
+// detector_detectHit(), but that channel is measured against its own floor, so
+// a lamp or sunlight in its band does not cause hits on it. Choosing by the
+// ratio instead would credit a quiet neighbour that a shot leaks into when a
+// lamp has raised the shot channel's floor. Sets frequencyNumberOfValidHit.
+static bool isValidHit(double powerValues[]) {
+    if (detector_ignoreAllHitsFlag)
+        return false;
+    double power, floor;
+    uint16_t player_hit = findMaxPowerFrequency(powerValues, &power, &floor);
+    if (power <= floor * snrFactors[fudgeFactorIndex] || ignored_frequencyArray[player_hit])
+        return false;
+    frequencyNumberOfValidHit = player_hit;
+    return true;
+}
+
 // Runs the entire detector: decimating FIR-filter, IIR-filters,
 // power-computation, hit-detection. If interruptsCurrentlyEnabled = true,
 // interrupts are running. If interruptsCurrentlyEnabled = false you can pop
 // values from the ADC buffer without disabling interrupts. If
 // interruptsCurrentlyEnabled = true, do the following:
 // 1. disable interrupts.
-// 2. pop the value from the ADC buffer.
+// 2. pop a batch of values from the ADC buffer.
 // 3. re-enable interrupts.
+// Each batch goes to filter_processBlock() in one call, which tests each
+// output's power against the noise floors (see detector_detectHitSnr()). With several sensors
+// (INTERRUPTS_XADC_SENSOR_COUNT), a batch is popped from each sensor's buffer
+// and goes to diversity_processBlock() instead. With FILTER_CIC_IN_ISR, the
+// ADC buffer holds CIC decimator outputs, which go to filter_processCicBlock().
 // Ignore hits on frequencies specified with detector_setIgnoredFrequencies().
 // Assumption: draining the ADC buffer occurs faster than it can fill.
 void detector(bool interruptsCurrentlyEnabled) {
     invocation_count++;
-    uint64_t elementCount = buffer_elements();
-
-    // iterate through all new ADC values
-    for (int i = 0; i < elementCount; i++) {
+    uint32_t elementCount = buffer_elements();
 
-        uint32_t rawAdcValue;
+    // Drain the ADC buffer a batch at a time and filter each batch in one pass.
+    while (elementCount > 0) {
+        uint32_t batchCount = (elementCount < DETECTOR_BATCH_SIZE) ? elementCount : DETECTOR_BATCH_SIZE;
         // if interrupts are enabled, we need to temporarily disable them to pop from the buffer
-        if (interruptsCurrentlyEnabled) {
+        if (interruptsCurrentlyEnabled)
             interrupts_disableArmInts();
-            rawAdcValue = buffer_pop();
-            interrupts_enableArmInts();
-        } else {
-            rawAdcValue = buffer_pop();
-        }
-
-        // Scaling the ADC value to a double between -1.0 and 1.0
-        double scaledAdcValue = ((double)rawAdcValue / ADC_MAX_VALUE) * ADC_SCALAR - 1.0;
-
-        filter_addNewInput(scaledAdcValue);
-
-        sample_cnt++; // Count samples since last filter run
- 
-        // Run filters and hit detection if decimation factor reached
-        if (sample_cnt >= FILTER_FIR_DECIMATION_FACTOR) {
-            sample_cnt = 0; // Reset the sample count.
-            filter_firFilter(); // Runs the FIR filter, output goes in the y-queue.
-            // Run all the IIR filters and compute power in each of the output queues.
-            for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
-                filter_iirFilter(filterNumber); // Run each of the IIR filters.
-                // Compute the power for each of the filters, at lowest computational cost.
-                // 1st false means do not compute from scratch.
-                // 2nd false means no debug prints.
-                filter_computePower(filterNumber, false, false);
-            }
-            // can't be hit by other players if we are locked out
-            if (!lockoutTimer_running()) {
-                double powerValues[FILTER_FREQUENCY_COUNT];
-                filter_getCurrentPowerValues(powerValues);
-
-                // determine if this is a valid player hit and record it as such if it is
-                if ((detector_detectHit(powerValues)) && (!detector_ignoreAllHitsFlag)) {
-                    uint8_t player_hit = DEFAULT_PLAYER_HIT;
-                    // find highest power player
-                    for (uint8_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
-                        if (powerValues[i] > powerValues[player_hit])
-                            player_hit = i;
-                    }
-
-                    // if this is a valid player to be hit by, then register the hit
-                    if (!ignored_frequencyArray[player_hit]) {
-                        lockoutTimer_start();
-                        hitLedTimer_start();
-                        detector_hitArray[player_hit]++;
-                        detector_hitDetectedFlag = true;
-                        frequencyNumberOfLastHit = player_hit;
-                    }
-                }
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+        for (uint16_t sensor = 0; sensor < INTERRUPTS_XADC_SENSOR_COUNT; sensor++) {
+            for (uint32_t i = 0; i < batchCount; i++) {
+                sensorBatches[sensor][i] = buffer_popSensor(sensor);
             }
         }
+#else
+        for (uint32_t i = 0; i < batchCount; i++) {
+            adcBatch[i] = buffer_pop();
+        }
+#endif
+        if (interruptsCurrentlyEnabled)
+            interrupts_enableArmInts();
+        elementCount -= batchCount;
+
+        // can't be hit by other players if we are locked out
+        filter_blockResult_t result;
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+        diversity_processBlock(sensorBatchPointers, batchCount, lockoutTimer_running() ? NULL : isValidHit,
+                               &result);
+#elif defined(FILTER_CIC_IN_ISR)
+        filter_processCicBlock(adcBatch, batchCount, lockoutTimer_running() ? NULL : isValidHit,
+                               &result);
+#else
+        filter_processBlock(adcBatch, batchCount, lockoutTimer_running() ? NULL : isValidHit, &result);
+#endif
+
+        // register the first valid hit in the batch; the lockout covers the rest
+        if (result.thresholdCrossed) {
+            lockoutTimer_start();
+            hitLedTimer_start();
+            detector_hitArray[frequencyNumberOfValidHit]++;
+            detector_hitDetectedFlag = true;
+            frequencyNumberOfLastHit = frequencyNumberOfValidHit;
+        }
     }
 }
 
@@ -246,21 +301,30 @@ uint32_t detector_getInvocationCount(void) {
 ******************** Test Routines ********************
 ******************************************************/
 
+// The test values cover ten channels. With fewer channels the extra values
+// are dropped; with more, the ten values repeat, so the median (and the
+// outcome) does not depend on FILTER_FREQUENCY_COUNT.
+static void setTestPowerValue(uint16_t filterNumber, double value) {
+    for (uint16_t i = filterNumber; i < FILTER_FREQUENCY_COUNT; i += DETECTOR_TEST_VALUE_COUNT) {
+        filter_setCurrentPowerValue(i, value);
+    }
+}
+
 // Students implement this as part of Milestone 3, Task 3.
 // Create two sets of power values and call your hit detection algorithm
 // on each set. With the same fudge factor, your hit detect algorithm
 // should detect a hit on the first set and not detect a hit on the second.
 void detector_runTest(void) {
-    filter_setCurrentPowerValue(FILTER_NUMBER_1, FILTER_NUMBER_1_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_2, FILTER_NUMBER_2_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_3, FILTER_NUMBER_3_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_4, FILTER_NUMBER_4_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_5, FILTER_NUMBER_5_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_6, FILTER_NUMBER_6_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_7, FILTER_NUMBER_7_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_8, FILTER_NUMBER_8_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_9, FILTER_NUMBER_9_FIRST_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_10, FILTER_NUMBER_10_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_1, FILTER_NUMBER_1_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_2, FILTER_NUMBER_2_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_3, FILTER_NUMBER_3_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_4, FILTER_NUMBER_4_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_5, FILTER_NUMBER_5_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_6, FILTER_NUMBER_6_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_7, FILTER_NUMBER_7_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_8, FILTER_NUMBER_8_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_9, FILTER_NUMBER_9_FIRST_VALUE);
+    setTestPowerValue(FILTER_NUMBER_10, FILTER_NUMBER_10_FIRST_VALUE);
 
     detector_setFudgeFactorIndex(0);
 
@@ -270,16 +334,16 @@ void detector_runTest(void) {
 
     printf("hit detected 1: %d\n", hitDetected ? 1 : 0);
 
-    filter_setCurrentPowerValue(FILTER_NUMBER_1, FILTER_NUMBER_1_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_2, FILTER_NUMBER_2_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_3, FILTER_NUMBER_3_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_4, FILTER_NUMBER_4_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_5, FILTER_NUMBER_5_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_6, FILTER_NUMBER_6_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_7, FILTER_NUMBER_7_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_8, FILTER_NUMBER_8_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_9, FILTER_NUMBER_9_SECOND_VALUE);
-    filter_setCurrentPowerValue(FILTER_NUMBER_10, FILTER_NUMBER_10_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_1, FILTER_NUMBER_1_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_2, FILTER_NUMBER_2_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_3, FILTER_NUMBER_3_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_4, FILTER_NUMBER_4_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_5, FILTER_NUMBER_5_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_6, FILTER_NUMBER_6_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_7, FILTER_NUMBER_7_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_8, FILTER_NUMBER_8_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_9, FILTER_NUMBER_9_SECOND_VALUE);
+    setTestPowerValue(FILTER_NUMBER_10, FILTER_NUMBER_10_SECOND_VALUE);
 
     filter_getCurrentPowerValues(powerValues);
     hitDetected = detector_detectHit(powerValues);
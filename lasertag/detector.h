@@ -38,6 +38,17 @@ void detector_setIgnoredFrequencies(bool freqArray[]);
 // Assumption: draining the ADC buffer occurs faster than it can fill.
 void detector(bool interruptsCurrentlyEnabled);
 
+// Returns true if the largest of the FILTER_FREQUENCY_COUNT power values
+// exceeds the median power value times the current fudge factor.
+bool detector_detectHit(double powerValues[]);
+
+// Returns true if the highest of the power values exceeds the noise floor of
+// its channel (see filter_getNoiseFloors()) times the SNR factor that goes
+// with the current fudge-factor index. detector() detects hits this way.
+// Unlike detector_detectHit(), it needs no sort and adapts to the ambient
+// light in each channel.
+bool detector_detectHitSnr(double powerValues[]);
+
 // Returns true if a hit was detected.
 bool detector_hitDetected(void);
 
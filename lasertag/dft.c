@@ -0,0 +1,333 @@
+#include "dft.h"
+#include <math.h>
+
+// Power is scaled so a sinusoid of amplitude A over L samples reads L*A^2/2,
+// the same as a sum of squares over the output of a unity-gain bandpass
+// filter. A DFT term of that sinusoid has magnitude L*A/2.
+#define POWER_SCALE(length) (2.0 / (length))
+
+static uint16_t frequencyCount;
+
+/******************************************************************************
+***** Goertzel
+******************************************************************************/
+
+static double goertzelCoefficient[DFT_MAX_FREQUENCY_COUNT]; // 2cos(w).
+static double goertzelS1[DFT_MAX_FREQUENCY_COUNT];          // s[n-1].
+static double goertzelS2[DFT_MAX_FREQUENCY_COUNT];          // s[n-2].
+// Power of each of the last blockCount blocks, and their sum.
+static double goertzelBlockPower[DFT_MAX_GOERTZEL_BLOCK_COUNT]
+                                [DFT_MAX_FREQUENCY_COUNT];
+static double goertzelPower[DFT_MAX_FREQUENCY_COUNT];
+static uint16_t goertzelBlockLength;
+static uint16_t goertzelBlockCount;
+static uint16_t goertzelSampleIndex; // Samples so far in the current block.
+static uint16_t goertzelBlockIndex;  // Slot the current block will fill.
+
+// Sets up the Goertzel recurrence for frequencies[] (radians/sample). Power is
+// summed over the last blockCount blocks of blockLength samples, so it changes
+// once per block. Returns false if the counts are out of range.
+bool dft_initGoertzel(const double frequencies[], uint16_t count,
+                      uint16_t blockLength, uint16_t blockCount) {
+  if (count > DFT_MAX_FREQUENCY_COUNT || blockLength == 0 || blockCount == 0 ||
+      blockCount > DFT_MAX_GOERTZEL_BLOCK_COUNT)
+    return false;
+  frequencyCount = count;
+  goertzelBlockLength = blockLength;
+  goertzelBlockCount = blockCount;
+  goertzelSampleIndex = 0;
+  goertzelBlockIndex = 0;
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    goertzelCoefficient[k] = 2.0 * cos(frequencies[k]);
+    goertzelS1[k] = 0.0;
+    goertzelS2[k] = 0.0;
+    goertzelPower[k] = 0.0;
+    for (uint16_t b = 0; b < blockCount; b++) {
+      goertzelBlockPower[b][k] = 0.0;
+    }
+  }
+  return true;
+}
+
+// Adds one sample to every Goertzel resonator.
+void dft_goertzelAddSample(double x) {
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    double s = x + goertzelCoefficient[k] * goertzelS1[k] - goertzelS2[k];
+    goertzelS2[k] = goertzelS1[k];
+    goertzelS1[k] = s;
+  }
+  if (++goertzelSampleIndex < goertzelBlockLength)
+    return;
+
+  // End of a block: replace the oldest block's power and restart.
+  goertzelSampleIndex = 0;
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    double s1 = goertzelS1[k];
+    double s2 = goertzelS2[k];
+    double magnitudeSquared =
+        s1 * s1 + s2 * s2 - goertzelCoefficient[k] * s1 * s2;
+    goertzelBlockPower[goertzelBlockIndex][k] =
+        magnitudeSquared * POWER_SCALE(goertzelBlockLength);
+    goertzelS1[k] = 0.0;
+    goertzelS2[k] = 0.0;
+    // Resum rather than add and subtract so rounding never accumulates.
+    double power = 0.0;
+    for (uint16_t b = 0; b < goertzelBlockCount; b++) {
+      power += goertzelBlockPower[b][k];
+    }
+    goertzelPower[k] = power;
+  }
+  goertzelBlockIndex =
+      (goertzelBlockIndex + 1 == goertzelBlockCount) ? 0 : goertzelBlockIndex + 1;
+}
+
+// Returns the Goertzel power for a frequency over the last complete blocks.
+double dft_getGoertzelPower(uint16_t frequencyNumber) {
+  return goertzelPower[frequencyNumber];
+}
+
+/******************************************************************************
+***** Sliding DFT
+******************************************************************************/
+
+// X[n] = x[n] + e^(-jw) X[n-1] - e^(-jwL) x[n-L]
+static double slidingRe[DFT_MAX_FREQUENCY_COUNT];
+static double slidingIm[DFT_MAX_FREQUENCY_COUNT];
+static double rotateRe[DFT_MAX_FREQUENCY_COUNT]; // e^(-jw)
+static double rotateIm[DFT_MAX_FREQUENCY_COUNT];
+static double evictRe[DFT_MAX_FREQUENCY_COUNT]; // e^(-jwL)
+static double evictIm[DFT_MAX_FREQUENCY_COUNT];
+static double window[DFT_MAX_WINDOW_LENGTH]; // Shared by all frequencies.
+static uint16_t windowLength;
+static uint16_t windowIndex; // Oldest sample, overwritten next.
+
+// Sets up the sliding DFT for frequencies[] (radians/sample) over a window of
+// windowLength samples. Returns false if the counts are out of range.
+bool dft_initSliding(const double frequencies[], uint16_t count,
+                     uint16_t length) {
+  if (count > DFT_MAX_FREQUENCY_COUNT || length == 0 ||
+      length > DFT_MAX_WINDOW_LENGTH)
+    return false;
+  frequencyCount = count;
+  windowLength = length;
+  windowIndex = 0;
+  for (uint16_t i = 0; i < windowLength; i++) {
+    window[i] = 0.0;
+  }
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    rotateRe[k] = cos(frequencies[k]);
+    rotateIm[k] = -sin(frequencies[k]);
+    evictRe[k] = cos(frequencies[k] * windowLength);
+    evictIm[k] = -sin(frequencies[k] * windowLength);
+    slidingRe[k] = 0.0;
+    slidingIm[k] = 0.0;
+  }
+  return true;
+}
+
+// Adds one sample to the sliding DFT window and updates every DFT term.
+void dft_slidingAddSample(double x) {
+  double oldest = window[windowIndex];
+  window[windowIndex] = x;
+  windowIndex = (windowIndex + 1 == windowLength) ? 0 : windowIndex + 1;
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    double re = slidingRe[k];
+    double im = slidingIm[k];
+    slidingRe[k] =
+        x + rotateRe[k] * re - rotateIm[k] * im - evictRe[k] * oldest;
+    slidingIm[k] = rotateRe[k] * im + rotateIm[k] * re - evictIm[k] * oldest;
+  }
+}
+
+// Returns the sliding-DFT power for a frequency over the current window.
+double dft_getSlidingPower(uint16_t frequencyNumber) {
+  double re = slidingRe[frequencyNumber];
+  double im = slidingIm[frequencyNumber];
+  return (re * re + im * im) * POWER_SCALE(windowLength);
+}
+
+/******************************************************************************
+***** FFT channelizer
+******************************************************************************/
+
+// Bins are at most this fraction of the closest frequency spacing apart. With
+// the player frequencies that gives bins of about 20 Hz, so the summed bins
+// and the Hann main lobe reach about as far as a 50 Hz IIR passband. Four bins
+// per spacing gave 39 Hz bins, and tones aliased about 100 Hz from a frequency
+// still leaked into its bins.
+#define CHANNELIZER_BINS_PER_SPACING 16
+// A frequency's power is summed over its nearest bin and this many bins on
+// either side. With a Hann window that sum is within 0.1 dB of the tone's
+// full energy wherever the frequency falls between bins.
+#define CHANNELIZER_BIN_SPREAD 1
+// Sum of the squares of a periodic Hann window of length N is 3N/8.
+#define HANN_SQUARED_SUM(length) (3.0 * (length) / 8.0)
+
+static double channelizerHistory[DFT_MAX_CHANNELIZER_FFT_LENGTH]; // Circular.
+static double channelizerWindow[DFT_MAX_CHANNELIZER_FFT_LENGTH];
+static double fftRe[DFT_MAX_CHANNELIZER_FFT_LENGTH];
+static double fftIm[DFT_MAX_CHANNELIZER_FFT_LENGTH];
+static double twiddleRe[DFT_MAX_CHANNELIZER_FFT_LENGTH / 2]; // e^(-j2pi k/N)
+static double twiddleIm[DFT_MAX_CHANNELIZER_FFT_LENGTH / 2];
+static uint16_t bitReversed[DFT_MAX_CHANNELIZER_FFT_LENGTH];
+static uint16_t channelizerBin[DFT_MAX_FREQUENCY_COUNT]; // Nearest bin.
+static double channelizerBlockPower[DFT_MAX_GOERTZEL_BLOCK_COUNT]
+                                   [DFT_MAX_FREQUENCY_COUNT];
+static double channelizerPower[DFT_MAX_FREQUENCY_COUNT];
+static double channelizerScale; // Bin power to block power.
+static uint16_t fftLength;
+static uint16_t channelizerBlockLength;
+static uint16_t channelizerBlockCount;
+static uint16_t channelizerSampleIndex; // Samples so far in the current block.
+static uint16_t channelizerBlockIndex;  // Slot the current block will fill.
+static uint16_t historyIndex;           // Oldest sample, overwritten next.
+
+// Returns the smallest power of two that is at least n.
+static uint32_t nextPowerOfTwo(double n) {
+  uint32_t length = 1;
+  while (length < n)
+    length <<= 1;
+  return length;
+}
+
+// Fills the window, twiddle and bit-reversal tables for an FFT of fftLength.
+static void initFftTables() {
+  uint16_t bitCount = 0;
+  while ((1 << bitCount) < fftLength)
+    bitCount++;
+  for (uint16_t n = 0; n < fftLength; n++) {
+    channelizerWindow[n] = 0.5 - 0.5 * cos(2.0 * M_PI * n / fftLength);
+    uint16_t reversed = 0;
+    for (uint16_t b = 0; b < bitCount; b++) {
+      if (n & (1 << b))
+        reversed |= 1 << (bitCount - 1 - b);
+    }
+    bitReversed[n] = reversed;
+  }
+  for (uint16_t k = 0; k < fftLength / 2; k++) {
+    twiddleRe[k] = cos(2.0 * M_PI * k / fftLength);
+    twiddleIm[k] = -sin(2.0 * M_PI * k / fftLength);
+  }
+}
+
+// In-place radix-2 FFT of fftRe/fftIm, which must be in bit-reversed order.
+static void runFft() {
+  for (uint16_t span = 1; span < fftLength; span <<= 1) {
+    uint16_t twiddleStep = fftLength / (2 * span);
+    for (uint16_t start = 0; start < fftLength; start += 2 * span) {
+      for (uint16_t k = 0; k < span; k++) {
+        double wRe = twiddleRe[k * twiddleStep];
+        double wIm = twiddleIm[k * twiddleStep];
+        uint16_t top = start + k;
+        uint16_t bottom = top + span;
+        double re = wRe * fftRe[bottom] - wIm * fftIm[bottom];
+        double im = wRe * fftIm[bottom] + wIm * fftRe[bottom];
+        fftRe[bottom] = fftRe[top] - re;
+        fftIm[bottom] = fftIm[top] - im;
+        fftRe[top] += re;
+        fftIm[top] += im;
+      }
+    }
+  }
+}
+
+// Sets up the FFT channelizer for frequencies[] (radians/sample). Every
+// blockLength samples one FFT runs over the most recent samples, and power is
+// summed over the last blockCount blocks. Returns false if the counts are out
+// of range or the frequencies are too close together.
+bool dft_initChannelizer(const double frequencies[], uint16_t count,
+                         uint16_t blockLength, uint16_t blockCount) {
+  if (count == 0 || count > DFT_MAX_FREQUENCY_COUNT || blockLength == 0 ||
+      blockCount == 0 || blockCount > DFT_MAX_GOERTZEL_BLOCK_COUNT)
+    return false;
+  double closestSpacing = 2.0 * M_PI;
+  for (uint16_t i = 0; i < count; i++) {
+    for (uint16_t j = i + 1; j < count; j++) {
+      closestSpacing =
+          fmin(closestSpacing, fabs(frequencies[i] - frequencies[j]));
+    }
+  }
+  if (closestSpacing == 0.0)
+    return false;
+  uint32_t length = nextPowerOfTwo(fmax(
+      blockLength, CHANNELIZER_BINS_PER_SPACING * 2.0 * M_PI / closestSpacing));
+  if (length > DFT_MAX_CHANNELIZER_FFT_LENGTH)
+    return false;
+  // Check every bin before changing anything, so a failed call leaves the
+  // channelizer as it was.
+  long bins[DFT_MAX_FREQUENCY_COUNT];
+  for (uint16_t k = 0; k < count; k++) {
+    bins[k] = lround(frequencies[k] * length / (2.0 * M_PI));
+    if (bins[k] < CHANNELIZER_BIN_SPREAD ||
+        bins[k] + CHANNELIZER_BIN_SPREAD >= (long)(length / 2))
+      return false;
+  }
+  fftLength = length;
+  initFftTables();
+  for (uint16_t k = 0; k < count; k++) {
+    channelizerBin[k] = bins[k];
+  }
+  frequencyCount = count;
+  channelizerBlockLength = blockLength;
+  channelizerBlockCount = blockCount;
+  // A tone of amplitude A puts (A^2 / 2) * fftLength * HANN_SQUARED_SUM into
+  // its bins; each block stands for blockLength samples of A^2 / 2.
+  channelizerScale = blockLength / (fftLength * HANN_SQUARED_SUM(fftLength));
+  channelizerSampleIndex = 0;
+  channelizerBlockIndex = 0;
+  historyIndex = 0;
+  for (uint16_t n = 0; n < fftLength; n++) {
+    channelizerHistory[n] = 0.0;
+  }
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    channelizerPower[k] = 0.0;
+    for (uint16_t b = 0; b < blockCount; b++) {
+      channelizerBlockPower[b][k] = 0.0;
+    }
+  }
+  return true;
+}
+
+// Adds one sample to the channelizer, running the FFT at the end of a block.
+void dft_channelizerAddSample(double x) {
+  channelizerHistory[historyIndex] = x;
+  historyIndex = (historyIndex + 1) & (fftLength - 1);
+  if (++channelizerSampleIndex < channelizerBlockLength)
+    return;
+
+  // End of a block: transform the newest fftLength samples (oldest first).
+  channelizerSampleIndex = 0;
+  for (uint16_t n = 0; n < fftLength; n++) {
+    uint16_t slot = bitReversed[n];
+    fftRe[slot] = channelizerHistory[(historyIndex + n) & (fftLength - 1)] *
+                  channelizerWindow[n];
+    fftIm[slot] = 0.0;
+  }
+  runFft();
+  for (uint16_t k = 0; k < frequencyCount; k++) {
+    double binPower = 0.0;
+    for (uint16_t bin = channelizerBin[k] - CHANNELIZER_BIN_SPREAD;
+         bin <= channelizerBin[k] + CHANNELIZER_BIN_SPREAD; bin++) {
+      binPower += fftRe[bin] * fftRe[bin] + fftIm[bin] * fftIm[bin];
+    }
+    channelizerBlockPower[channelizerBlockIndex][k] =
+        binPower * channelizerScale;
+    // Resum rather than add and subtract so rounding never accumulates.
+    double power = 0.0;
+    for (uint16_t b = 0; b < channelizerBlockCount; b++) {
+      power += channelizerBlockPower[b][k];
+    }
+    channelizerPower[k] = power;
+  }
+  channelizerBlockIndex = (channelizerBlockIndex + 1 == channelizerBlockCount)
+                              ? 0
+                              : channelizerBlockIndex + 1;
+}
+
+// Returns the channelizer power for a frequency over the last complete blocks.
+double dft_getChannelizerPower(uint16_t frequencyNumber) {
+  return channelizerPower[frequencyNumber];
+}
+
+// Returns the FFT length chosen by the last dft_initChannelizer().
+uint16_t dft_getChannelizerFftLength() { return fftLength; }
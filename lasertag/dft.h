@@ -0,0 +1,84 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef DFT_H_
+#define DFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Measures the power of a stream at a handful of fixed frequencies, as a
+// cheaper alternative to a bank of bandpass filters followed by a
+// sum-of-squares over their outputs. Three methods are provided:
+// 1. Goertzel: runs one second-order resonator per frequency over short
+// blocks and sums the power of the most recent blocks.
+// 2. Sliding DFT: updates one DFT term per frequency on every sample over a
+// window of the most recent samples.
+// 3. FFT channelizer: once per block, runs one Hann-windowed FFT over the most
+// recent samples and reads every frequency from the bins around it. The FFT
+// grows with the number of frequencies (its bins must resolve the closest
+// pair), so the cost is O(N log N) per block instead of O(N) filters per
+// sample.
+// All report power in the same units as summing the squares of the output of
+// a unity-gain bandpass filter over the window: a sinusoid of amplitude A at
+// one of the frequencies gives about windowLength * A^2 / 2.
+
+// Most frequencies either recurrence can track.
+#define DFT_MAX_FREQUENCY_COUNT 32
+// Longest window, in samples, the sliding DFT can use.
+#define DFT_MAX_WINDOW_LENGTH 2000
+// Most blocks the Goertzel recurrence or the channelizer can sum over.
+#define DFT_MAX_GOERTZEL_BLOCK_COUNT 20
+// Longest FFT the channelizer can use (a power of two).
+#define DFT_MAX_CHANNELIZER_FFT_LENGTH 2048
+
+// Sets up the Goertzel recurrence for frequencies[] (radians/sample). Power is
+// summed over the last blockCount blocks of blockLength samples, so it changes
+// once per block. Returns false if the counts are out of range.
+bool dft_initGoertzel(const double frequencies[], uint16_t frequencyCount,
+                      uint16_t blockLength, uint16_t blockCount);
+
+// Adds one sample to every Goertzel resonator.
+void dft_goertzelAddSample(double x);
+
+// Returns the Goertzel power for a frequency over the last complete blocks.
+double dft_getGoertzelPower(uint16_t frequencyNumber);
+
+// Sets up the sliding DFT for frequencies[] (radians/sample) over a window of
+// windowLength samples. Returns false if the counts are out of range.
+bool dft_initSliding(const double frequencies[], uint16_t frequencyCount,
+                     uint16_t windowLength);
+
+// Adds one sample to the sliding DFT window and updates every DFT term.
+void dft_slidingAddSample(double x);
+
+// Returns the sliding-DFT power for a frequency over the current window.
+double dft_getSlidingPower(uint16_t frequencyNumber);
+
+// Sets up the FFT channelizer for frequencies[] (radians/sample). Every
+// blockLength samples one FFT runs over the most recent samples, and power is
+// summed over the last blockCount blocks, like the Goertzel recurrence. The
+// FFT is the shortest power of two, at least blockLength long, whose bins are
+// at most a sixteenth of the closest frequency spacing apart. Returns false,
+// and leaves the channelizer unchanged, if the counts are out of range, the
+// frequencies are too close for DFT_MAX_CHANNELIZER_FFT_LENGTH or one is too
+// near 0 or the Nyquist frequency for its bins.
+bool dft_initChannelizer(const double frequencies[], uint16_t frequencyCount,
+                         uint16_t blockLength, uint16_t blockCount);
+
+// Adds one sample to the channelizer, running the FFT at the end of a block.
+void dft_channelizerAddSample(double x);
+
+// Returns the channelizer power for a frequency over the last complete blocks.
+double dft_getChannelizerPower(uint16_t frequencyNumber);
+
+// Returns the FFT length chosen by the last dft_initChannelizer().
+uint16_t dft_getChannelizerFftLength();
+
+#endif /* DFT_H_ */
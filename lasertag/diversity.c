@@ -0,0 +1,247 @@
+#include "diversity.h"
+#include <math.h>
+#include <stdio.h>
+
+#define FIR_TAP_COUNT FILTER_FIR_COEFFICIENT_COUNT
+#define FIR_CENTER_TAP ((FIR_TAP_COUNT - 1) / 2)
+// Time constants, in FIR outputs, of the per-sensor estimates. DC and energy
+// match the energy gate in filter.c. The floor follows much more slowly, so a
+// weak shot (FILTER_INPUT_PULSE_WIDTH outputs) barely raises it.
+#define DC_TIME_CONSTANT 64
+#define ENERGY_TIME_CONSTANT 32
+#define FLOOR_TIME_CONSTANT 2048
+// Outputs for which the floor equals the energy, until the energy settles.
+#define LEARN_COUNT (8 * ENERGY_TIME_CONSTANT)
+// The floor holds while the energy is this far above it (a strong shot).
+#define FLOOR_HOLD_RATIO 4.0
+// Lowest floor, below the ADC quantization noise.
+#define MIN_FLOOR 1.0E-12
+// Combined outputs passed to filter_processFirOutputs() at a time.
+#define OUTPUT_BATCH_SIZE 32
+
+static uint16_t sensorCount = 1;
+static diversity_combiner_t combiner = diversity_maxRatio_e;
+
+// Scaled inputs of every sensor, one row per sample time, so each FIR
+// coefficient is loaded once for all sensors. Each row is written twice,
+// FIR_TAP_COUNT rows apart, so the newest FIR_TAP_COUNT rows are always
+// contiguous. Columns past sensorCount stay zero.
+static double firHistory[2 * FIR_TAP_COUNT][DIVERSITY_MAX_SENSOR_COUNT];
+static uint32_t firNextRow; // Row the next sample goes to.
+static uint32_t firPhase;   // Samples since the last FIR output.
+
+static double sensorDc[DIVERSITY_MAX_SENSOR_COUNT];
+static double sensorEnergy[DIVERSITY_MAX_SENSOR_COUNT];
+static double sensorFloor[DIVERSITY_MAX_SENSOR_COUNT];
+static uint32_t learnCount;
+static double weights[DIVERSITY_MAX_SENSOR_COUNT];
+static uint16_t selectedSensor;
+
+// Sets up sensorCount sensors, from zeroed FIR histories, and the combiner.
+bool diversity_init(uint16_t count, diversity_combiner_t newCombiner) {
+#ifdef FILTER_REDUCED_PRECISION
+  printf("diversity_init(): not available with FILTER_REDUCED_PRECISION.\n");
+  return false;
+#endif
+  if (count == 0 || count > DIVERSITY_MAX_SENSOR_COUNT) {
+    printf("diversity_init(): %d sensors, must be 1 to %d.\n", count,
+           DIVERSITY_MAX_SENSOR_COUNT);
+    return false;
+  }
+  sensorCount = count;
+  combiner = newCombiner;
+  for (uint32_t row = 0; row < 2 * FIR_TAP_COUNT; row++) {
+    for (uint16_t s = 0; s < DIVERSITY_MAX_SENSOR_COUNT; s++) {
+      firHistory[row][s] = 0.0;
+    }
+  }
+  firNextRow = 0;
+  firPhase = 0;
+  for (uint16_t s = 0; s < DIVERSITY_MAX_SENSOR_COUNT; s++) {
+    sensorDc[s] = 0.0;
+    sensorEnergy[s] = 0.0;
+    sensorFloor[s] = MIN_FLOOR;
+    weights[s] = (s < sensorCount) ? 1.0 / sensorCount : 0.0;
+  }
+  learnCount = 0;
+  selectedSensor = 0;
+  return true;
+}
+
+// Scales sample i of every sensor into the next history row.
+static void addInputs(const buffer_data_t *samples[], uint32_t i) {
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    double x = filter_scaleAdcValue(samples[s][i]);
+    firHistory[firNextRow][s] = x;
+    firHistory[firNextRow + FIR_TAP_COUNT][s] = x;
+  }
+  firNextRow = (firNextRow + 1 == FIR_TAP_COUNT) ? 0 : firNextRow + 1;
+}
+
+// Runs the FIR filter of every sensor on the newest FIR_TAP_COUNT rows, with
+// the same sums, in the same order, as filter_firFilterBlock(). The inner loops
+// have a fixed count, so the compiler unrolls them; unused columns are zero.
+static void firFilterSensors(double y[]) {
+  const double *b = filter_getFirCoefficientArray();
+  const double(*window)[DIVERSITY_MAX_SENSOR_COUNT] =
+      &firHistory[firNextRow]; // Oldest row first.
+  double sum[DIVERSITY_MAX_SENSOR_COUNT] = {0.0};
+  if (filter_isFirFolded()) {
+    for (uint32_t i = 0; i < FIR_CENTER_TAP; i++) {
+      const double *newer = window[(FIR_TAP_COUNT - 1) - i];
+      const double *older = window[i];
+      for (uint16_t s = 0; s < DIVERSITY_MAX_SENSOR_COUNT; s++) {
+        sum[s] += b[i] * (newer[s] + older[s]);
+      }
+    }
+    for (uint16_t s = 0; s < DIVERSITY_MAX_SENSOR_COUNT; s++) {
+      sum[s] += b[FIR_CENTER_TAP] * window[FIR_CENTER_TAP][s];
+    }
+  } else {
+    for (uint32_t i = 0; i < FIR_TAP_COUNT; i++) {
+      const double *x = window[(FIR_TAP_COUNT - 1) - i];
+      for (uint16_t s = 0; s < DIVERSITY_MAX_SENSOR_COUNT; s++) {
+        sum[s] += b[i] * x[s];
+      }
+    }
+  }
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    y[s] = sum[s];
+  }
+}
+
+// Updates the DC, energy and floor of a sensor with its FIR output y. Returns
+// y less the DC level.
+static double updateSensor(uint16_t s, double y) {
+  if (learnCount == 0)
+    sensorDc[s] = y; // Start from the ambient level, not zero.
+  sensorDc[s] += (y - sensorDc[s]) / DC_TIME_CONSTANT;
+  double d = y - sensorDc[s];
+  sensorEnergy[s] += (d * d - sensorEnergy[s]) / ENERGY_TIME_CONSTANT;
+  if (learnCount < LEARN_COUNT)
+    sensorFloor[s] = sensorEnergy[s];
+  else if (sensorEnergy[s] < sensorFloor[s] * FLOOR_HOLD_RATIO)
+    sensorFloor[s] += (sensorEnergy[s] - sensorFloor[s]) / FLOOR_TIME_CONSTANT;
+  sensorFloor[s] = fmax(sensorFloor[s], MIN_FLOOR);
+  return d;
+}
+
+// Selection: one-hot weights on the selected sensor.
+static void updateSelectionWeights(void) {
+  uint16_t best = selectedSensor;
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    if (sensorEnergy[s] * sensorFloor[best] >
+        sensorEnergy[best] * sensorFloor[s])
+      best = s;
+  }
+  if (sensorEnergy[best] / sensorFloor[best] >
+      DIVERSITY_SWITCH_RATIO * sensorEnergy[selectedSensor] /
+          sensorFloor[selectedSensor])
+    selectedSensor = best;
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    weights[s] = (s == selectedSensor) ? 1.0 : 0.0;
+  }
+}
+
+// Maximal ratio: signal amplitude over noise power, normalized.
+static void updateMaxRatioWeights(void) {
+  double total = 0.0;
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    weights[s] = sqrt(fmax(sensorEnergy[s] - sensorFloor[s], 0.0)) /
+                 sensorFloor[s];
+    total += weights[s];
+  }
+  if (total == 0.0) {
+    // No signal anywhere: assume the same signal on every sensor.
+    for (uint16_t s = 0; s < sensorCount; s++) {
+      weights[s] = 1.0 / sensorFloor[s];
+      total += weights[s];
+    }
+  }
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    weights[s] /= total;
+  }
+}
+
+// Combines the FIR outputs y[] of all sensors into one.
+static double combine(const double y[]) {
+  double d[DIVERSITY_MAX_SENSOR_COUNT];
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    d[s] = updateSensor(s, y[s]);
+  }
+  if (learnCount < LEARN_COUNT)
+    learnCount++;
+  if (sensorCount == 1)
+    return y[0]; // Unchanged, as filter_processBlock() would see it.
+  if (combiner == diversity_selection_e)
+    updateSelectionWeights();
+  else
+    updateMaxRatioWeights();
+  double combined = 0.0;
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    combined += weights[s] * d[s];
+  }
+  return combined;
+}
+
+// Runs combined outputs through filter.c and adds them to *result.
+static void runOutputs(const double outputs[], uint32_t count,
+                       filter_hitTest_t hitTest, filter_blockResult_t *result) {
+  filter_blockResult_t part;
+  filter_processFirOutputs(outputs, count,
+                           result->thresholdCrossed ? NULL : hitTest, &part);
+  if (part.outputCount > 0 &&
+      (result->outputCount == 0 || part.maxPower > result->maxPower)) {
+    result->maxPower = part.maxPower;
+    result->maxPowerFilterNumber = part.maxPowerFilterNumber;
+  }
+  if (part.thresholdCrossed && !result->thresholdCrossed) {
+    result->thresholdCrossed = true;
+    result->crossingOutputIndex =
+        result->outputCount + part.crossingOutputIndex;
+    result->crossingFilterNumber = part.crossingFilterNumber;
+  }
+  result->outputCount += part.outputCount;
+}
+
+// Runs sampleCount raw ADC values from each sensor through the per-sensor FIR
+// filters, the combiner and the rest of the filter chain.
+void diversity_processBlock(const buffer_data_t *samples[],
+                            uint32_t sampleCount, filter_hitTest_t hitTest,
+                            filter_blockResult_t *result) {
+  *result = (filter_blockResult_t){0};
+  double outputs[OUTPUT_BATCH_SIZE];
+  uint32_t outputCount = 0;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    addInputs(samples, i);
+    if (++firPhase < FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    firPhase = 0;
+    double y[DIVERSITY_MAX_SENSOR_COUNT];
+    firFilterSensors(y);
+    outputs[outputCount++] = combine(y);
+    if (outputCount == OUTPUT_BATCH_SIZE) {
+      runOutputs(outputs, outputCount, hitTest, result);
+      outputCount = 0;
+    }
+  }
+  if (outputCount > 0)
+    runOutputs(outputs, outputCount, hitTest, result);
+}
+
+// Returns the number of sensors set by diversity_init().
+uint16_t diversity_getSensorCount(void) { return sensorCount; }
+
+// Copies the weight of each sensor in the newest combined output.
+void diversity_getWeights(double sensorWeights[]) {
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    sensorWeights[s] = weights[s];
+  }
+}
+
+// Copies the newest energy-to-floor ratio of each sensor.
+void diversity_getSensorRatios(double ratios[]) {
+  for (uint16_t s = 0; s < sensorCount; s++) {
+    ratios[s] = sensorEnergy[s] / sensorFloor[s];
+  }
+}
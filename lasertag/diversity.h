@@ -0,0 +1,69 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef DIVERSITY_H_
+#define DIVERSITY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "filter.h"
+
+// Receives with 2 to 4 photodiodes (sensors) instead of one. Each sensor gets
+// its own decimating FIR filter, using the coefficients from filter.c, and its
+// own estimates of DC level, energy and ambient noise floor. The FIR outputs
+// are combined into one stream for the IIR filters, power and hit test in
+// filter.c, so only the FIR filter runs once per sensor:
+// 1. Selection: passes the sensor with the best energy-to-floor ratio. Another
+// sensor takes over when its ratio is DIVERSITY_SWITCH_RATIO times better.
+// 2. Maximal ratio: weights each sensor by its signal amplitude over its noise
+// power, with the signal taken as the energy above the floor. While no sensor
+// is above its floor, each is weighted by the inverse of its floor.
+// The weights always add to 1 and apply to the FIR outputs less their DC
+// level. The photodiodes see the same light pulses at the same time, so the
+// weighted outputs add in phase. With one sensor the FIR output passes through
+// unchanged.
+
+// Most sensors, one per channel of INTERRUPTS_XADC_SENSOR_CHANNELS. The build
+// samples INTERRUPTS_XADC_SENSOR_COUNT of them.
+#define DIVERSITY_MAX_SENSOR_COUNT 4
+// Selection keeps its sensor until another has this much better a ratio.
+#define DIVERSITY_SWITCH_RATIO 2.0
+
+typedef enum {
+  diversity_selection_e, // Pass the best sensor.
+  diversity_maxRatio_e   // Weight every sensor by its signal-to-noise ratio.
+} diversity_combiner_t;
+
+// Sets up sensorCount sensors, from zeroed FIR histories, and the combiner.
+// Call after filter_init(). Returns false (and prints why) if sensorCount is
+// out of range or a reduced-precision filter chain is built in.
+bool diversity_init(uint16_t sensorCount, diversity_combiner_t combiner);
+
+// Runs sampleCount raw ADC values from each sensor (samples[sensor][i], oldest
+// first, taken at the same times) through the per-sensor FIR filters and the
+// combiner, then the combined FIR outputs through
+// filter_processFirOutputs(). sampleCount need not be a multiple of
+// FILTER_FIR_DECIMATION_FACTOR. hitTest and *result work as in
+// filter_processBlock().
+void diversity_processBlock(const buffer_data_t *samples[],
+                            uint32_t sampleCount, filter_hitTest_t hitTest,
+                            filter_blockResult_t *result);
+
+// Returns the number of sensors set by diversity_init().
+uint16_t diversity_getSensorCount(void);
+
+// Copies the weight of each sensor in the newest combined output.
+void diversity_getWeights(double weights[]);
+
+// Copies the newest energy-to-floor ratio of each sensor.
+void diversity_getSensorRatios(double ratios[]);
+
+#endif /* DIVERSITY_H_ */
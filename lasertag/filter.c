@@ -1,15 +1,31 @@
 #include "filter.h"
 #include "queue.h"
+#include "biquad.h"
+#include "cic.h"
+#include "cycleCounter.h"
+#include "dft.h"
+#include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
-#define FIR_COEFF_COUNT 81
+#if defined(FILTER_FIXED_POINT)
+#include "filterFixed.h"
+#elif defined(FILTER_SINGLE_PRECISION)
+#include "filterFloat.h"
+#endif
 
-#define FILTER_FREQUENCY_COUNT 10
+#if !defined(ZYBO_BOARD) && defined(__SSE2__)
+#include <pmmintrin.h>
+#endif
 
-#define IIR_B_COEFF_COUNT 11
+#define FIR_COEFF_COUNT FILTER_FIR_COEFFICIENT_COUNT
 
-#define IIR_A_COEFF_COUNT 10
+#define IIR_B_COEFF_COUNT (FILTER_IIR_ORDER + 1)
+
+#define IIR_A_COEFF_COUNT FILTER_IIR_ORDER
+#define IIR_SECTION_COUNT (FILTER_IIR_ORDER / 2)
 
 #define X_QUEUE_SIZE FIR_COEFF_COUNT
 #define Y_QUEUE_SIZE IIR_B_COEFF_COUNT
@@ -18,11 +34,112 @@
 
 #define QUEUE_INIT_VALUE 0
 
-const static double fir_b_coeffs[FIR_COEFF_COUNT] = {
+// Aligns a table or state block to the start of a data-cache line.
+#define CACHE_ALIGNED __attribute__((aligned(FILTER_CACHE_LINE_SIZE)))
+
+// Symmetric FIR coefficients pair up around this tap.
+#define FIR_CENTER_TAP ((FIR_COEFF_COUNT - 1) / 2)
+
+// Raw ADC values are scaled to -1.0 to 1.0 before filtering.
+#define ADC_SCALAR 2.0
+#define ADC_OFFSET 1.0
+
+// Two numerators are treated as the same shape if their taps, each divided by
+// tap 0, differ by less than this. The tables carry about 16 digits.
+#define IIR_NUMERATOR_TOLERANCE 1.0E-9
+
+// The Goertzel engine sums power over this many decimated samples per block,
+// and over enough blocks to cover the pulse width.
+#define GOERTZEL_BLOCK_LENGTH 200
+#define GOERTZEL_BLOCK_COUNT (FILTER_INPUT_PULSE_WIDTH / GOERTZEL_BLOCK_LENGTH)
+
+// filter_blockSumPower_e sums squared outputs over blocks of this many decimated
+// samples. Power covers the block being filled plus the POWER_BLOCK_COUNT - 1
+// blocks before it.
+#define POWER_BLOCK_LENGTH 100
+#define POWER_BLOCK_COUNT (FILTER_INPUT_PULSE_WIDTH / POWER_BLOCK_LENGTH)
+// Each incremental boxcar power computation also adds this many older outputs
+// to a from-scratch sum, so the running sum is replaced by an exact one every
+// FILTER_INPUT_PULSE_WIDTH / (POWER_RESYNC_SLICE + 1) = 400 outputs.
+#define POWER_RESYNC_SLICE 4
+
+// Time constant, in decimated samples, of filter_exponentialPower_e. A shot
+// must decay by a factor of well over the largest fudge factor between the end
+// of the pulse and the end of the 0.5 s lockout (3000 samples), or it is
+// counted twice.
+#define POWER_AVERAGE_TIME_CONSTANT (FILTER_INPUT_PULSE_WIDTH / 10)
+
+// A direct-form IIR filter whose whole feedback history has decayed below this
+// is snapped to zero and treated as quiescent (see iirFilterFeedback()). Its
+// power is then far below anything the detector acts on, and its state is far
+// above the subnormal range.
+#define IIR_QUIESCENT_THRESHOLD 1.0E-30
+// FPSCR bit that makes the VFP flush subnormal operands and results to zero.
+#define FPSCR_FLUSH_TO_ZERO (1u << 24)
+
+// FIR paths timed separately by filter_getFirStatistics().
+#define FIR_SAMPLE_PATH 0 // filter_firFilter().
+#define FIR_BLOCK_PATH 1  // filter_firFilterBlock() with the FIR front end.
+#define FIR_CIC_PATH 2    // The CIC compensator.
+#define FIR_PATH_COUNT 3
+// Every FIR_COMPARISON_INTERVAL-th call of the folded kernel, on either FIR
+// path, also times the generic kernel on the same inputs.
+#define FIR_COMPARISON_INTERVAL 64
+
+// The energy gate (see filter_setEnergyGate()) removes the ambient DC level from
+// each FIR output with an average over GATE_DC_TIME_CONSTANT outputs and
+// averages the square of what is left over GATE_ENERGY_TIME_CONSTANT outputs.
+#define GATE_DC_TIME_CONSTANT 64
+#define GATE_ENERGY_TIME_CONSTANT 32
+// The ambient floor follows that energy over this many outputs, except while
+// the energy is above the opening threshold.
+#define GATE_FLOOR_TIME_CONSTANT 256
+// The gate stays open while the floor is learned after filter_init().
+#define GATE_LEARN_COUNT FILTER_INPUT_PULSE_WIDTH
+// The gate opens when the energy exceeds the floor by GATE_OPEN_RATIO and
+// closes after GATE_HANGOVER_COUNT outputs in a row below GATE_CLOSE_RATIO.
+// A shot at the detection limit is over 10 times the wideband ambient energy.
+// The hangover is a pulse width, so a closing gate leaves only ambient outputs
+// in the power window.
+#define GATE_OPEN_RATIO 4.0
+#define GATE_CLOSE_RATIO 2.0
+#define GATE_HANGOVER_COUNT FILTER_INPUT_PULSE_WIDTH
+// Lowest floor, below the ADC quantization noise.
+#define GATE_MIN_FLOOR 1.0E-12
+// Skipped outputs that are run when the gate opens, so the start of a shot is
+// not lost. The gate opens within a few outputs of a shot.
+#define GATE_LOOKBACK_COUNT 32
+// The lookback plus the older outputs that refill yQueue before it is run.
+#define GATE_HISTORY_SIZE (GATE_LOOKBACK_COUNT + Y_QUEUE_SIZE - 1)
+
+// The noise floor of each channel (see filter_getNoiseFloors()) equals its
+// power for NOISE_FLOOR_LEARN_COUNT outputs after filter_init(). After that,
+// each output multiplies it by NOISE_FLOOR_RISE if the power is above it and by
+// NOISE_FLOOR_FALL otherwise. The fall is three rise steps, so the floor
+// settles where the power is above it three times out of four: its 25th
+// percentile. A 10 times brighter ambient takes about 5 s to learn, a 0.2 s
+// shot raises the floor by about 20%.
+#define NOISE_FLOOR_LEARN_COUNT FILTER_INPUT_PULSE_WIDTH
+#define NOISE_FLOOR_RISE 1.00005
+#define NOISE_FLOOR_FALL (1.0 / (NOISE_FLOOR_RISE * NOISE_FLOOR_RISE * NOISE_FLOOR_RISE))
+#define NOISE_FLOOR_MIN 1.0E-12
+
+// The CIC front end is flat up to this factor above the highest player
+// frequency.
+#define CIC_PASSBAND_EDGE_RATIO 1.03
+
+#ifdef FILTER_GENERATED_COEFFICIENTS
+const static double fir_b_coeffs[FIR_COEFF_COUNT] CACHE_ALIGNED = FILTER_GENERATED_FIR_COEFFICIENTS;
+const static double iir_a_coeffs[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT] CACHE_ALIGNED =
+    FILTER_GENERATED_IIR_A_COEFFICIENTS;
+const static double iir_b_coeffs[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT] CACHE_ALIGNED =
+    FILTER_GENERATED_IIR_B_COEFFICIENTS;
+#else
+const static double fir_b_coeffs[FIR_COEFF_COUNT] CACHE_ALIGNED = {
     6.2534348595847538e-04, 6.5497758294040542e-04, 6.1992178501587701e-04, 5.0452526771031455e-04, 2.9091060249592421e-04, -3.2856141914564076e-05, -4.6270378618655110e-04, -9.6927546688259272e-04, -1.4924081755106418e-03, -1.9419900366783919e-03, -2.2067863671876870e-03, -2.1712756177317168e-03, -1.7387264211219384e-03, -8.5702012741646952e-04, 4.5755838533190820e-04, 2.1038619889547699e-03, 3.8916195777932861e-03, 5.5528025909850429e-03, 6.7697616171742822e-03, 7.2184438752610595e-03, 6.6220735304987509e-03, 4.8081553873736364e-03, 1.7600311340430473e-03, -2.3461497646870785e-03, -7.1270921927757249e-03, -1.2006185309970628e-02, -1.6257372605455990e-02, -1.9076605069723938e-02, -1.9674051143141542e-02, -1.7376505856439812e-02, -1.1726971420919888e-02, -2.5676376647722600e-03, 9.9063015042762728e-03, 2.5131461770900417e-02, 4.2204543223913080e-02, 5.9953325291499965e-02, 7.7043897907315209e-02, 9.2112551316003752e-02, 1.0390705353179479e-01, 1.1142031823958311e-01, 1.1400000000000000e-01, 1.1142031823958311e-01, 1.0390705353179479e-01, 9.2112551316003752e-02, 7.7043897907315209e-02, 5.9953325291499965e-02, 4.2204543223913080e-02, 2.5131461770900417e-02, 9.9063015042762728e-03, -2.5676376647722600e-03, -1.1726971420919888e-02, -1.7376505856439812e-02, -1.9674051143141542e-02, -1.9076605069723938e-02, -1.6257372605455990e-02, -1.2006185309970628e-02, -7.1270921927757249e-03, -2.3461497646870785e-03, 1.7600311340430473e-03, 4.8081553873736364e-03, 6.6220735304987509e-03, 7.2184438752610595e-03, 6.7697616171742822e-03, 5.5528025909850429e-03, 3.8916195777932861e-03, 2.1038619889547699e-03, 4.5755838533190820e-04, -8.5702012741646952e-04, -1.7387264211219384e-03, -2.1712756177317168e-03, -2.2067863671876870e-03, -1.9419900366783919e-03, -1.4924081755106418e-03, -9.6927546688259272e-04, -4.6270378618655110e-04, -3.2856141914564076e-05, 2.9091060249592421e-04, 5.0452526771031455e-04, 6.1992178501587701e-04, 6.5497758294040542e-04, 6.2534348595847538e-04
 };
 
-const static double iir_a_coeffs[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT] = {
+const static double iir_a_coeffs[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT] CACHE_ALIGNED = {
     {-5.9637727070164059e+00, 1.9125339333078287e+01, -4.0341474540744301e+01, 6.1537466875369077e+01, -7.0019717951472558e+01, 6.0298814235239249e+01, -3.8733792862566574e+01, 1.7993533279581207e+01, -5.4979061224868158e+00, 9.0332828533800469e-01},
     {-4.6377947119071408e+00, 1.3502215749461552e+01, -2.6155952405269698e+01, 3.8589668330738235e+01, -4.3038990303252490e+01, 3.7812927599536991e+01, -2.5113598088113683e+01, 1.2703182701888030e+01, -4.2755083391143280e+00, 9.0332828533799747e-01},
     {-3.0591317915750937e+00, 8.6417489609637492e+00, -1.4278790253808838e+01, 2.1302268283304294e+01, -2.2193853972079211e+01, 2.0873499791105424e+01, -1.3709764520609379e+01, 8.1303553577931567e+00, -2.8201643879900473e+00, 9.0332828533799880e-01},
@@ -34,7 +151,7 @@ const static double iir_a_coeffs[FILTER_FREQUENCY_COUNT][IIR_A_COEFF_COUNT] = {
     {7.4092912870072398e+00, 2.6857944460290135e+01, 6.1578787811202247e+01, 9.8258255839887340e+01, 1.1359460153696304e+02, 9.6280452143026153e+01, 5.9124742025776442e+01, 2.5268527576524235e+01, 6.8305064480743178e+00, 9.0332828533800158e-01},
     {8.5743055776347692e+00, 3.4306584753117903e+01, 8.4035290411037124e+01, 1.3928510844056831e+02, 1.6305115418161643e+02, 1.3648147221895812e+02, 8.0686288623299902e+01, 3.2276361903872186e+01, 7.9045143816244918e+00, 9.0332828533799903e-01}};
 
-const static double iir_b_coeffs[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT] = {
+const static double iir_b_coeffs[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT] CACHE_ALIGNED = {
     {9.0928661148176830e-10, 0.0, -4.5464330574088414e-09, 0.0, 9.0928661148176828e-09, 0.0, -9.0928661148176828e-09, 0.0, 4.5464330574088414e-09, 0.0, -9.0928661148176830e-10},
     {9.0928661148203093e-10, 0.0, -4.5464330574101550e-09, 0.0, 9.0928661148203099e-09, 0.0, -9.0928661148203099e-09, 0.0, 4.5464330574101550e-09, 0.0, -9.0928661148203093e-10},
     {9.0928661148196858e-10, 0.0, -4.5464330574098431e-09, 0.0, 9.0928661148196862e-09, 0.0, -9.0928661148196862e-09, 0.0, 4.5464330574098431e-09, 0.0, -9.0928661148196858e-10},
@@ -45,65 +162,936 @@ const static double iir_b_coeffs[FILTER_FREQUENCY_COUNT][IIR_B_COEFF_COUNT] = {
     {9.0928661148192133e-10, 0.0, -4.5464330574096065e-09, 0.0, 9.0928661148192131e-09, 0.0, -9.0928661148192131e-09, 0.0, 4.5464330574096065e-09, 0.0, -9.0928661148192133e-10},
     {9.0928661148181700e-10, 0.0, -4.5464330574090846e-09, 0.0, 9.0928661148181692e-09, 0.0, -9.0928661148181692e-09, 0.0, 4.5464330574090846e-09, 0.0, -9.0928661148181700e-10},
     {9.0928661148189248e-10, 0.0, -4.5464330574094626e-09, 0.0, 9.0928661148189252e-09, 0.0, -9.0928661148189252e-09, 0.0, 4.5464330574094626e-09, 0.0, -9.0928661148189248e-10}};
+#endif
 
 static queue_t xQueue;
 static queue_t yQueue;
 static queue_t zQueues[FILTER_FREQUENCY_COUNT];
 static queue_t outputQueues[FILTER_FREQUENCY_COUNT];
 
-static double currentPowerValue[FILTER_FREQUENCY_COUNT];
-static double oldest_value[FILTER_FREQUENCY_COUNT];
+// The state that every decimated output touches, in the order it touches it:
+// filter_firFilter() reads xQueue, each IIR filter reads yQueue and its zQueue,
+// then filter_computePower() updates the power totals and reads the two ends
+// of its outputQueue. The queues keep their data here, so the whole chain
+// shares a few kilobytes of consecutive cache lines. Only the newest output of
+// each filter has a slot here; the boxcar windows are allocated on their own
+// (see boxcarWindowData). xQueue, yQueue and the zQueues are mirrored (see
+// queue_initMirrored()), so the FIR and IIR sums read their history as one
+// contiguous span. With FILTER_REDUCED_PRECISION the chain in filterFixed.c or
+// filterFloat.c keeps its own history, so the queues are not set up and have
+// no storage.
+typedef struct {
+#ifndef FILTER_REDUCED_PRECISION
+    queue_data_t xData[QUEUE_MIRRORED_STORAGE_SIZE(X_QUEUE_SIZE)];
+    queue_data_t yData[QUEUE_MIRRORED_STORAGE_SIZE(Y_QUEUE_SIZE)];
+    queue_data_t zData[FILTER_FREQUENCY_COUNT][QUEUE_MIRRORED_STORAGE_SIZE(Z_QUEUE_SIZE)];
+#endif
+    double currentPowerValue[FILTER_FREQUENCY_COUNT];
+    double oldestValue[FILTER_FREQUENCY_COUNT];
+    double powerSum[FILTER_FREQUENCY_COUNT];
+    double powerCompensation[FILTER_FREQUENCY_COUNT];
+#ifndef FILTER_REDUCED_PRECISION
+    queue_data_t outputData[FILTER_FREQUENCY_COUNT][QUEUE_STORAGE_SIZE(1)];
+#endif
+} filterArena_t;
+static filterArena_t arena CACHE_ALIGNED;
+
+#ifndef FILTER_REDUCED_PRECISION
+// The outputQueue storage of filter_boxcarPower_e: FILTER_FREQUENCY_COUNT
+// windows of BOXCAR_WINDOW_STORAGE_SIZE elements, allocated by filter_init()
+// while that estimator is selected and NULL otherwise.
+#define BOXCAR_WINDOW_STORAGE_SIZE QUEUE_STORAGE_SIZE(OUTPUT_QUEUE_SIZE)
+static queue_data_t *boxcarWindowData = NULL;
+#endif
+
+static double *const currentPowerValue = arena.currentPowerValue;
+static double *const oldest_value = arena.oldestValue;
+
+// The boxcar power is a compensated (Neumaier) running sum: powerSum plus the
+// rounding error powerCompensation that the additions left out.
+static double *const powerSum = arena.powerSum;
+static double *const powerCompensation = arena.powerCompensation;
+// From-scratch sum of the newest resyncLength outputs, built a slice at a time.
+// It only adds squares, so it needs no compensation to stay accurate.
+static double resyncSum[FILTER_FREQUENCY_COUNT];
+static uint32_t resyncLength[FILTER_FREQUENCY_COUNT];
+static filter_powerDriftStatistics_t driftStatistics;
+
+// True if fir_b_coeffs[i] == fir_b_coeffs[FIR_COEFF_COUNT - 1 - i] for all i.
+static bool firCoeffsSymmetric;
+
+// Estimator requested by filter_setPowerEstimator() and the one in use.
+static filter_powerEstimator_t requestedPowerEstimator = filter_boxcarPower_e;
+static filter_powerEstimator_t powerEstimator = filter_boxcarPower_e;
+
+// State for filter_blockSumPower_e: a ring of block sums per filter, where
+// powerBlockNewest is the block being filled and powerFullBlockTotal is the
+// sum of the others.
+static double powerBlockSums[FILTER_FREQUENCY_COUNT][POWER_BLOCK_COUNT];
+static uint32_t powerBlockNewest[FILTER_FREQUENCY_COUNT];
+static uint32_t powerBlockFill[FILTER_FREQUENCY_COUNT];
+static double powerFullBlockTotal[FILTER_FREQUENCY_COUNT];
+
+// State for filter_exponentialPower_e: the average squared output.
+static double powerAverage[FILTER_FREQUENCY_COUNT];
+
+// Front end requested by filter_setFrontEnd() and the one filter_init() set
+// up, with the state of filter_cicFrontEnd_e.
+static filter_frontEnd_t requestedFrontEnd = filter_firFrontEnd_e;
+static filter_frontEnd_t frontEnd = filter_firFrontEnd_e;
+static cic_t cicDecimator;
+static double cicScale; // Converts a CIC output to ADC full scale.
+static double cicCompensatorCoeffs[CIC_COMPENSATOR_TAP_COUNT];
+// Compensator inputs, each written twice, CIC_COMPENSATOR_TAP_COUNT apart, so
+// the newest CIC_COMPENSATOR_TAP_COUNT are always contiguous.
+static double cicCompensatorHistory[2 * CIC_COMPENSATOR_TAP_COUNT];
+static uint32_t cicCompensatorNext; // Slot the next input goes to.
+
+// Engine requested by filter_setEngine() and the one filter_init() set up.
+static filter_engine_t requestedEngine = filter_directFormEngine_e;
+static filter_engine_t engine = filter_directFormEngine_e;
+
+// History for filter_interleavedEngine_e: one row per output time and one
+// column per filter. IIR_HISTORY_ROW_COUNT rows are stored twice, so the
+// Z_QUEUE_SIZE rows after the newest one are always contiguous.
+#define IIR_HISTORY_ROW_COUNT (Z_QUEUE_SIZE + 1)
+static double iirHistory[2 * IIR_HISTORY_ROW_COUNT][FILTER_FREQUENCY_COUNT];
+static uint32_t iirHistoryRow[FILTER_FREQUENCY_COUNT]; // Row of each newest output.
+static double iirAInterleaved[IIR_A_COEFF_COUNT][FILTER_FREQUENCY_COUNT] CACHE_ALIGNED;
+
+// Denormal guard requested by filter_setDenormalGuard() and whether it is on.
+static bool requestedDenormalGuard = true;
+static bool denormalGuard = true;
+
+// True if a direct-form filter's zQueue holds only zeros, so a zero input gives
+// a zero output without running the filter.
+static bool iirQuiescent[FILTER_FREQUENCY_COUNT];
+
+// Per-filter state for filter_biquadEngine_e.
+static biquad_floatSection_t iirSections[FILTER_FREQUENCY_COUNT][IIR_SECTION_COUNT];
+
+// B taps that are nonzero in at least one filter; the rest are skipped.
+static uint32_t iirBTapIndex[IIR_B_COEFF_COUNT];
+static uint32_t iirBTapCount;
+
+// True if every row of iir_b_coeffs is a gain times the same numerator. Then
+// iirSharedNumerator holds that numerator (tap 0 is 1.0) and iirNumeratorGain
+// holds each filter's tap 0, so filter_iirFilterBank() can compute the
+// feed-forward sum once for all filters.
+static bool iirNumeratorShared;
+static double iirSharedNumerator[IIR_B_COEFF_COUNT];
+static double iirNumeratorGain[FILTER_FREQUENCY_COUNT];
+
+// Input history for filter_firFilterBlock(). Each input is written twice,
+// FIR_COEFF_COUNT apart, so the newest FIR_COEFF_COUNT are always contiguous
+// and the block path runs the same kernels as filter_firFilter() on xQueue.
+static double firBlockHistory[2 * FIR_COEFF_COUNT] CACHE_ALIGNED;
+static uint32_t firBlockNext; // Slot the next input goes to.
+
+// Raw values passed to filter_processBlock() that don't yet fill a block.
+static buffer_data_t pendingBlock[FILTER_FIR_DECIMATION_FACTOR];
+static uint32_t pendingCount;
+
+// Energy gate requested by filter_setEnergyGate() and whether it is in use.
+static bool requestedEnergyGate = false;
+static bool energyGateEnabled = false;
+
+// Energy gate state. gateSkippedCount is the number of outputs since the IIR
+// filters last ran; gateHistory holds the newest FIR outputs, newest at
+// gateHistoryNewest.
+static double gateDc;
+static double gateEnergy;
+static double gateFloor;
+static uint32_t gateLearnCount;
+static uint32_t gateQuietCount;
+static uint32_t gateSkippedCount;
+static double gateHistory[GATE_HISTORY_SIZE];
+static uint32_t gateHistoryNewest;
+
+// Run-time statistics for the energy gate: FIR outputs seen by
+// filter_processBlock() and how many of them skipped the IIR filters.
+static uint32_t gateOutputCount;
+static uint32_t gateIdleCount;
+
+// Noise floor of each channel, updated by processNewestOutput().
+static double noiseFloors[FILTER_FREQUENCY_COUNT];
+static uint32_t noiseFloorLearnCount;
+
+// One filter's part of a filter_state_t.
+typedef struct {
+    double z[Z_QUEUE_SIZE];                        // zQueue, oldest first.
+    double iirHistory[2 * IIR_HISTORY_ROW_COUNT];  // Its column of iirHistory.
+    uint32_t iirHistoryRow;
+    float iirSections[IIR_SECTION_COUNT][2];       // Biquad states.
+    double currentPower;
+    double oldestValue;
+    double powerSum;
+    double powerCompensation;
+    double resyncSum;
+    uint32_t resyncLength;
+    double blockSums[POWER_BLOCK_COUNT];
+    uint32_t blockNewest;
+    uint32_t blockFill;
+    double fullBlockTotal;
+    double average;
+} filterState_t;
+
+// A snapshot written by filter_saveState(), filter_getStateSize() bytes long.
+struct filter_state {
+    uint32_t size; // Bytes, checked by filter_restoreState().
+    filter_engine_t engine;
+    filter_powerEstimator_t powerEstimator;
+    double x[X_QUEUE_SIZE];           // xQueue, oldest first.
+    double firBlock[FIR_COEFF_COUNT]; // Block FIR inputs, oldest first.
+    double y[Y_QUEUE_SIZE];           // yQueue, oldest first.
+    double gateDc;
+    double gateEnergy;
+    double gateFloor;
+    uint32_t gateLearnCount;
+    uint32_t gateQuietCount;
+    filterState_t filters[FILTER_FREQUENCY_COUNT];
+    // Each filter's outputQueue, oldest first, stateWindowLength() slots apiece.
+    double windows[];
+};
+
+// Snapshot that filter_init() restores, if not NULL (see filter_setWarmStart()).
+static const filter_state_t *warmStartState = NULL;
+
+// Run-time statistics for the FIR paths, in cycleCounter counts, and for the
+// folded kernel against the generic one on the same inputs.
+static uint64_t firPathCycles[FIR_PATH_COUNT];
+static uint32_t firPathCalls[FIR_PATH_COUNT];
+static uint64_t foldedComparisonCycles;
+static uint64_t genericComparisonCycles;
+static uint32_t firComparisonCount;
+static volatile double firComparisonSink; // Keeps the generic output alive.
 
 /******************************************************************************
 ***** Helper functions
 ******************************************************************************/
 
-// Call queue_init() on xQueue and fill it with zeros.
-void initXQueue() {
-    queue_init(&xQueue, X_QUEUE_SIZE, "xQueue");
+// Points a queue at its storage the first time and whenever its storage or
+// size changes, then fills it with zeros.
+// A mirrored queue keeps its newest elements contiguous (see queue_window()).
+void initZeroedQueue(queue_t *q, queue_data_t *storage, queue_size_t size, bool mirrored,
+                     const char *name) {
+    if (q->data != storage || queue_size(q) != size) {
+        if (mirrored)
+            queue_initMirroredWithStorage(q, storage, size, name);
+        else
+            queue_initWithStorage(q, storage, size, name);
+    }
 
     // Fill queue with zeros
-    for (uint32_t i = 0; i < X_QUEUE_SIZE; i++) {
-        queue_overwritePush(&xQueue, QUEUE_INIT_VALUE);
-    }
+    queue_fill(q, QUEUE_INIT_VALUE);
+}
+
+// Size of each outputQueue, and its power window slots in a snapshot: the whole
+// boxcar window, or only the newest output for the other estimators.
+uint32_t stateWindowLength(filter_powerEstimator_t estimator) {
+    return (estimator == filter_boxcarPower_e) ? OUTPUT_QUEUE_SIZE : 1;
+}
+
+#ifndef FILTER_REDUCED_PRECISION
+// Call queue_init() on xQueue and fill it with zeros.
+void initXQueue() {
+    initZeroedQueue(&xQueue, arena.xData, X_QUEUE_SIZE, true, "xQueue");
 }
 
 // Call queue_init() on yQueue and fill it with zeros.
 void initYQueue() {
-    queue_init(&yQueue, Y_QUEUE_SIZE, "yQueue");
-
-    // Fill queue with zeros
-    for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++) {
-        queue_overwritePush(&yQueue, QUEUE_INIT_VALUE);
-    }
+    initZeroedQueue(&yQueue, arena.yData, Y_QUEUE_SIZE, true, "yQueue");
 }
 
 // Call queue_init() on all of the zQueues and fill each z queue with zeros.
 void initZQueues() {
     for (uint32_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
-        queue_init(&(zQueues[i]), Z_QUEUE_SIZE, "zQueue");
-
-        for (uint32_t j = 0; j < Z_QUEUE_SIZE; j++) {
-            queue_overwritePush(&(zQueues[i]), QUEUE_INIT_VALUE);
-        }
+        iirQuiescent[i] = false; // Set again once the filter has run.
+        initZeroedQueue(&(zQueues[i]), arena.zData[i], Z_QUEUE_SIZE, true, "zQueue");
     }
 }
 
 // Call queue_init() on all of the outputQueues and fill each outputQueue with zeros.
+// Only the boxcar power estimator needs more than the newest output, so only it
+// gets the windows in boxcarWindowData; the others use the slots in the arena.
+// Falls back to filter_blockSumPower_e if the windows can't be allocated.
 void initOutputQueues() {
+    if (powerEstimator != filter_boxcarPower_e) {
+        free(boxcarWindowData);
+        boxcarWindowData = NULL;
+    } else if (boxcarWindowData == NULL) {
+        boxcarWindowData = malloc(FILTER_FREQUENCY_COUNT * BOXCAR_WINDOW_STORAGE_SIZE *
+                                  sizeof(queue_data_t));
+        if (boxcarWindowData == NULL) {
+            printf("initOutputQueues(): malloc failed for the boxcar windows, using "
+                   "filter_blockSumPower_e.\n");
+            powerEstimator = filter_blockSumPower_e;
+        }
+    }
+    uint32_t size = stateWindowLength(powerEstimator);
     for (uint32_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
-        queue_init(&(outputQueues[i]), OUTPUT_QUEUE_SIZE, "outputQueue");
+        queue_data_t *storage = (boxcarWindowData != NULL)
+                                    ? &boxcarWindowData[i * BOXCAR_WINDOW_STORAGE_SIZE]
+                                    : arena.outputData[i];
+        initZeroedQueue(&(outputQueues[i]), storage, size, false, "outputQueue");
+    }
+}
+#endif
+
+// Adds value to the compensated sum *sum + *compensation (Neumaier's variant
+// of Kahan summation, which also handles values larger than the sum).
+void addCompensated(double *sum, double *compensation, double value) {
+    double t = *sum + value;
+    if (fabs(*sum) >= fabs(value))
+        *compensation += (*sum - t) + value;
+    else
+        *compensation += (value - t) + *sum;
+    *sum = t;
+}
+
+// Sets the running boxcar power of a filter and restarts its resync.
+void setBoxcarPower(uint16_t filterNumber, double power) {
+    powerSum[filterNumber] = power;
+    powerCompensation[filterNumber] = 0.0;
+    resyncSum[filterNumber] = 0.0;
+    resyncLength[filterNumber] = 0;
+}
 
-        for (uint32_t j = 0; j < OUTPUT_QUEUE_SIZE; j++) {
-            queue_overwritePush(&(outputQueues[i]), QUEUE_INIT_VALUE);
+// Zeros the boxcar power sums, the stored oldest outputs and the drift
+// statistics.
+void initBoxcarPower() {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        setBoxcarPower(i, 0.0);
+        oldest_value[i] = 0.0; // The output queues restart from zero too.
+    }
+    driftStatistics.resyncCount = 0;
+    driftStatistics.maxAbsoluteDrift = 0.0;
+    driftStatistics.maxRelativeDrift = 0.0;
+    driftStatistics.lastAbsoluteDrift = 0.0;
+}
+
+// Adds the newest output and up to POWER_RESYNC_SLICE older ones to the
+// from-scratch sum. Once that sum covers the whole output queue it replaces the
+// running sum, and the difference between the two is recorded as drift.
+void resyncBoxcarPower(uint16_t filterNumber) {
+    queue_t *q = &outputQueues[filterNumber];
+    uint32_t count = queue_elementCount(q);
+    double newest = queue_fastReadElementAt(q, count - 1);
+
+    resyncSum[filterNumber] += newest * newest;
+    resyncLength[filterNumber]++;
+    for (uint32_t i = 0; i < POWER_RESYNC_SLICE && resyncLength[filterNumber] < count; i++) {
+        double z = queue_fastReadElementAt(q, (count - 1) - resyncLength[filterNumber]);
+        resyncSum[filterNumber] += z * z;
+        resyncLength[filterNumber]++;
+    }
+    if (resyncLength[filterNumber] < count)
+        return;
+
+    double exact = resyncSum[filterNumber];
+    double drift = fabs((powerSum[filterNumber] + powerCompensation[filterNumber]) - exact);
+    driftStatistics.resyncCount++;
+    driftStatistics.lastAbsoluteDrift = drift;
+    if (drift > driftStatistics.maxAbsoluteDrift)
+        driftStatistics.maxAbsoluteDrift = drift;
+    if (exact > 0.0 && drift / exact > driftStatistics.maxRelativeDrift)
+        driftStatistics.maxRelativeDrift = drift / exact;
+    setBoxcarPower(filterNumber, exact);
+}
+
+// Zeros the state of the block-sum and exponential power estimators.
+void initPowerEstimator() {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        for (uint32_t j = 0; j < POWER_BLOCK_COUNT; j++) {
+            powerBlockSums[i][j] = 0.0;
         }
+        powerBlockNewest[i] = 0;
+        powerBlockFill[i] = 0;
+        powerFullBlockTotal[i] = 0.0;
+        powerAverage[i] = 0.0;
+    }
+}
+
+// Adds the newest output z of a filter to the block-sum or exponential
+// estimator and returns the new power estimate.
+double estimatePower(uint16_t filterNumber, double z) {
+    double zSquared = z * z;
+
+    if (powerEstimator == filter_exponentialPower_e) {
+        powerAverage[filterNumber] += (zSquared - powerAverage[filterNumber]) / POWER_AVERAGE_TIME_CONSTANT;
+        return powerAverage[filterNumber] * FILTER_INPUT_PULSE_WIDTH;
+    }
+
+    double *sums = powerBlockSums[filterNumber];
+    sums[powerBlockNewest[filterNumber]] += zSquared;
+    if (++powerBlockFill[filterNumber] == POWER_BLOCK_LENGTH) {
+        // Start a new block in place of the oldest one. The total of the full
+        // blocks is summed afresh, so rounding errors never accumulate.
+        uint32_t newest = powerBlockNewest[filterNumber] + 1;
+        newest = (newest == POWER_BLOCK_COUNT) ? 0 : newest;
+        sums[newest] = 0.0;
+        powerBlockNewest[filterNumber] = newest;
+        powerBlockFill[filterNumber] = 0;
+        double total = 0.0;
+        for (uint32_t i = 0; i < POWER_BLOCK_COUNT; i++) {
+            total += sums[i];
+        }
+        powerFullBlockTotal[filterNumber] = total;
+    }
+    return powerFullBlockTotal[filterNumber] + sums[powerBlockNewest[filterNumber]];
+}
+
+// Returns true if the FIR coefficients are mirror images around the center tap.
+bool isFirSymmetric() {
+    for (uint32_t i = 0; i < FIR_CENTER_TAP; i++) {
+        if (fir_b_coeffs[i] != fir_b_coeffs[(FIR_COEFF_COUNT - 1) - i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Computes the FIR output from the newest FIR_COEFF_COUNT inputs x[] (oldest
+// first) with one multiply per coefficient.
+double firFilterGeneric(const double x[]) {
+    double y = 0.0;
+
+    for (uint32_t i=0; i < FIR_COEFF_COUNT; i++) { // iteratively adds the (b * input) products.
+        y += x[(FIR_COEFF_COUNT - 1) - i] * fir_b_coeffs[i];
+    }
+    return y;
+}
+
+// Computes the FIR output for symmetric coefficients. Inputs that share a
+// coefficient are added first, so only 41 of the 81 multiplies remain.
+double firFilterFolded(const double x[]) {
+    double y = 0.0;
+
+    for (uint32_t i = 0; i < FIR_CENTER_TAP; i++) {
+        y += fir_b_coeffs[i] * (x[(FIR_COEFF_COUNT - 1) - i] + x[i]);
+    }
+    y += fir_b_coeffs[FIR_CENTER_TAP] * x[FIR_CENTER_TAP];
+    return y;
+}
+
+// Zeros the input history used by filter_firFilterBlock().
+void initFirBlockHistory() {
+    for (uint32_t i = 0; i < 2 * FIR_COEFF_COUNT; i++) {
+        firBlockHistory[i] = QUEUE_INIT_VALUE;
+    }
+    firBlockNext = 0;
+}
+
+// Scales a block of raw ADC values into the block history. Returns the newest
+// FIR_COEFF_COUNT inputs, oldest first.
+const double *addFirBlock(const buffer_data_t rawAdcBlock[]) {
+    for (uint32_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+        double x = filter_scaleAdcValue(rawAdcBlock[i]);
+        firBlockHistory[firBlockNext] = x;
+        firBlockHistory[firBlockNext + FIR_COEFF_COUNT] = x;
+        firBlockNext = (firBlockNext + 1 == FIR_COEFF_COUNT) ? 0 : firBlockNext + 1;
+    }
+    return &firBlockHistory[firBlockNext];
+}
+
+// Sets up filter_cicFrontEnd_e: zeros the decimator and the compensator, and
+// designs the compensator to be flat up to just above the highest player
+// frequency. Returns false if the decimator could overflow.
+bool initCicFrontEnd() {
+    if (!cic_init(&cicDecimator, FILTER_FIR_DECIMATION_FACTOR, FILTER_ADC_MAX_VALUE))
+        return false;
+    uint16_t minTicks = filter_frequencyTickTable[0];
+    for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (filter_frequencyTickTable[i] < minTicks)
+            minTicks = filter_frequencyTickTable[i];
+    }
+    double passbandEdge = 2.0 * M_PI * FILTER_FIR_DECIMATION_FACTOR / minTicks *
+                          CIC_PASSBAND_EDGE_RATIO;
+    cic_designCompensator(cicCompensatorCoeffs, CIC_COMPENSATOR_TAP_COUNT,
+                          FILTER_FIR_DECIMATION_FACTOR, fmin(passbandEdge, M_PI));
+    cicScale = ADC_SCALAR /
+               ((double)cic_getGain(FILTER_FIR_DECIMATION_FACTOR) * FILTER_ADC_MAX_VALUE);
+    for (uint32_t i = 0; i < 2 * CIC_COMPENSATOR_TAP_COUNT; i++) {
+        cicCompensatorHistory[i] = QUEUE_INIT_VALUE;
+    }
+    cicCompensatorNext = 0;
+    return true;
+}
+
+// Scales a CIC output like filter_scaleAdcValue() and runs the compensator on
+// it. Returns the compensator output.
+double compensateCicOutput(uint32_t cicOutput) {
+    double x = cicOutput * cicScale - ADC_OFFSET;
+    cicCompensatorHistory[cicCompensatorNext] = x;
+    cicCompensatorHistory[cicCompensatorNext + CIC_COMPENSATOR_TAP_COUNT] = x;
+    cicCompensatorNext =
+        (cicCompensatorNext + 1 == CIC_COMPENSATOR_TAP_COUNT) ? 0 : cicCompensatorNext + 1;
+    const double *window = &cicCompensatorHistory[cicCompensatorNext]; // Oldest first.
+    double y = 0.0;
+    for (uint32_t i = 0; i < CIC_COMPENSATOR_TAP_COUNT; i++) {
+        y += cicCompensatorCoeffs[i] * window[i];
+    }
+    return y;
+}
+
+// Runs a block of FILTER_FIR_DECIMATION_FACTOR raw ADC values through the CIC
+// decimator, whose one output goes through the compensator.
+double cicFilterBlock(const buffer_data_t rawAdcBlock[]) {
+    uint32_t cicOutput = 0;
+    for (uint32_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+        cic_addSample(&cicDecimator, rawAdcBlock[i], &cicOutput);
+    }
+    return compensateCicOutput(cicOutput);
+}
+
+// Finds the nonzero B taps and checks whether all filters share one numerator.
+void initIirNumerators() {
+    iirBTapCount = 0;
+    for (uint32_t i = 0; i < IIR_B_COEFF_COUNT; i++) {
+        for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+            if (iir_b_coeffs[j][i] != 0.0) {
+                iirBTapIndex[iirBTapCount++] = i;
+                break;
+            }
+        }
+    }
+
+    iirNumeratorShared = true;
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        iirNumeratorGain[j] = iir_b_coeffs[j][0];
+        if (iirNumeratorGain[j] == 0.0) {
+            iirNumeratorShared = false;
+        }
+    }
+    for (uint32_t i = 0; iirNumeratorShared && i < IIR_B_COEFF_COUNT; i++) {
+        iirSharedNumerator[i] = iir_b_coeffs[0][i] / iirNumeratorGain[0];
+        for (uint16_t j = 1; j < FILTER_FREQUENCY_COUNT; j++) {
+            if (fabs(iir_b_coeffs[j][i] / iirNumeratorGain[j] - iirSharedNumerator[i]) >
+                IIR_NUMERATOR_TOLERANCE) {
+                iirNumeratorShared = false;
+                break;
+            }
+        }
+    }
+}
+
+// Turns flush-to-zero (subnormals read and written as zero) on or off for the
+// whole program.
+void setFlushToZero(bool enabled) {
+#if defined(ZYBO_BOARD)
+    uint32_t fpscr;
+    __asm__ volatile("vmrs %0, fpscr" : "=r"(fpscr));
+    fpscr = enabled ? (fpscr | FPSCR_FLUSH_TO_ZERO) : (fpscr & ~FPSCR_FLUSH_TO_ZERO);
+    __asm__ volatile("vmsr fpscr, %0" : : "r"(fpscr));
+#elif defined(__SSE2__)
+    _MM_SET_FLUSH_ZERO_MODE(enabled ? _MM_FLUSH_ZERO_ON : _MM_FLUSH_ZERO_OFF);
+    _MM_SET_DENORMALS_ZERO_MODE(enabled ? _MM_DENORMALS_ZERO_ON : _MM_DENORMALS_ZERO_OFF);
+#else
+    (void)enabled; // Only the snap to zero in iirFilterFeedback() applies.
+#endif
+}
+
+// Zeros the zQueue of a direct-form filter and marks it quiescent if its whole
+// history has decayed below IIR_QUIESCENT_THRESHOLD.
+void snapQuiescentFilter(uint16_t filterNumber) {
+    const double *zHistory = queue_fastWindow(&(zQueues[filterNumber]), Z_QUEUE_SIZE);
+    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
+        if (fabs(zHistory[i]) >= IIR_QUIESCENT_THRESHOLD)
+            return;
+    }
+    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
+        queue_fastOverwritePush(&(zQueues[filterNumber]), 0.0);
+    }
+    iirQuiescent[filterNumber] = true;
+}
+
+// Finishes a direct-form IIR filter given its feed-forward sum y: subtracts the
+// feedback sum and pushes the output onto the output queue and zQueue.
+// A quiescent filter with a zero input just outputs zero. With the denormal
+// guard on, a filter whose output decays below IIR_QUIESCENT_THRESHOLD is
+// checked for quiescence.
+double iirFilterFeedback(uint16_t filterNumber, double y) {
+    if (iirQuiescent[filterNumber] && y == 0.0) {
+        // Pushing a zero onto a zQueue of zeros would not change it.
+        queue_fastOverwritePush(&(outputQueues[filterNumber]), 0.0);
+        return 0.0;
+    }
+    iirQuiescent[filterNumber] = false;
+
+    const double *zHistory = queue_fastWindow(&(zQueues[filterNumber]), Z_QUEUE_SIZE);
+    double z = 0.0;
+
+    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
+        z += zHistory[Z_QUEUE_SIZE - i - 1] * iir_a_coeffs[filterNumber][i];
+    }
+
+    z = y - z;
+
+    queue_fastOverwritePush(&(outputQueues[filterNumber]), z);
+    queue_fastOverwritePush(&(zQueues[filterNumber]), z);
+    if (denormalGuard && fabs(z) < IIR_QUIESCENT_THRESHOLD)
+        snapQuiescentFilter(filterNumber);
+
+    return z;
+}
+
+// Computes the feed-forward (B) sum for one filter from yQueue.
+double iirFeedForward(uint16_t filterNumber) {
+    const double *yHistory = queue_fastWindow(&yQueue, Y_QUEUE_SIZE);
+    double y = 0.0;
+
+    for (uint32_t t = 0; t < iirBTapCount; t++) { // Zero taps are skipped.
+        uint32_t i = iirBTapIndex[t];
+        y += yHistory[Y_QUEUE_SIZE - i - 1] * iir_b_coeffs[filterNumber][i];
+    }
+    return y;
+}
+
+// Computes the feed-forward sum for every filter, only once if the filters
+// share a numerator.
+void iirFeedForwardBank(double y[]) {
+    if (!iirNumeratorShared) {
+        for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
+            y[filterNumber] = iirFeedForward(filterNumber);
+        }
+        return;
+    }
+
+    const double *yHistory = queue_fastWindow(&yQueue, Y_QUEUE_SIZE);
+    double sharedY = 0.0;
+
+    for (uint32_t t = 0; t < iirBTapCount; t++) {
+        uint32_t i = iirBTapIndex[t];
+        sharedY += yHistory[Y_QUEUE_SIZE - i - 1] * iirSharedNumerator[i];
+    }
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
+        y[filterNumber] = iirNumeratorGain[filterNumber] * sharedY;
+    }
+}
+
+// Zeros the interleaved history and lays out the A coefficients to match it.
+void initIirHistory() {
+    for (uint32_t i = 0; i < 2 * IIR_HISTORY_ROW_COUNT; i++) {
+        for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+            iirHistory[i][j] = QUEUE_INIT_VALUE;
+        }
+    }
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        iirHistoryRow[j] = 0;
+        for (uint32_t i = 0; i < IIR_A_COEFF_COUNT; i++) {
+            iirAInterleaved[i][j] = iir_a_coeffs[j][i];
+        }
+    }
+}
+
+// Returns the row that comes before row in the interleaved history ring.
+uint32_t previousIirHistoryRow(uint32_t row) {
+    return (row == 0) ? IIR_HISTORY_ROW_COUNT - 1 : row - 1;
+}
+
+// Stores a new output for one filter in the interleaved history (both copies)
+// and in its output queue.
+void storeInterleavedOutput(uint16_t filterNumber, uint32_t row, double z) {
+    iirHistory[row][filterNumber] = z;
+    iirHistory[row + IIR_HISTORY_ROW_COUNT][filterNumber] = z;
+    iirHistoryRow[filterNumber] = row;
+    queue_fastOverwritePush(&(outputQueues[filterNumber]), z);
+}
+
+// Same arithmetic as iirFilterFeedback(), reading one column of the
+// interleaved history instead of a zQueue.
+double iirFilterInterleaved(uint16_t filterNumber, double y) {
+    uint32_t row = previousIirHistoryRow(iirHistoryRow[filterNumber]);
+    double z = 0.0;
+
+    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
+        z += iirHistory[row + 1 + i][filterNumber] * iirAInterleaved[i][filterNumber];
+    }
+
+    z = y - z;
+    storeInterleavedOutput(filterNumber, row, z);
+    return z;
+}
+
+// Runs every filter in lock-step: each pass of the outer loop reads one
+// contiguous row of history and one row of coefficients, and the inner loop
+// over filters has no dependencies, so the compiler can vectorize it.
+// All filters must have their newest output in the same row.
+void iirFilterInterleavedBank(const double y[]) {
+    uint32_t row = previousIirHistoryRow(iirHistoryRow[0]);
+    double z[FILTER_FREQUENCY_COUNT] = {0.0};
+
+    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
+        const double *history = iirHistory[row + 1 + i];
+        const double *a = iirAInterleaved[i];
+        for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+            z[j] += history[j] * a[j];
+        }
+    }
+
+    for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        storeInterleavedOutput(j, row, y[j] - z[j]);
+    }
+}
+
+// Returns true if every filter has its newest output in the same history row,
+// which is always the case unless filters were run one at a time unevenly.
+bool iirHistoryRowsAligned() {
+    for (uint16_t j = 1; j < FILTER_FREQUENCY_COUNT; j++) {
+        if (iirHistoryRow[j] != iirHistoryRow[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if the engine measures power with dft.c instead of IIR filters.
+bool isDftEngine(filter_engine_t e) {
+    return e == filter_goertzelEngine_e || e == filter_slidingDftEngine_e ||
+           e == filter_channelizerEngine_e;
+}
+
+// Sets up dft.c at the player frequencies for the Goertzel, sliding-DFT or
+// channelizer engine.
+void initDft() {
+    double frequencies[FILTER_FREQUENCY_COUNT]; // Radians per decimated sample.
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        frequencies[i] = 2.0 * M_PI * FILTER_FIR_DECIMATION_FACTOR /
+                         filter_frequencyTickTable[i];
+    }
+    if (engine == filter_goertzelEngine_e)
+        dft_initGoertzel(frequencies, FILTER_FREQUENCY_COUNT, GOERTZEL_BLOCK_LENGTH,
+                         GOERTZEL_BLOCK_COUNT);
+    else if (engine == filter_slidingDftEngine_e)
+        dft_initSliding(frequencies, FILTER_FREQUENCY_COUNT, FILTER_INPUT_PULSE_WIDTH);
+    else if (!dft_initChannelizer(frequencies, FILTER_FREQUENCY_COUNT,
+                                  GOERTZEL_BLOCK_LENGTH, GOERTZEL_BLOCK_COUNT)) {
+        printf("filter_init(): player frequencies too close for the channelizer, "
+               "using Goertzel.\n");
+        engine = filter_goertzelEngine_e;
+        initDft();
     }
 }
 
+// Factors every IIR filter into biquads for filter_biquadEngine_e. Falls back
+// to the direct form if any filter can't be factored.
+void initIirSections() {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        biquad_section_t sections[BIQUAD_MAX_SECTION_COUNT];
+        uint16_t sectionCount;
+        double centerFrequency = 2.0 * M_PI * FILTER_FIR_DECIMATION_FACTOR /
+                                 filter_frequencyTickTable[i];
+        if (!biquad_design(iir_b_coeffs[i], iir_a_coeffs[i], FILTER_IIR_ORDER,
+                           centerFrequency, sections, &sectionCount) ||
+            sectionCount != IIR_SECTION_COUNT) {
+            printf("filter_init(): IIR filter %d can't be factored into biquads, "
+                   "using the direct form.\n", i);
+            engine = filter_directFormEngine_e;
+            return;
+        }
+        biquad_initFloatSections(sections, sectionCount, iirSections[i]);
+    }
+}
+
+// Restarts the energy gate: open, with the floor still to be learned.
+void initEnergyGate() {
+    gateDc = 0.0;
+    gateEnergy = 0.0;
+    gateFloor = HUGE_VAL;
+    gateLearnCount = 0;
+    gateQuietCount = 0;
+    gateSkippedCount = 0;
+    for (uint32_t i = 0; i < GATE_HISTORY_SIZE; i++) {
+        gateHistory[i] = QUEUE_INIT_VALUE;
+    }
+    gateHistoryNewest = 0;
+    gateOutputCount = 0;
+    gateIdleCount = 0;
+}
+
+// Returns the FIR output age outputs older than the newest in gateHistory.
+double readGateHistory(uint32_t age) {
+    return gateHistory[(gateHistoryNewest + GATE_HISTORY_SIZE - age) % GATE_HISTORY_SIZE];
+}
+
+// Adds a new FIR output y to the gate history and the energy estimate.
+// Returns true if the IIR filters must run for it.
+bool updateEnergyGate(double y) {
+    gateHistoryNewest = (gateHistoryNewest + 1 == GATE_HISTORY_SIZE) ? 0 : gateHistoryNewest + 1;
+    gateHistory[gateHistoryNewest] = y;
+    if (gateLearnCount == 0)
+        gateDc = y; // Start from the ambient level, not zero.
+    gateDc += (y - gateDc) / GATE_DC_TIME_CONSTANT;
+    double d = y - gateDc;
+    gateEnergy += (d * d - gateEnergy) / GATE_ENERGY_TIME_CONSTANT;
+
+    if (gateLearnCount < GATE_LEARN_COUNT) {
+        // Drop to any lower energy, so start-up transients are forgotten.
+        gateLearnCount++;
+        if (gateEnergy < gateFloor)
+            gateFloor = gateEnergy;
+        else
+            gateFloor += (gateEnergy - gateFloor) / GATE_FLOOR_TIME_CONSTANT;
+        gateFloor = fmax(gateFloor, GATE_MIN_FLOOR);
+        return true;
+    }
+    if (gateEnergy > gateFloor * GATE_OPEN_RATIO) {
+        gateQuietCount = 0;
+        return true;
+    }
+    gateFloor = fmax(gateFloor + (gateEnergy - gateFloor) / GATE_FLOOR_TIME_CONSTANT,
+                     GATE_MIN_FLOOR);
+    if (gateEnergy < gateFloor * GATE_CLOSE_RATIO)
+        gateQuietCount++;
+    else
+        gateQuietCount = 0;
+    return gateQuietCount < GATE_HANGOVER_COUNT;
+}
+
+// Starts learning the noise floors again.
+void initNoiseFloors() {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        noiseFloors[i] = NOISE_FLOOR_MIN;
+    }
+    noiseFloorLearnCount = 0;
+}
+
+// Moves each noise floor one step towards the 25th percentile of its power.
+void updateNoiseFloors(const double powerValues[]) {
+    if (noiseFloorLearnCount < NOISE_FLOOR_LEARN_COUNT) {
+        noiseFloorLearnCount++;
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            noiseFloors[i] = fmax(powerValues[i], NOISE_FLOOR_MIN);
+        }
+        return;
+    }
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        noiseFloors[i] *= (powerValues[i] > noiseFloors[i]) ? NOISE_FLOOR_RISE : NOISE_FLOOR_FALL;
+        noiseFloors[i] = fmax(noiseFloors[i], NOISE_FLOOR_MIN);
+    }
+}
+
+// Copies a full queue to values[], oldest first.
+void saveQueue(double values[], queue_t *q) {
+    queue_span_t span = queue_span(q);
+    memcpy(values, span.first, span.firstCount * sizeof(double));
+    memcpy(values + span.firstCount, span.second, span.secondCount * sizeof(double));
+}
+
+// Refills a queue from values[], written by saveQueue().
+void restoreQueue(const double values[], queue_t *q) {
+    queue_popMany(q, NULL, queue_elementCount(q));
+    queue_pushMany(q, values, queue_size(q));
+}
+
+// Copies the IIR state of one filter, for every engine, and its power state to
+// the snapshot. window[] holds stateWindowLength() slots.
+void saveFilterState(uint16_t i, filterState_t *state, double window[]) {
+    saveQueue(state->z, &(zQueues[i]));
+    for (uint32_t r = 0; r < 2 * IIR_HISTORY_ROW_COUNT; r++) {
+        state->iirHistory[r] = iirHistory[r][i];
+    }
+    state->iirHistoryRow = iirHistoryRow[i];
+    for (uint32_t k = 0; k < IIR_SECTION_COUNT; k++) {
+        state->iirSections[k][0] = iirSections[i][k].s[0];
+        state->iirSections[k][1] = iirSections[i][k].s[1];
+    }
+    saveQueue(window, &(outputQueues[i]));
+    state->currentPower = currentPowerValue[i];
+    state->oldestValue = oldest_value[i];
+    state->powerSum = powerSum[i];
+    state->powerCompensation = powerCompensation[i];
+    state->resyncSum = resyncSum[i];
+    state->resyncLength = resyncLength[i];
+    memcpy(state->blockSums, powerBlockSums[i], sizeof(state->blockSums));
+    state->blockNewest = powerBlockNewest[i];
+    state->blockFill = powerBlockFill[i];
+    state->fullBlockTotal = powerFullBlockTotal[i];
+    state->average = powerAverage[i];
+}
+
+// Refills the IIR state and power state of one filter from the snapshot
+// written by saveFilterState().
+void restoreFilterState(uint16_t i, const filterState_t *state, const double window[]) {
+    restoreQueue(state->z, &(zQueues[i]));
+    for (uint32_t r = 0; r < 2 * IIR_HISTORY_ROW_COUNT; r++) {
+        iirHistory[r][i] = state->iirHistory[r];
+    }
+    iirHistoryRow[i] = state->iirHistoryRow;
+    for (uint32_t k = 0; k < IIR_SECTION_COUNT; k++) {
+        iirSections[i][k].s[0] = state->iirSections[k][0];
+        iirSections[i][k].s[1] = state->iirSections[k][1];
+    }
+    restoreQueue(window, &(outputQueues[i]));
+    currentPowerValue[i] = state->currentPower;
+    oldest_value[i] = state->oldestValue;
+    powerSum[i] = state->powerSum;
+    powerCompensation[i] = state->powerCompensation;
+    resyncSum[i] = state->resyncSum;
+    resyncLength[i] = state->resyncLength;
+    memcpy(powerBlockSums[i], state->blockSums, sizeof(state->blockSums));
+    powerBlockNewest[i] = state->blockNewest;
+    powerBlockFill[i] = state->blockFill;
+    powerFullBlockTotal[i] = state->fullBlockTotal;
+    powerAverage[i] = state->average;
+    iirQuiescent[i] = false; // Set again once the filter has run.
+}
+
+// Zeros the run-time statistics of the FIR paths.
+void initFirStatistics() {
+    for (uint32_t i = 0; i < FIR_PATH_COUNT; i++) {
+        firPathCycles[i] = 0;
+        firPathCalls[i] = 0;
+    }
+    foldedComparisonCycles = 0;
+    genericComparisonCycles = 0;
+    firComparisonCount = 0;
+}
+
+// Runs the selected FIR kernel on the newest FIR_COEFF_COUNT inputs x[] of a
+// FIR path. Every FIR_COMPARISON_INTERVAL-th call of the folded kernel also
+// runs the generic kernel on the same inputs and times both, alternating which
+// runs first so neither always finds the inputs in the cache. Returns the
+// folded output, and in *comparisonCycles the cycles of the generic kernel,
+// which the path must not count.
+double runFirKernel(uint32_t path, const double x[], uint64_t *comparisonCycles) {
+    *comparisonCycles = 0;
+    if (!firCoeffsSymmetric)
+        return firFilterGeneric(x);
+    if (firPathCalls[path] % FIR_COMPARISON_INTERVAL != 0)
+        return firFilterFolded(x);
+
+    double y = 0.0;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        uint64_t startCycles = cycleCounter_read();
+        if ((pass + firComparisonCount) % 2 == 0) {
+            y = firFilterFolded(x);
+            foldedComparisonCycles += cycleCounter_read() - startCycles;
+        } else {
+            firComparisonSink = firFilterGeneric(x);
+            *comparisonCycles = cycleCounter_read() - startCycles;
+            genericComparisonCycles += *comparisonCycles;
+        }
+    }
+    firComparisonCount++;
+    return y;
+}
+
+// Adds one call of a FIR path to the run-time statistics.
+void addFirCall(uint32_t path, uint64_t cycles) {
+    firPathCycles[path] += cycles;
+    firPathCalls[path]++;
+}
+
+// Returns the average cycles per call of a FIR path, or 0 if it was not used.
+double firCyclesPerCall(uint32_t path) {
+    return firPathCalls[path] ? (double)firPathCycles[path] / firPathCalls[path] : 0.0;
+}
+
 // 1. First filter is a decimating FIR filter with a configurable number of taps
 // and decimation factor.
-// 2. The output from the decimating FIR filter is passed through a bank of 10
-// IIR filters. The characteristics of the IIR filter are fixed.
+// 2. The output from the decimating FIR filter is passed through a bank of
+// FILTER_FREQUENCY_COUNT IIR filters. The characteristics of the IIR filter are fixed.
 
 /******************************************************************************
 ***** Main Filter Functions
@@ -112,56 +1100,513 @@ void initOutputQueues() {
 // Must call this prior to using any filter functions.
 void filter_init()
 {
+#ifdef FILTER_REDUCED_PRECISION
+  powerEstimator = filter_boxcarPower_e; // filterFixed.c or filterFloat.c keeps the window.
+#else
+  powerEstimator = requestedPowerEstimator;
+#endif
+#ifndef FILTER_REDUCED_PRECISION
   // Init queues and fill them with zeros.
   initXQueue();  // Call queue_init() on xQueue and fill it with zeros.
   initYQueue();  // Call queue_init() on yQueue and fill it with zeros.
   initZQueues(); // Call queue_init() on all of the zQueues and fill each z queue with zeros.
   initOutputQueues();  // Call queue_init() on all of the outputQueues and fill each outputQueue with zeros.
+#endif
+  initFirBlockHistory(); // Zero the input history used by filter_firFilterBlock().
+  initPowerEstimator(); // Zero the block-sum and exponential power estimators.
+  initBoxcarPower(); // Zero the running boxcar power and the drift statistics.
+  pendingCount = 0; // Discard any partial block left by filter_processBlock().
+#ifdef FILTER_REDUCED_PRECISION
+  energyGateEnabled = false; // The chain keeps its own yQueue.
+#else
+  energyGateEnabled = requestedEnergyGate;
+#endif
+  initEnergyGate(); // Open the gate and zero its statistics.
+  initNoiseFloors(); // Learn the noise floors from the next outputs.
+  denormalGuard = requestedDenormalGuard;
+  setFlushToZero(denormalGuard); // Keep decaying IIR states out of subnormals.
+  initIirNumerators(); // Find zero B taps and a shared numerator.
+  initIirHistory(); // Zero the history used by filter_interleavedEngine_e.
+  engine = requestedEngine;
+  if (engine == filter_biquadEngine_e)
+      initIirSections(); // Factor the IIR filters and zero their state.
+  if (isDftEngine(engine))
+      initDft(); // Set up the power measurement in dft.c.
+  firCoeffsSymmetric = isFirSymmetric(); // Use the folded FIR kernel if possible.
+#ifdef FILTER_REDUCED_PRECISION
+  frontEnd = filter_firFrontEnd_e; // Neither chain has a CIC front end.
+#else
+  frontEnd = requestedFrontEnd;
+#endif
+  if (frontEnd == filter_cicFrontEnd_e && !initCicFrontEnd()) {
+#ifdef FILTER_CIC_IN_ISR
+      // isr_function() already decimates, so the FIR front end can't take over.
+      printf("filter_init(): the CIC decimator could overflow, and "
+             "FILTER_CIC_IN_ISR needs it.\n");
+      assert(false);
+#endif
+      printf("filter_init(): the CIC decimator could overflow, using the FIR "
+             "front end.\n");
+      frontEnd = filter_firFrontEnd_e;
+  }
+  initFirStatistics(); // Zero the FIR cycle counts.
+#if defined(FILTER_FIXED_POINT)
+  if (!filterFixed_init()) {
+      printf("filter_init(): the IIR filters can't be factored into biquads for "
+             "FILTER_FIXED_POINT.\n");
+      assert(false);
+  }
+#elif defined(FILTER_SINGLE_PRECISION)
+  filterFloat_init();
+#endif
+  if (warmStartState != NULL && !filter_restoreState(warmStartState))
+      printf("filter_init(): the warm-start state does not match the engine "
+             "and power estimator, starting from zero.\n");
+}
+
+// Selects how filter_firFilterBlock() low-passes and decimates, starting with
+// the next filter_init().
+void filter_setFrontEnd(filter_frontEnd_t newFrontEnd)
+{
+    requestedFrontEnd = newFrontEnd;
+}
+
+// Returns the front end selected by the last filter_init().
+filter_frontEnd_t filter_getFrontEnd()
+{
+    return frontEnd;
+}
+
+// Selects how filter_iirFilter() runs the IIR filters, starting with the next
+// filter_init().
+void filter_setEngine(filter_engine_t newEngine)
+{
+    requestedEngine = newEngine;
+}
+
+// Returns the engine selected by the last filter_init().
+filter_engine_t filter_getEngine()
+{
+    return engine;
+}
+
+// Selects how filter_computePower() measures power, starting with the next
+// filter_init().
+void filter_setPowerEstimator(filter_powerEstimator_t estimator)
+{
+    requestedPowerEstimator = estimator;
+}
+
+// Returns the power estimator selected by the last filter_init().
+filter_powerEstimator_t filter_getPowerEstimator()
+{
+    return powerEstimator;
+}
+
+// Returns the bytes in the arena plus the boxcar windows, if allocated.
+uint32_t filter_getStorageSize()
+{
+    uint32_t size = sizeof(arena);
+#ifndef FILTER_REDUCED_PRECISION
+    if (boxcarWindowData != NULL)
+        size += FILTER_FREQUENCY_COUNT * BOXCAR_WINDOW_STORAGE_SIZE * sizeof(queue_data_t);
+#endif
+    return size;
+}
+
+// Returns the size, in bytes, of a snapshot for the engine and power estimator
+// selected by the last filter_init(), or 0 if filter_saveState() can't save it.
+uint32_t filter_getStateSize()
+{
+#ifdef FILTER_REDUCED_PRECISION
+    return 0;
+#else
+    if (isDftEngine(engine) || frontEnd == filter_cicFrontEnd_e)
+        return 0;
+    return sizeof(filter_state_t) +
+           FILTER_FREQUENCY_COUNT * stateWindowLength(powerEstimator) * sizeof(double);
+#endif
+}
+
+// Copies the filter state to a snapshot of filter_getStateSize() bytes.
+// Returns false, and writes nothing, for the engines built on dft.c, the CIC
+// front end and the fixed-point chain.
+bool filter_saveState(filter_state_t *state)
+{
+    uint32_t size = filter_getStateSize();
+    if (size == 0)
+        return false;
+#ifndef FILTER_REDUCED_PRECISION
+    state->size = size;
+    state->engine = engine;
+    state->powerEstimator = powerEstimator;
+    saveQueue(state->x, &xQueue);
+    memcpy(state->firBlock, &firBlockHistory[firBlockNext], sizeof(state->firBlock));
+    saveQueue(state->y, &yQueue);
+    state->gateDc = gateDc;
+    state->gateEnergy = gateEnergy;
+    state->gateFloor = gateFloor;
+    state->gateLearnCount = gateLearnCount;
+    state->gateQuietCount = gateQuietCount;
+    uint32_t windowLength = stateWindowLength(powerEstimator);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        saveFilterState(i, &(state->filters[i]), &(state->windows[i * windowLength]));
+    }
+#endif
+    return true;
+}
+
+// Replaces the filter state with a snapshot from filter_saveState(). Returns
+// false, and changes nothing, if the snapshot was taken with another engine or
+// power estimator than the last filter_init() selected, or with the CIC front
+// end.
+bool filter_restoreState(const filter_state_t *state)
+{
+    uint32_t size = filter_getStateSize();
+    if (size == 0 || state->size != size || state->engine != engine ||
+        state->powerEstimator != powerEstimator)
+        return false;
+#ifndef FILTER_REDUCED_PRECISION
+    restoreQueue(state->x, &xQueue);
+    memcpy(firBlockHistory, state->firBlock, sizeof(state->firBlock));
+    memcpy(&firBlockHistory[FIR_COEFF_COUNT], state->firBlock, sizeof(state->firBlock));
+    firBlockNext = 0; // The snapshot holds the inputs oldest first.
+    restoreQueue(state->y, &yQueue);
+    gateDc = state->gateDc;
+    gateEnergy = state->gateEnergy;
+    gateFloor = state->gateFloor;
+    gateLearnCount = state->gateLearnCount;
+    gateQuietCount = state->gateQuietCount;
+    gateSkippedCount = 0; // The IIR filters are up to date with yQueue.
+    for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++) {
+        gateHistoryNewest = (gateHistoryNewest + 1 == GATE_HISTORY_SIZE) ? 0 : gateHistoryNewest + 1;
+        gateHistory[gateHistoryNewest] = queue_fastReadElementAt(&yQueue, i);
+    }
+    uint32_t windowLength = stateWindowLength(powerEstimator);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        restoreFilterState(i, &(state->filters[i]), &(state->windows[i * windowLength]));
+        noiseFloors[i] = fmax(currentPowerValue[i], NOISE_FLOOR_MIN);
+    }
+    noiseFloorLearnCount = NOISE_FLOOR_LEARN_COUNT; // The snapshot's power is the floor.
+    pendingCount = 0; // Discard any partial block left by filter_processBlock().
+#endif
+    return true;
+}
+
+// Makes filter_init() restore state (a snapshot from filter_saveState()), or
+// start from zero if state is NULL.
+void filter_setWarmStart(const filter_state_t *state)
+{
+    warmStartState = state;
+}
+
+// Turns flush-to-zero and the snap of decayed IIR filters to zero on or off,
+// starting with the next filter_init().
+void filter_setDenormalGuard(bool enabled)
+{
+    requestedDenormalGuard = enabled;
+}
+
+// Turns the energy gate in filter_processBlock() on or off, starting with the
+// next filter_init().
+void filter_setEnergyGate(bool enabled)
+{
+    requestedEnergyGate = enabled;
+}
+
+// Returns true if the last filter_init() turned the energy gate on.
+bool filter_getEnergyGate()
+{
+    return energyGateEnabled;
 }
 
 // Use this to copy an input into the input queue of the FIR-filter (xQueue).
 void filter_addNewInput(double x)
 {
-    queue_overwritePush(&xQueue, x);
+#if defined(FILTER_FIXED_POINT)
+    filterFixed_addNewInput(filterFixed_inputFromDouble(x));
+#elif defined(FILTER_SINGLE_PRECISION)
+    filterFloat_addNewInput(x);
+#else
+    queue_fastOverwritePush(&xQueue, x);
+#endif
 }
 
 // Invokes the FIR-filter. Input is contents of xQueue.
 // Output is returned and is also pushed on to yQueue.
 double filter_firFilter()
 {
-    double y = 0.0;
+    uint64_t startCycles = cycleCounter_read();
+    uint64_t comparisonCycles = 0;
+#if defined(FILTER_FIXED_POINT)
+    double y = filterFixed_firOutputToDouble(filterFixed_firFilter());
+#elif defined(FILTER_SINGLE_PRECISION)
+    double y = filterFloat_firFilter();
+#else
+    double y = runFirKernel(FIR_SAMPLE_PATH, queue_fastWindow(&xQueue, FIR_COEFF_COUNT),
+                            &comparisonCycles);
+#endif
+    addFirCall(FIR_SAMPLE_PATH, cycleCounter_read() - startCycles - comparisonCycles);
 
-    // This for-loop performs the identical computation to that shown above.
-    for (uint32_t i=0; i < FIR_COEFF_COUNT; i++) { // iteratively adds the (b * input) products.
-        y += queue_readElementAt(&xQueue, ((FIR_COEFF_COUNT - 1) - i)) * fir_b_coeffs[i];
-    }
+#ifndef FILTER_REDUCED_PRECISION
+    queue_fastOverwritePush(&yQueue, y);
+#endif
 
-    queue_overwritePush(&yQueue, y);
+    return y;
+}
+
+// Converts a raw ADC value (0 to FILTER_ADC_MAX_VALUE) to a filter input
+// (-1.0 to 1.0).
+double filter_scaleAdcValue(buffer_data_t rawAdcValue)
+{
+    return ((double)rawAdcValue / FILTER_ADC_MAX_VALUE) * ADC_SCALAR - ADC_OFFSET;
+}
+
+// Runs the decimating FIR filter on a block of FILTER_FIR_DECIMATION_FACTOR raw
+// ADC values (oldest first) and produces the output for the newest one, exactly
+// as if each value had been scaled, passed to filter_addNewInput() and followed
+// by filter_firFilter(). Output is returned and is also pushed on to yQueue.
+double filter_firFilterBlock(const buffer_data_t rawAdcBlock[])
+{
+    uint64_t startCycles = cycleCounter_read();
+    uint64_t comparisonCycles = 0;
+    uint32_t path = FIR_BLOCK_PATH;
+#if defined(FILTER_FIXED_POINT)
+    for (uint32_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+        filterFixed_addNewInput(filterFixed_inputFromDouble(filter_scaleAdcValue(rawAdcBlock[i])));
+    }
+    double y = filterFixed_firOutputToDouble(filterFixed_firFilter());
+#elif defined(FILTER_SINGLE_PRECISION)
+    for (uint32_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+        filterFloat_addNewInput(filter_scaleAdcValue(rawAdcBlock[i]));
+    }
+    double y = filterFloat_firFilter();
+#else
+    double y;
+    if (frontEnd == filter_cicFrontEnd_e) {
+        path = FIR_CIC_PATH;
+        y = cicFilterBlock(rawAdcBlock);
+    } else {
+        y = runFirKernel(FIR_BLOCK_PATH, addFirBlock(rawAdcBlock), &comparisonCycles);
+    }
+    queue_fastOverwritePush(&yQueue, y);
+#endif
+    addFirCall(path, cycleCounter_read() - startCycles - comparisonCycles);
 
     return y;
 }
 
+// Runs the IIR filters and the power computation on the newest yQueue value,
+// and adds the new power values to the block summary. The hit test sees the
+// noise floors from before this output.
+void processNewestOutput(filter_hitTest_t hitTest, filter_blockResult_t *result) {
+    filter_iirFilterBank();
+
+    double powerValues[FILTER_FREQUENCY_COUNT];
+    uint16_t maxIndex = 0;
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
+        powerValues[filterNumber] = filter_computePower(filterNumber, false, false);
+        if (powerValues[filterNumber] > powerValues[maxIndex])
+            maxIndex = filterNumber;
+    }
+    if (result->outputCount == 0 || powerValues[maxIndex] > result->maxPower) {
+        result->maxPower = powerValues[maxIndex];
+        result->maxPowerFilterNumber = maxIndex;
+    }
+    if (hitTest && !result->thresholdCrossed && hitTest(powerValues)) {
+        result->thresholdCrossed = true;
+        result->crossingOutputIndex = result->outputCount;
+        result->crossingFilterNumber = maxIndex;
+    }
+    updateNoiseFloors(powerValues);
+}
+
+// Runs the IIR filters and power on the newest replayCount FIR outputs in the
+// gate history, oldest first, after refilling yQueue with the outputs before
+// them. The IIR filters and power carry on from where they stopped.
+void replayGateHistory(uint32_t replayCount, filter_hitTest_t hitTest,
+                       filter_blockResult_t *result) {
+    for (uint32_t age = replayCount + Y_QUEUE_SIZE - 1; age > 0; age--) {
+        queue_fastOverwritePush(&yQueue, readGateHistory(age - 1));
+        if (age <= replayCount)
+            processNewestOutput(hitTest, result);
+    }
+}
+
+// Runs the IIR filters and the power computation on the newest FIR output y,
+// already on yQueue, unless the energy gate is idle.
+void processFirOutput(double y, filter_hitTest_t hitTest, filter_blockResult_t *result) {
+    if (!energyGateEnabled) {
+        processNewestOutput(hitTest, result);
+        result->outputCount++;
+        return;
+    }
+    gateOutputCount++;
+    if (!updateEnergyGate(y)) {
+        gateSkippedCount++;
+        gateIdleCount++;
+    } else if (gateSkippedCount == 0) {
+        processNewestOutput(hitTest, result);
+    } else {
+        // The gate just opened: run the skipped outputs that may hold the
+        // start of a shot, then this one.
+        uint32_t replayCount = (gateSkippedCount < GATE_LOOKBACK_COUNT) ? gateSkippedCount + 1
+                                                                        : GATE_LOOKBACK_COUNT;
+        gateIdleCount -= replayCount - 1;
+        gateSkippedCount = 0;
+        replayGateHistory(replayCount, hitTest, result);
+    }
+    result->outputCount++;
+}
+
+// Runs one full block through the FIR filter and the rest of the chain.
+void processFullBlock(const buffer_data_t rawAdcBlock[], filter_hitTest_t hitTest,
+                      filter_blockResult_t *result) {
+    processFirOutput(filter_firFilterBlock(rawAdcBlock), hitTest, result);
+}
+
+// Clears the summary written by filter_processBlock().
+void initBlockResult(filter_blockResult_t *result) {
+    result->outputCount = 0;
+    result->maxPower = 0.0;
+    result->maxPowerFilterNumber = 0;
+    result->thresholdCrossed = false;
+    result->crossingOutputIndex = 0;
+    result->crossingFilterNumber = 0;
+}
+
+// Runs sampleCount raw ADC values through scaling, the FIR filter, the IIR
+// filters and power in one pass, a block at a time.
+void filter_processBlock(const buffer_data_t samples[], uint32_t sampleCount,
+                         filter_hitTest_t hitTest, filter_blockResult_t *result)
+{
+    initBlockResult(result);
+
+    uint32_t i = 0;
+    // Finish the block left over from the last call.
+    if (pendingCount > 0) {
+        while (pendingCount < FILTER_FIR_DECIMATION_FACTOR && i < sampleCount) {
+            pendingBlock[pendingCount++] = samples[i++];
+        }
+        if (pendingCount < FILTER_FIR_DECIMATION_FACTOR)
+            return;
+        processFullBlock(pendingBlock, hitTest, result);
+        pendingCount = 0;
+    }
+    // Full blocks are read in place.
+    for (; i + FILTER_FIR_DECIMATION_FACTOR <= sampleCount; i += FILTER_FIR_DECIMATION_FACTOR) {
+        processFullBlock(&samples[i], hitTest, result);
+    }
+    // Keep the rest for the next call.
+    while (i < sampleCount) {
+        pendingBlock[pendingCount++] = samples[i++];
+    }
+}
+
+// Runs outputCount FIR outputs (oldest first) that were decimated elsewhere
+// through the IIR filters and power, as filter_processBlock() does after its
+// FIR filter.
+void filter_processFirOutputs(const double firOutputs[], uint32_t outputCount,
+                              filter_hitTest_t hitTest, filter_blockResult_t *result)
+{
+    initBlockResult(result);
+#ifndef FILTER_REDUCED_PRECISION
+    for (uint32_t i = 0; i < outputCount; i++) {
+        queue_fastOverwritePush(&yQueue, firOutputs[i]);
+        processFirOutput(firOutputs[i], hitTest, result);
+    }
+#endif
+}
+
+// Runs outputCount CIC decimator outputs (oldest first) through the
+// compensator, then the IIR filters and power.
+void filter_processCicBlock(const buffer_data_t cicOutputs[], uint32_t outputCount,
+                            filter_hitTest_t hitTest, filter_blockResult_t *result)
+{
+    initBlockResult(result);
+#ifndef FILTER_REDUCED_PRECISION
+    assert(frontEnd == filter_cicFrontEnd_e); // Reported by filter_init().
+    if (frontEnd != filter_cicFrontEnd_e)
+        return;
+    for (uint32_t i = 0; i < outputCount; i++) {
+        uint64_t startCycles = cycleCounter_read();
+        double y = compensateCicOutput(cicOutputs[i]);
+        addFirCall(FIR_CIC_PATH, cycleCounter_read() - startCycles);
+        queue_fastOverwritePush(&yQueue, y);
+        processFirOutput(y, hitTest, result);
+    }
+#endif
+}
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
 double filter_iirFilter(uint16_t filterNumber)
 {
-    double y = 0.0;
-    double z = 0.0;
-
-    for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++) {
-        y += queue_readElementAt(&yQueue, (Y_QUEUE_SIZE - i - 1)) * iir_b_coeffs[filterNumber][i];
+#ifdef FILTER_REDUCED_PRECISION
+#ifdef FILTER_FIXED_POINT
+    double z = filterFixed_iirOutputToDouble(filterFixed_iirFilter(filterNumber));
+#else
+    double z = filterFloat_iirFilter(filterNumber);
+#endif
+    return z;
+#else
+    // The engines built on dft.c only run through filter_iirFilterBank().
+    assert(!isDftEngine(engine));
+    if (engine == filter_biquadEngine_e) {
+        float x = (float)queue_fastReadNewest(&yQueue);
+        double z = biquad_runFloatCascade(iirSections[filterNumber], IIR_SECTION_COUNT, x);
+        queue_fastOverwritePush(&(outputQueues[filterNumber]), z);
+        return z;
     }
 
-    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
-        z += queue_readElementAt(&(zQueues[filterNumber]), (Z_QUEUE_SIZE - i - 1)) * iir_a_coeffs[filterNumber][i];
-    }
+    double y = iirFeedForward(filterNumber);
 
-    z = y - z;
+    if (engine == filter_interleavedEngine_e)
+        return iirFilterInterleaved(filterNumber, y);
+    return iirFilterFeedback(filterNumber, y);
+#endif
+}
 
-    queue_overwritePush(&(outputQueues[filterNumber]), z);
-    queue_overwritePush(&(zQueues[filterNumber]), z);
+// Runs every IIR filter on the newest yQueue value, like calling
+// filter_iirFilter() for each filter number. If all filters share a
+// numerator, the feed-forward sum is computed once and scaled per filter.
+// The interleaved engine steps all filters together. The engines built on
+// dft.c add the value to their power measurement instead.
+void filter_iirFilterBank()
+{
+#ifndef FILTER_REDUCED_PRECISION
+    if (engine == filter_goertzelEngine_e) {
+        dft_goertzelAddSample(queue_fastReadNewest(&yQueue));
+        return;
+    }
+    if (engine == filter_slidingDftEngine_e) {
+        dft_slidingAddSample(queue_fastReadNewest(&yQueue));
+        return;
+    }
+    if (engine == filter_channelizerEngine_e) {
+        dft_channelizerAddSample(queue_fastReadNewest(&yQueue));
+        return;
+    }
+    if (engine != filter_biquadEngine_e) {
+        double y[FILTER_FREQUENCY_COUNT];
+        iirFeedForwardBank(y);
 
-    return z;
+        if (engine == filter_interleavedEngine_e && iirHistoryRowsAligned()) {
+            iirFilterInterleavedBank(y);
+            return;
+        }
+        for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
+            if (engine == filter_interleavedEngine_e)
+                iirFilterInterleaved(filterNumber, y[filterNumber]);
+            else
+                iirFilterFeedback(filterNumber, y[filterNumber]);
+        }
+        return;
+    }
+#endif
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT; filterNumber++) {
+        filter_iirFilter(filterNumber);
+    }
 }
 
 
@@ -177,25 +1622,60 @@ double filter_iirFilter(uint16_t filterNumber)
 // 3. Get the newest value from the power queue, call this newest-power-value.
 // 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
 // (newest-value * newest-value). Note that this function will probably need an
-// array to keep track of these values for each of the 10 output queues.
+// array to keep track of these values for each of the output queues.
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
                            bool debugPrint)
 {
+#if defined(FILTER_FIXED_POINT)
+    currentPowerValue[filterNumber] = filterFixed_powerToDouble(
+        filterFixed_computePower(filterNumber, forceComputeFromScratch));
+#elif defined(FILTER_SINGLE_PRECISION)
+    currentPowerValue[filterNumber] =
+        filterFloat_computePower(filterNumber, forceComputeFromScratch);
+#else
+    if (engine == filter_goertzelEngine_e) {
+        currentPowerValue[filterNumber] = dft_getGoertzelPower(filterNumber);
+        return currentPowerValue[filterNumber];
+    }
+    if (engine == filter_slidingDftEngine_e) {
+        currentPowerValue[filterNumber] = dft_getSlidingPower(filterNumber);
+        return currentPowerValue[filterNumber];
+    }
+    if (engine == filter_channelizerEngine_e) {
+        currentPowerValue[filterNumber] = dft_getChannelizerPower(filterNumber);
+        return currentPowerValue[filterNumber];
+    }
+    if (powerEstimator != filter_boxcarPower_e) {
+        // The output queue holds only the newest output.
+        currentPowerValue[filterNumber] =
+            estimatePower(filterNumber, queue_fastReadElementAt(&outputQueues[filterNumber], 0));
+        return currentPowerValue[filterNumber];
+    }
     if (forceComputeFromScratch) {
         double power = 0;
 
-        for (double i = 0; i < queue_elementCount(&outputQueues[filterNumber]); i++) {
-            power += pow(queue_readElementAt(&outputQueues[filterNumber], i), 2);
+        // Oldest first, as element by element, so the sum is unchanged.
+        queue_span_t span = queue_span(&outputQueues[filterNumber]);
+        for (uint32_t i = 0; i < span.firstCount; i++) {
+            power += span.first[i] * span.first[i];
+        }
+        for (uint32_t i = 0; i < span.secondCount; i++) {
+            power += span.second[i] * span.second[i];
         }
 
-        currentPowerValue[filterNumber] = power;
+        setBoxcarPower(filterNumber, power);
     } else {
-        currentPowerValue[filterNumber] = currentPowerValue[filterNumber] - 
-            pow(oldest_value[filterNumber], 2) +
-            pow(queue_readElementAt(&outputQueues[filterNumber], (queue_elementCount(&outputQueues[filterNumber]) - 1)), 2);
+        // Compensated add and subtract, plus a slice of the from-scratch resync.
+        double newest = queue_fastReadNewest(&outputQueues[filterNumber]);
+        addCompensated(&powerSum[filterNumber], &powerCompensation[filterNumber], newest * newest);
+        addCompensated(&powerSum[filterNumber], &powerCompensation[filterNumber],
+                       -(oldest_value[filterNumber] * oldest_value[filterNumber]));
+        resyncBoxcarPower(filterNumber);
     }
+    currentPowerValue[filterNumber] = powerSum[filterNumber] + powerCompensation[filterNumber];
 
-    oldest_value[filterNumber] = queue_readElementAt(&outputQueues[filterNumber], 0); // Store the oldest output value for next loop
+    oldest_value[filterNumber] = queue_fastReadElementAt(&outputQueues[filterNumber], 0); // Store the oldest output value for next loop
+#endif
 
     return currentPowerValue[filterNumber];
 }
@@ -212,6 +1692,17 @@ double filter_getCurrentPowerValue(uint16_t filterNumber)
 void filter_setCurrentPowerValue(uint16_t filterNumber, double value)
 {
     currentPowerValue[filterNumber] = value;
+#ifndef FILTER_REDUCED_PRECISION
+    setBoxcarPower(filterNumber, value); // Incremental updates start from here.
+#endif
+}
+
+// Copies the noise floor of each channel.
+void filter_getNoiseFloors(double floors[])
+{
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        floors[i] = noiseFloors[i];
+    }
 }
 
 // Get a copy of the current power values.
@@ -259,6 +1750,46 @@ void filter_getNormalizedPowerValues(double normalizedArray[],
 }
 
 
+/******************************************************************************
+***** Run-Time Statistics
+******************************************************************************/
+
+// Returns true if filter_firFilter() is using the folded symmetric kernel.
+bool filter_isFirFolded()
+{
+    return firCoeffsSymmetric;
+}
+
+// Copies the FIR cost of each path, and of the folded kernel against the
+// generic one, gathered since filter_init().
+void filter_getFirStatistics(filter_firStatistics_t *statistics)
+{
+    statistics->sampleCallCount = firPathCalls[FIR_SAMPLE_PATH];
+    statistics->sampleCyclesPerCall = firCyclesPerCall(FIR_SAMPLE_PATH);
+    statistics->blockCallCount = firPathCalls[FIR_BLOCK_PATH];
+    statistics->blockCyclesPerCall = firCyclesPerCall(FIR_BLOCK_PATH);
+    statistics->cicCallCount = firPathCalls[FIR_CIC_PATH];
+    statistics->cicCyclesPerCall = firCyclesPerCall(FIR_CIC_PATH);
+    statistics->comparisonCount = firComparisonCount;
+    statistics->foldedCyclesPerCall =
+        firComparisonCount ? (double)foldedComparisonCycles / firComparisonCount : 0.0;
+    statistics->genericCyclesPerCall =
+        firComparisonCount ? (double)genericComparisonCycles / firComparisonCount : 0.0;
+}
+
+// Copies the boxcar power drift statistics gathered since filter_init().
+void filter_getPowerDriftStatistics(filter_powerDriftStatistics_t *statistics)
+{
+    *statistics = driftStatistics;
+}
+
+// Returns the fraction of filter_processBlock() outputs since filter_init() for
+// which the energy gate skipped the IIR filters and power.
+double filter_getIdleFraction()
+{
+    return gateOutputCount ? (double)gateIdleCount / gateOutputCount : 0.0;
+}
+
 /******************************************************************************
 ***** Verification-Assisting Functions
 ***** External test functions access the internal data structures of filter.c
@@ -277,6 +1808,12 @@ uint32_t filter_getFirCoefficientCount()
     return FIR_COEFF_COUNT;
 }
 
+// Returns the coefficients of the CIC compensator.
+const double *filter_getCicCompensatorCoefficientArray()
+{
+    return cicCompensatorCoeffs;
+}
+
 // Returns the array of a coefficients for a particular filter number.
 const double *filter_getIirACoefficientArray(uint16_t filterNumber)
 {
@@ -286,7 +1823,7 @@ const double *filter_getIirACoefficientArray(uint16_t filterNumber)
 // Returns the number of A coefficients.
 uint32_t filter_getIirACoefficientCount()
 {
-    return FILTER_FIR_DECIMATION_FACTOR;
+    return IIR_A_COEFF_COUNT;
 }
 
 // Returns the array of b coefficients for a particular filter number.
@@ -298,7 +1835,7 @@ const double *filter_getIirBCoefficientArray(uint16_t filterNumber)
 // Returns the number of B coefficients.
 uint32_t filter_getIirBCoefficientCount()
 {
-    return FILTER_FIR_DECIMATION_FACTOR;
+    return IIR_B_COEFF_COUNT;
 }
 
 // Returns the size of the yQueue.
@@ -328,6 +1865,7 @@ queue_t *filter_getYQueue()
 // Returns the address of zQueue for a specific filter number.
 queue_t *filter_getZQueue(uint16_t filterNumber)
 {
+    iirQuiescent[filterNumber] = false; // The caller may write to it.
     return &(zQueues[filterNumber]);
 }
 
@@ -12,8 +12,17 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include <stdint.h>
 
+#include "buffer.h"
+#include "interrupts.h"
 #include "queue.h"
 
+// Define FILTER_GENERATED_COEFFICIENTS (the build does this when FILTER_PLAN is
+// set, see lasertag/CMakeLists.txt) to take the sizes below and all of the
+// coefficient tables from filterCoefficients.h, written by
+// tools/filterDesign/filterDesignTool.c.
+#ifdef FILTER_GENERATED_COEFFICIENTS
+#include "filterCoefficients.h"
+#else
 #define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
 #define FILTER_FREQUENCY_COUNT 10
 #define FILTER_FIR_DECIMATION_FACTOR                                           \
@@ -21,28 +30,240 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define FILTER_INPUT_PULSE_WIDTH                                               \
   2000 // This is the width of the pulse you are looking for, in terms of
        // decimated sample count.
+#define FILTER_FIR_COEFFICIENT_COUNT 81
+#define FILTER_IIR_ORDER 10 // Each IIR filter has this many poles and zeros.
+#define FILTER_GENERATED_TICK_TABLE {68, 58, 50, 44, 38, 34, 30, 28, 26, 24}
+#endif
+#define FILTER_ADC_MAX_VALUE 4095 // Largest raw value from the ADC.
+
+// Uncomment to run the filter chain in integer arithmetic (see filterFixed.h).
+// filterFixed.c then keeps the only copy of the filter history: xQueue, yQueue,
+// the zQueues and the outputQueues are not set up, and filter_runTest() skips
+// the tests that check the double arithmetic through them.
+// #define FILTER_FIXED_POINT
+// Uncomment to run the filter chain in single precision (see filterFloat.h),
+// in the same way as FILTER_FIXED_POINT.
+// #define FILTER_SINGLE_PRECISION
+#if defined(FILTER_FIXED_POINT) && defined(FILTER_SINGLE_PRECISION)
+#error "Define at most one of FILTER_FIXED_POINT and FILTER_SINGLE_PRECISION."
+#endif
+// Defined when the filter chain runs in filterFixed.c or filterFloat.c instead
+// of in double precision in filter.c.
+#if defined(FILTER_FIXED_POINT) || defined(FILTER_SINGLE_PRECISION)
+#define FILTER_REDUCED_PRECISION
+#endif
+// detector() combines several sensors with diversity.c, which runs the double
+// FIR in filter.c.
+#if defined(FILTER_REDUCED_PRECISION) && INTERRUPTS_XADC_SENSOR_COUNT > 1
+#error "FILTER_FIXED_POINT and FILTER_SINGLE_PRECISION take a single sensor (INTERRUPTS_XADC_SENSOR_COUNT)."
+#endif
+// Uncomment to run the CIC decimator (see filter_setFrontEnd()) in
+// isr_function(), so only every FILTER_FIR_DECIMATION_FACTOR-th value enters
+// the ADC buffer and detector() passes them to filter_processCicBlock().
+// runningModes_initAll() then selects the CIC front end. Not used with several
+// sensors (INTERRUPTS_XADC_SENSOR_COUNT).
+// #define FILTER_CIC_IN_ISR
+#if defined(FILTER_CIC_IN_ISR) && defined(FILTER_REDUCED_PRECISION)
+#error "FILTER_CIC_IN_ISR needs the CIC front end of the double-precision chain."
+#endif
+// Length of a Cortex-A9 L1 data-cache line, in bytes. filter.c aligns its
+// coefficient tables and its state to it.
+#define FILTER_CACHE_LINE_SIZE 32
 // These are the tick counts that are used to generate the user frequencies.
 // Not used in filter.h but are used to TEST the filter code.
 // Placed here for general access as they are essentially constant throughout
 // the code. The transmitter will also use these.
-static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
-    68, 58, 50, 44, 38, 34, 30, 28, 26, 24};
+static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] =
+    FILTER_GENERATED_TICK_TABLE;
+
+// Ways to low-pass and decimate the raw ADC values. See filter_setFrontEnd().
+typedef enum {
+  filter_firFrontEnd_e, // FILTER_FIR_COEFFICIENT_COUNT-tap decimating FIR.
+  filter_cicFrontEnd_e  // CIC decimator plus a short compensation FIR (cic.h).
+} filter_frontEnd_t;
+
+// Ways to run the bank of IIR filters. See filter_setEngine().
+typedef enum {
+  filter_directFormEngine_e, // 10th-order direct form in double precision.
+  filter_biquadEngine_e,     // Five single-precision biquads per filter.
+  filter_interleavedEngine_e, // Direct form with the history of all filters
+                              // interleaved, so filter_iirFilterBank() can
+                              // step every filter in one loop.
+  filter_goertzelEngine_e,    // Goertzel power over short blocks (see dft.h).
+  filter_slidingDftEngine_e,  // Sliding-DFT power over the pulse width.
+  filter_channelizerEngine_e  // One FFT per short block for all frequencies,
+                              // for large FILTER_FREQUENCY_COUNT.
+} filter_engine_t;
+
+// Ways to measure the power of each IIR filter output. See
+// filter_setPowerEstimator().
+typedef enum {
+  filter_boxcarPower_e,      // Exact sum of the last FILTER_INPUT_PULSE_WIDTH
+                             // squared outputs, kept in 2000-deep queues.
+  filter_blockSumPower_e,    // Sum over blocks of 100 outputs, covering the
+                             // last 1900 to 1999 outputs.
+  filter_exponentialPower_e  // Exponential moving average of squared outputs,
+                             // scaled to match the boxcar in steady state.
+} filter_powerEstimator_t;
+
+// How far the incremental boxcar power had drifted from an exact recomputation,
+// over all filters. See filter_getPowerDriftStatistics().
+typedef struct {
+  uint32_t resyncCount;     // Exact recomputations that replaced a running sum.
+  double maxAbsoluteDrift;  // Largest |running sum - exact sum| found.
+  double maxRelativeDrift;  // Largest drift divided by the exact sum.
+  double lastAbsoluteDrift; // Drift found by the most recent recomputation.
+} filter_powerDriftStatistics_t;
+
+// Cost of the FIR filter since filter_init(), in cycleCounter counts, for each
+// path into the IIR filters. See filter_getFirStatistics().
+typedef struct {
+  uint32_t sampleCallCount;    // filter_firFilter() calls.
+  double sampleCyclesPerCall;
+  uint32_t blockCallCount;     // filter_firFilterBlock() calls with the FIR
+                               // front end, including scaling their inputs.
+  double blockCyclesPerCall;
+  uint32_t cicCallCount;       // CIC outputs compensated, by
+                               // filter_firFilterBlock() (including the
+                               // decimator) or filter_processCicBlock().
+  double cicCyclesPerCall;
+  uint32_t comparisonCount;    // Folded-kernel calls that also timed the
+                               // generic kernel.
+  double foldedCyclesPerCall;  // Folded kernel alone, over those calls.
+  double genericCyclesPerCall; // Generic kernel on the same inputs.
+} filter_firStatistics_t;
+
+// A snapshot of the filter state, laid out in filter.c. Its size depends on
+// the power estimator (see filter_getStateSize()), so allocate it with malloc().
+typedef struct filter_state filter_state_t;
+
+// Summary of the decimated outputs produced by one filter_processBlock() call.
+typedef struct {
+  uint32_t outputCount;          // Decimated outputs (FIR runs).
+  double maxPower;               // Largest power of any filter after any output
+                                 // the IIR filters ran for.
+  uint16_t maxPowerFilterNumber; // Filter that had maxPower.
+  bool thresholdCrossed;         // True if the hit test passed for some output.
+  uint32_t crossingOutputIndex;  // Output (0 to outputCount - 1) that passed.
+  uint16_t crossingFilterNumber; // Filter with the most power at that output.
+} filter_blockResult_t;
+
+// Decides whether the power values of one decimated output are a hit, e.g.
+// detector_detectHit().
+typedef bool (*filter_hitTest_t)(double powerValues[]);
 
 // Filtering routines for the laser-tag project.
 // Filtering is performed by a two-stage filter, as described below.
 
 // 1. First filter is a decimating FIR filter with a configurable number of taps
 // and decimation factor.
-// 2. The output from the decimating FIR filter is passed through a bank of 10
-// IIR filters. The characteristics of the IIR filter are fixed.
+// 2. The output from the decimating FIR filter is passed through a bank of
+// FILTER_FREQUENCY_COUNT IIR filters. The characteristics of the IIR filter are
+// fixed. The channel count, like the other sizes above, comes from
+// filterCoefficients.h when the build designs its own tables (up to
+// FILTER_DESIGN_MAX_CHANNEL_COUNT channels, see filterDesign.h).
 
 /******************************************************************************
 ***** Main Filter Functions
 ******************************************************************************/
 
-// Must call this prior to using any filter functions.
+// Must call this prior to using any filter functions. Sets up the queues on
+// static storage inside filter.c, and allocates the boxcar windows only when
+// filter_boxcarPower_e is selected (see filter_getStorageSize()); later calls
+// zero them again (or restore the warm-start state, see filter_setWarmStart()).
 void filter_init();
 
+// Selects how filter_firFilterBlock() (and so filter_processBlock()) low-passes
+// and decimates, starting with the next filter_init(). The default is
+// filter_firFrontEnd_e. The CIC front end runs integer adds at the ADC rate and a
+// CIC_COMPENSATOR_TAP_COUNT-tap FIR at the decimated rate, designed by
+// filter_init() to be flat up to the highest player frequency. It does not
+// apply to filter_addNewInput()/filter_firFilter(), and filter_init() keeps the
+// FIR front end if the CIC output could overflow (see cic_init()). Ignored when
+// FILTER_REDUCED_PRECISION is defined.
+void filter_setFrontEnd(filter_frontEnd_t frontEnd);
+
+// Returns the front end selected by the last filter_init().
+filter_frontEnd_t filter_getFrontEnd();
+
+// Selects how filter_iirFilter() runs the IIR filters, starting with the next
+// filter_init(). The default is filter_directFormEngine_e. The biquad and
+// interleaved engines keep their own state, so they do not update the zQueues.
+// The Goertzel, sliding-DFT and channelizer engines replace the IIR filters and
+// output queues altogether: they only run through filter_iirFilterBank(), and
+// filter_computePower() returns their power for each player frequency.
+// Ignored when FILTER_REDUCED_PRECISION is defined.
+void filter_setEngine(filter_engine_t engine);
+
+// Returns the engine selected by the last filter_init().
+filter_engine_t filter_getEngine();
+
+// Selects how filter_computePower() measures IIR output power, starting with
+// the next filter_init(). The default is filter_boxcarPower_e. The other
+// estimators keep a constant amount of state per filter, so the output queues
+// hold only the newest output; forceComputeFromScratch has no effect for them.
+// Ignored by the engines built on dft.c and when FILTER_REDUCED_PRECISION
+// is defined.
+void filter_setPowerEstimator(filter_powerEstimator_t estimator);
+
+// Returns the power estimator selected by the last filter_init().
+filter_powerEstimator_t filter_getPowerEstimator();
+
+// Returns the bytes that filter.c holds for the queues and power totals of the
+// filter chain: a few kilobytes in a static arena, plus the boxcar windows
+// (about 164 KB) that filter_init() allocates only while filter_boxcarPower_e
+// is selected.
+uint32_t filter_getStorageSize();
+
+// Returns the size, in bytes, of a filter_saveState() snapshot for the engine
+// and power estimator selected by the last filter_init(): about 166 KB with
+// the boxcar estimator, which keeps its whole window, and about 7 KB with the
+// others. Returns 0 with the engines built on dft.c, the CIC front end or when
+// FILTER_REDUCED_PRECISION is defined, where filter_saveState() fails.
+uint32_t filter_getStateSize();
+
+// Copies the state of the filters (queue contents, power sums and energy gate)
+// to state, filter_getStateSize() bytes. Returns false, and writes nothing,
+// if filter_getStateSize() is 0.
+bool filter_saveState(filter_state_t *state);
+
+// Replaces the state of the filters with a snapshot from filter_saveState(),
+// without allocating or zeroing anything, so filtering carries on exactly as it
+// would have after the snapshot. Run-time statistics are kept, and the noise
+// floors (see filter_getNoiseFloors()) start at the restored power. Returns
+// false, and changes nothing, if the snapshot was taken with another engine or
+// power estimator than the last filter_init() selected, or with the CIC front
+// end selected.
+bool filter_restoreState(const filter_state_t *state);
+
+// Makes every later filter_init() restore state (a snapshot from
+// filter_saveState(), which must stay valid) instead of starting from zero,
+// or start from zero again if state is NULL. A snapshot of ambient light gives
+// meaningful power values at once, instead of after a pulse width of samples.
+void filter_setWarmStart(const filter_state_t *state);
+
+// Turns on or off, starting with the next filter_init(), the guard against
+// subnormal numbers, which are far slower than normal ones on the Cortex-A9
+// VFP. With the guard on, filter_init() sets flush-to-zero mode (the FPSCR FZ
+// bit on the board, the SSE FTZ and DAZ bits on a PC host) for the whole
+// program, and a direct-form IIR filter whose state has decayed far below any
+// useful power is snapped to exact zero and marked quiescent: while its input
+// stays zero it outputs zero without running. The default is on.
+void filter_setDenormalGuard(bool enabled);
+
+// Turns on or off, starting with the next filter_init(), a wideband energy gate
+// in filter_processBlock(). The gate compares the energy of the FIR output
+// (less its ambient DC level) with a learned ambient floor. While the energy
+// stays near the floor, the IIR filters, power and hit test are skipped and
+// keep their last state, which already holds only ambient light. When the
+// energy rises, the gate opens and the skipped outputs (up to a few dozen) are
+// run before the new one, so the start of a shot is not lost. The default is
+// off. Ignored when FILTER_REDUCED_PRECISION is defined.
+void filter_setEnergyGate(bool enabled);
+
+// Returns true if the last filter_init() turned the energy gate on.
+bool filter_getEnergyGate();
+
 // Use this to copy an input into the input queue of the FIR-filter (xQueue).
 void filter_addNewInput(double x);
 
@@ -50,11 +271,66 @@ void filter_addNewInput(double x);
 // Output is returned and is also pushed on to yQueue.
 double filter_firFilter();
 
+// Converts a raw ADC value (0 to FILTER_ADC_MAX_VALUE) to a filter input
+// (-1.0 to 1.0).
+double filter_scaleAdcValue(buffer_data_t rawAdcValue);
+
+// Runs the decimating FIR filter on a block of FILTER_FIR_DECIMATION_FACTOR raw
+// ADC values (oldest first) and produces the output for the newest one, exactly
+// as if each value had been scaled, passed to filter_addNewInput() and followed
+// by filter_firFilter(). Output is returned and is also pushed on to yQueue.
+// Keeps its own input history, so xQueue is not updated; use either this
+// function or filter_addNewInput()/filter_firFilter() between filter_init()
+// calls.
+double filter_firFilterBlock(const buffer_data_t rawAdcBlock[]);
+
+// Runs sampleCount raw ADC values (oldest first) through the whole chain:
+// scaling, the decimating FIR filter, the IIR filters and incremental power,
+// with the same results as filter_firFilterBlock(), filter_iirFilterBank() and
+// filter_computePower() for each block of FILTER_FIR_DECIMATION_FACTOR values.
+// sampleCount need not be a multiple of FILTER_FIR_DECIMATION_FACTOR; leftover
+// values are kept until the next call (filter_init() discards them).
+// After each output the power values are passed to hitTest (if not NULL) until
+// it first returns true. The summary is written to *result. With the energy
+// gate on (see filter_setEnergyGate()), outputs run when the gate opens are
+// summarized as part of the output that opened it.
+void filter_processBlock(const buffer_data_t samples[], uint32_t sampleCount,
+                         filter_hitTest_t hitTest, filter_blockResult_t *result);
+
+// Same as filter_processBlock(), but for outputCount FIR outputs (oldest first)
+// that were produced elsewhere, e.g. by diversity.c from several sensors. Each
+// is pushed on to yQueue and run through the IIR filters and power. Do not mix
+// with filter_processBlock() between filter_init() calls. Does nothing with
+// FILTER_REDUCED_PRECISION, whose chain keeps its own FIR output queue.
+void filter_processFirOutputs(const double firOutputs[], uint32_t outputCount,
+                              filter_hitTest_t hitTest,
+                              filter_blockResult_t *result);
+
+// Same as filter_processFirOutputs(), for outputCount CIC decimator outputs
+// (see FILTER_CIC_IN_ISR): each is scaled and run through the compensation FIR
+// first. Requires the CIC front end; asserts if filter_init() did not select it.
+void filter_processCicBlock(const buffer_data_t cicOutputs[],
+                            uint32_t outputCount, filter_hitTest_t hitTest,
+                            filter_blockResult_t *result);
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
+// Asserts with the engines built on dft.c, which only run through
+// filter_iirFilterBank().
 double filter_iirFilter(uint16_t filterNumber);
 
+// Runs all of the IIR filters on the newest yQueue value, with the same
+// results as calling filter_iirFilter() for each filter number. When every
+// filter's B coefficients are a gain times the same numerator (true for the
+// filters in filter.c), the feed-forward sum is computed once per call and
+// scaled for each filter, and zero B taps are skipped.
+void filter_iirFilterBank();
+
 // Use this to compute the power for values contained in an outputQueue.
+// The boxcar power is kept as a compensated running sum without pow(), and each
+// incremental call also recomputes a slice of the window from scratch; every
+// 400 calls the exact sum replaces the running one, so power never drifts and
+// no call costs more than a few extra multiplies.
 // If force == true, then recompute power by using all values in the
 // outputQueue. This option is necessary so that you can correctly compute power
 // values the first time. After that, you can incrementally compute power values
@@ -66,7 +342,7 @@ double filter_iirFilter(uint16_t filterNumber);
 // 3. Get the newest value from the power queue, call this newest-value.
 // 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
 // (newest-value * newest-value). Note that this function will probably need an
-// array to keep track of these values for each of the 10 output queues.
+// array to keep track of these values for each of the output queues.
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
                            bool debugPrint);
 
@@ -78,6 +354,15 @@ double filter_getCurrentPowerValue(uint16_t filterNumber);
 // Useful in testing the detector.
 void filter_setCurrentPowerValue(uint16_t filterNumber, double value);
 
+// Copies the noise floor of each channel to floors[0..FILTER_FREQUENCY_COUNT-1]:
+// a slow tracker of the 25th percentile of its power, updated for every output
+// of filter_processBlock(), filter_processFirOutputs() and
+// filter_processCicBlock() that runs the IIR filters. Each floor equals the
+// power for the first FILTER_INPUT_PULSE_WIDTH outputs after filter_init(),
+// then follows changes in ambient light over seconds, so a shot barely moves
+// it. Power over floor is the signal-to-noise ratio of a channel.
+void filter_getNoiseFloors(double floors[]);
+
 // Get a copy of the current power values.
 // This function copies the already computed values into a previously-declared
 // array so that they can be accessed from outside the filter software by the
@@ -95,6 +380,29 @@ void filter_getCurrentPowerValues(double powerValues[]);
 void filter_getNormalizedPowerValues(double normalizedArray[],
                                      uint16_t *indexOfMaxValue);
 
+/******************************************************************************
+***** Run-Time Statistics
+***** Times are in cycleCounter counts (CPU cycles on the board).
+******************************************************************************/
+
+// Returns true if filter_init() found the FIR coefficients symmetric, in which
+// case filter_firFilter() adds mirrored inputs before multiplying (41
+// multiplies instead of 81).
+bool filter_isFirFolded();
+
+// Copies the FIR cost of each path gathered since filter_init(). With the
+// folded kernel, every 64th call on either FIR path also runs the generic
+// kernel on the same inputs, so the saving is measured in steady state.
+void filter_getFirStatistics(filter_firStatistics_t *statistics);
+
+// Copies the boxcar power drift statistics gathered since filter_init().
+void filter_getPowerDriftStatistics(filter_powerDriftStatistics_t *statistics);
+
+// Returns the fraction of filter_processBlock() outputs since filter_init() for
+// which the energy gate skipped the IIR filters and power (0 with the gate
+// off).
+double filter_getIdleFraction();
+
 /******************************************************************************
 ***** Verification-Assisting Functions
 ***** External test functions access the internal data structures of filter.c
@@ -107,6 +415,10 @@ const double *filter_getFirCoefficientArray();
 // Returns the number of FIR coefficients.
 uint32_t filter_getFirCoefficientCount();
 
+// Returns the CIC_COMPENSATOR_TAP_COUNT coefficients of the CIC compensator,
+// designed by the last filter_init() that selected the CIC front end.
+const double *filter_getCicCompensatorCoefficientArray();
+
 // Returns the array of coefficients for a particular filter number.
 const double *filter_getIirACoefficientArray(uint16_t filterNumber);
 
@@ -125,7 +437,9 @@ uint32_t filter_getYQueueSize();
 // Returns the decimation value.
 uint16_t filter_getDecimationValue();
 
-// Returns the address of xQueue.
+// Returns the address of xQueue. xQueue, yQueue and the zQueues are mirrored,
+// so queue_window() works on them. None of the queues below are set up when
+// FILTER_REDUCED_PRECISION is defined.
 queue_t *filter_getXQueue();
 
 // Returns the address of yQueue.
@@ -0,0 +1,220 @@
+#include "filterDesign.h"
+#include <complex.h>
+#include <math.h>
+#include <stdio.h>
+
+#define PROTOTYPE_MAX_ORDER (FILTER_DESIGN_IIR_ORDER / 2)
+// The bilinear transform uses s = BILINEAR_SCALE * (1 - z^-1) / (1 + z^-1),
+// with frequencies normalized so the Nyquist frequency is 1. Any scale gives
+// the same filter once the band edges are prewarped.
+#define BILINEAR_SCALE 4.0
+// The FIR stopband starts at this fraction of the decimated sample rate.
+#define FIR_STOPBAND_EDGE_RATIO 0.8
+// Frequencies checked across the FIR stopband.
+#define FIR_STOPBAND_CHECK_POINT_COUNT 2000
+
+// Converts a magnitude to a loss in dB (positive for attenuation).
+static double lossInDb(double magnitude) { return -20.0 * log10(magnitude); }
+
+// Multiplies the polynomial p[0..*length-1] (in z^-1) by (1 - root z^-1).
+static void multiplyByRoot(double complex p[], uint16_t *length,
+                           double complex root) {
+  p[*length] = 0.0;
+  for (uint16_t i = *length; i > 0; i--) {
+    p[i] -= root * p[i - 1];
+  }
+  (*length)++;
+}
+
+// Hamming-windowed sinc with its cutoff at cutoff (fraction of the sample
+// rate), not normalized to unity DC gain.
+static void designFir(double coefficients[], uint16_t count, double cutoff) {
+  double center = (count - 1) / 2.0;
+  for (uint16_t n = 0; n < count; n++) {
+    double x = n - center;
+    double sinc = (x == 0.0) ? 1.0 : sin(2.0 * M_PI * cutoff * x) /
+                                         (2.0 * M_PI * cutoff * x);
+    double window = 0.54 - 0.46 * cos(2.0 * M_PI * n / (count - 1));
+    coefficients[n] = 2.0 * cutoff * sinc * window;
+  }
+}
+
+// Butterworth bandpass of the given order with band edges lowEdge and
+// highEdge (fractions of the Nyquist frequency). Writes b[0..order] and
+// a[0..order-1] in the layout of filter.c.
+static void designBandpass(double lowEdge, double highEdge, uint16_t order,
+                           double b[], double a[]) {
+  uint16_t prototypeOrder = order / 2;
+  double low = BILINEAR_SCALE * tan(M_PI * lowEdge / 2.0);
+  double high = BILINEAR_SCALE * tan(M_PI * highEdge / 2.0);
+  double bandwidth = high - low;
+  double center = sqrt(low * high);
+
+  // Each lowpass prototype pole becomes two bandpass poles, which the
+  // bilinear transform maps into the z-plane.
+  double complex denominator[FILTER_DESIGN_IIR_ORDER + 1] = {1.0};
+  uint16_t length = 1;
+  double complex gain = 1.0;
+  for (uint16_t k = 0; k < prototypeOrder; k++) {
+    double complex pole =
+        cexp(I * M_PI * (2 * k + prototypeOrder + 1) / (2.0 * prototypeOrder));
+    double complex half = bandwidth / 2.0 * pole;
+    double complex offset = csqrt(half * half - center * center);
+    double complex analogPoles[2] = {half + offset, half - offset};
+    for (uint16_t j = 0; j < 2; j++) {
+      multiplyByRoot(denominator, &length,
+                     (BILINEAR_SCALE + analogPoles[j]) /
+                         (BILINEAR_SCALE - analogPoles[j]));
+      gain /= BILINEAR_SCALE - analogPoles[j];
+    }
+  }
+  // The prototype's zeros at s = 0 and infinity become z = 1 and z = -1, so the
+  // numerator is gain * (1 - z^-2)^(order/2).
+  double complex numerator[FILTER_DESIGN_IIR_ORDER + 1] = {1.0};
+  uint16_t numeratorLength = 1;
+  for (uint16_t k = 0; k < prototypeOrder; k++) {
+    multiplyByRoot(numerator, &numeratorLength, 1.0);
+    multiplyByRoot(numerator, &numeratorLength, -1.0);
+  }
+  double numeratorGain =
+      creal(gain) * pow(BILINEAR_SCALE * bandwidth, prototypeOrder);
+  for (uint16_t i = 0; i <= order; i++) {
+    b[i] = numeratorGain * creal(numerator[i]);
+    if (b[i] == 0.0)
+      b[i] = 0.0; // No negative zeros in the tables.
+  }
+  for (uint16_t i = 0; i < order; i++) {
+    a[i] = creal(denominator[i + 1]);
+  }
+}
+
+// Designs every table for the plan.
+bool filterDesign_design(const filterDesign_plan_t *plan,
+                         filterDesign_tables_t *tables) {
+  if (plan->channelCount == 0 ||
+      plan->channelCount > FILTER_DESIGN_MAX_CHANNEL_COUNT) {
+    printf("filterDesign_design(): %d channels, must be 1 to %d.\n",
+           plan->channelCount, FILTER_DESIGN_MAX_CHANNEL_COUNT);
+    return false;
+  }
+  if (plan->decimationFactor == 0 ||
+      plan->decimationFactor > FILTER_DESIGN_MAX_DECIMATION_FACTOR) {
+    printf("filterDesign_design(): decimation by %d, must be 1 to %d.\n",
+           plan->decimationFactor, FILTER_DESIGN_MAX_DECIMATION_FACTOR);
+    return false;
+  }
+  double decimatedFrequency = plan->sampleFrequencyHz / plan->decimationFactor;
+  double nyquist = decimatedFrequency / 2.0;
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    double f = plan->channelFrequencyHz[i];
+    if (f - plan->bandwidthHz / 2.0 <= 0.0 ||
+        f + plan->bandwidthHz / 2.0 >= nyquist) {
+      printf("filterDesign_design(): %.1lf Hz does not fit below the "
+             "decimated Nyquist frequency (%.1lf Hz).\n",
+             f, nyquist);
+      return false;
+    }
+  }
+
+  tables->firCoefficientCount =
+      FILTER_DESIGN_FIR_TAPS_PER_DECIMATION * plan->decimationFactor + 1;
+  designFir(tables->fir, tables->firCoefficientCount,
+            FILTER_DESIGN_FIR_CUTOFF_RATIO / plan->decimationFactor);
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    double f = plan->channelFrequencyHz[i];
+    tables->tickCount[i] = lround(plan->sampleFrequencyHz / f);
+    designBandpass((f - plan->bandwidthHz / 2.0) / nyquist,
+                   (f + plan->bandwidthHz / 2.0) / nyquist,
+                   FILTER_DESIGN_IIR_ORDER, tables->iirB[i], tables->iirA[i]);
+  }
+  tables->pulseWidth = lround(FILTER_DESIGN_PULSE_SECONDS * decimatedFrequency);
+  return true;
+}
+
+// Checks the designed tables against the passband and stopband specs.
+bool filterDesign_check(const filterDesign_plan_t *plan,
+                        const filterDesign_tables_t *tables,
+                        bool printFailures) {
+  bool success = true;
+  double decimatedFrequency = plan->sampleFrequencyHz / plan->decimationFactor;
+
+  // FIR passband: every player frequency at the ADC rate.
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    double w =
+        2.0 * M_PI * plan->channelFrequencyHz[i] / plan->sampleFrequencyHz;
+    double loss = lossInDb(filterDesign_getFirMagnitude(
+        tables->fir, tables->firCoefficientCount, w));
+    if (fabs(loss) > FILTER_DESIGN_FIR_MAX_PASSBAND_LOSS) {
+      if (printFailures)
+        printf("FIR loses %.2lf dB at %.1lf Hz (at most %.2lf allowed).\n",
+               loss, plan->channelFrequencyHz[i],
+               FILTER_DESIGN_FIR_MAX_PASSBAND_LOSS);
+      success = false;
+    }
+  }
+  // FIR stopband: from the stopband edge to the ADC Nyquist frequency.
+  double stopbandEdge = FIR_STOPBAND_EDGE_RATIO * decimatedFrequency;
+  for (uint16_t k = 0; k <= FIR_STOPBAND_CHECK_POINT_COUNT; k++) {
+    double f = stopbandEdge + (plan->sampleFrequencyHz / 2.0 - stopbandEdge) *
+                                  k / FIR_STOPBAND_CHECK_POINT_COUNT;
+    double loss = lossInDb(filterDesign_getFirMagnitude(
+        tables->fir, tables->firCoefficientCount,
+        2.0 * M_PI * f / plan->sampleFrequencyHz));
+    if (loss < FILTER_DESIGN_FIR_MIN_STOPBAND_LOSS) {
+      if (printFailures)
+        printf("FIR loses only %.2lf dB at %.1lf Hz (at least %.2lf "
+               "needed).\n",
+               loss, f, FILTER_DESIGN_FIR_MIN_STOPBAND_LOSS);
+      success = false;
+      break;
+    }
+  }
+  // IIR filters at the decimated rate: pass their own frequency, reject the
+  // others.
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    for (uint16_t j = 0; j < plan->channelCount; j++) {
+      double w = 2.0 * M_PI * plan->channelFrequencyHz[j] / decimatedFrequency;
+      double loss = lossInDb(filterDesign_getIirMagnitude(
+          tables->iirB[i], tables->iirA[i], FILTER_DESIGN_IIR_ORDER, w));
+      if (i == j && fabs(loss) > FILTER_DESIGN_IIR_MAX_PASSBAND_LOSS) {
+        if (printFailures)
+          printf("IIR filter %d loses %.2lf dB at its own frequency (at most "
+                 "%.2lf allowed).\n",
+                 i, loss, FILTER_DESIGN_IIR_MAX_PASSBAND_LOSS);
+        success = false;
+      } else if (i != j && loss < FILTER_DESIGN_IIR_MIN_STOPBAND_LOSS) {
+        if (printFailures)
+          printf("IIR filter %d loses only %.2lf dB at %.1lf Hz (at least "
+                 "%.2lf needed).\n",
+                 i, loss, plan->channelFrequencyHz[j],
+                 FILTER_DESIGN_IIR_MIN_STOPBAND_LOSS);
+        success = false;
+      }
+    }
+  }
+  return success;
+}
+
+// Magnitude of an FIR filter at frequency (radians/sample).
+double filterDesign_getFirMagnitude(const double coefficients[],
+                                    uint16_t coefficientCount,
+                                    double frequency) {
+  double complex sum = 0.0;
+  for (uint16_t n = 0; n < coefficientCount; n++) {
+    sum += coefficients[n] * cexp(-I * frequency * n);
+  }
+  return cabs(sum);
+}
+
+// Magnitude of an IIR filter at frequency (radians/sample).
+double filterDesign_getIirMagnitude(const double b[], const double a[],
+                                    uint16_t order, double frequency) {
+  double complex numerator = b[0];
+  double complex denominator = 1.0;
+  for (uint16_t n = 1; n <= order; n++) {
+    double complex z = cexp(-I * frequency * n);
+    numerator += b[n] * z;
+    denominator += a[n - 1] * z;
+  }
+  return cabs(numerator) / cabs(denominator);
+}
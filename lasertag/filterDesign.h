@@ -0,0 +1,98 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERDESIGN_H_
+#define FILTERDESIGN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Designs the filter tables used by filter.c for any ADC sample rate,
+// decimation factor and set of player frequencies, and checks that they meet
+// the passband and stopband specs below. The design follows the one behind the
+// original tables:
+// 1. The decimating FIR filter is a Hamming-windowed sinc with
+// FILTER_DESIGN_FIR_TAPS_PER_DECIMATION taps per unit of decimation (plus one)
+// and its cutoff at FILTER_DESIGN_FIR_CUTOFF_RATIO times the decimated sample
+// rate.
+// 2. Each IIR filter is a Butterworth bandpass filter of order
+// FILTER_DESIGN_IIR_ORDER, centered on a player frequency, designed with the
+// bilinear transform.
+// With 100 kHz sampling, decimation by 10, 50 Hz bandwidth and the player
+// frequencies rounded to whole hertz, the result matches the tables in
+// filter.c. tools/filterDesign/filterDesignTool.c writes the tables as a
+// header that filter.h and filter.c use when FILTER_GENERATED_COEFFICIENTS is
+// defined.
+
+#define FILTER_DESIGN_MAX_CHANNEL_COUNT 32
+#define FILTER_DESIGN_FIR_TAPS_PER_DECIMATION 8
+#define FILTER_DESIGN_MAX_DECIMATION_FACTOR 32
+#define FILTER_DESIGN_MAX_FIR_COEFFICIENT_COUNT                                \
+  (FILTER_DESIGN_FIR_TAPS_PER_DECIMATION *                                     \
+       FILTER_DESIGN_MAX_DECIMATION_FACTOR +                                   \
+   1)
+#define FILTER_DESIGN_FIR_CUTOFF_RATIO 0.57
+#define FILTER_DESIGN_IIR_ORDER 10
+#define FILTER_DESIGN_PULSE_SECONDS 0.2 // Length of a shot.
+
+// Specs checked by filterDesign_check(), in dB:
+// 1. FIR passband: at most this loss at every player frequency.
+#define FILTER_DESIGN_FIR_MAX_PASSBAND_LOSS 1.0
+// 2. FIR stopband: at least this loss from 0.8 times the decimated sample rate
+// up to the ADC Nyquist frequency, so aliases land well below a shot. The
+// Hamming window's sidelobes sit near 53 dB.
+#define FILTER_DESIGN_FIR_MIN_STOPBAND_LOSS 50.0
+// 3. IIR passband: at most this loss at the filter's own frequency.
+#define FILTER_DESIGN_IIR_MAX_PASSBAND_LOSS 0.5
+// 4. IIR stopband: at least this loss at every other player frequency.
+#define FILTER_DESIGN_IIR_MIN_STOPBAND_LOSS 40.0
+
+// What to design for.
+typedef struct {
+  double sampleFrequencyHz; // ADC sample rate.
+  uint16_t decimationFactor;
+  uint16_t channelCount;
+  double channelFrequencyHz[FILTER_DESIGN_MAX_CHANNEL_COUNT];
+  double bandwidthHz; // Width of each IIR passband.
+} filterDesign_plan_t;
+
+// Designed tables, in the same layout as the tables in filter.c.
+typedef struct {
+  uint16_t firCoefficientCount;
+  double fir[FILTER_DESIGN_MAX_FIR_COEFFICIENT_COUNT];
+  // ADC ticks per period of each frequency, as used by the transmitter.
+  uint16_t tickCount[FILTER_DESIGN_MAX_CHANNEL_COUNT];
+  double iirB[FILTER_DESIGN_MAX_CHANNEL_COUNT][FILTER_DESIGN_IIR_ORDER + 1];
+  double iirA[FILTER_DESIGN_MAX_CHANNEL_COUNT][FILTER_DESIGN_IIR_ORDER];
+  uint32_t pulseWidth; // Decimated samples per shot (power window length).
+} filterDesign_tables_t;
+
+// Designs every table for the plan. Returns false (and prints why) if the plan
+// is out of range: too many channels, too much decimation, or a frequency
+// that is not below the decimated Nyquist frequency.
+bool filterDesign_design(const filterDesign_plan_t *plan,
+                         filterDesign_tables_t *tables);
+
+// Checks the designed tables against the passband and stopband specs above.
+// Prints each violation if printFailures is true. Returns true if all pass.
+bool filterDesign_check(const filterDesign_plan_t *plan,
+                        const filterDesign_tables_t *tables,
+                        bool printFailures);
+
+// Magnitude of an FIR filter at frequency (radians/sample).
+double filterDesign_getFirMagnitude(const double coefficients[],
+                                    uint16_t coefficientCount,
+                                    double frequency);
+
+// Magnitude of an IIR filter with numerator b[0..order] and denominator
+// 1 + a[0]z^-1 + ... + a[order-1]z^-order at frequency (radians/sample).
+double filterDesign_getIirMagnitude(const double b[], const double a[],
+                                    uint16_t order, double frequency);
+
+#endif /* FILTERDESIGN_H_ */
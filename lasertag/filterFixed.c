@@ -0,0 +1,199 @@
+#include "filterFixed.h"
+#include "biquad.h"
+#include "filter.h"
+#include <math.h>
+
+#define FIR_COEFF_COUNT FILTER_FIR_COEFFICIENT_COUNT
+#define SECTION_COUNT (FILTER_IIR_ORDER / 2)
+#define OUTPUT_HISTORY_SIZE FILTER_INPUT_PULSE_WIDTH
+
+#define COEFF_FRACTION_BITS 29 // Biquad coefficients (|a1| < 2 fits in Q29).
+#define INPUT_TO_IIR_SHIFT                                                     \
+  (FILTER_FIXED_IIR_FRACTION_BITS - FILTER_FIXED_INPUT_FRACTION_BITS)
+#define POWER_SAMPLE_SHIFT                                                     \
+  (FILTER_FIXED_IIR_FRACTION_BITS - FILTER_FIXED_POWER_FRACTION_BITS / 2)
+
+#define Q15_MAX INT16_MAX
+#define Q15_MIN INT16_MIN
+
+// One biquad in direct form I. The coefficients are Q29 and the state is Q24.
+typedef struct {
+  int32_t b[3];
+  int32_t a[2];
+  int32_t x1, x2; // Last two section inputs.
+  int32_t y1, y2; // Last two section outputs.
+} fixedSection_t;
+
+static int16_t firCoeffs[FIR_COEFF_COUNT];
+static int16_t xHistory[FIR_COEFF_COUNT];
+static uint16_t xIndexIn; // Next slot to write; also the oldest sample.
+static filterFixed_sample_t firOutput;
+
+static fixedSection_t sections[FILTER_FREQUENCY_COUNT][SECTION_COUNT];
+
+// Ring of IIR outputs per filter, and the output each new one displaced.
+static filterFixed_sample_t outputHistory[FILTER_FREQUENCY_COUNT]
+                                         [OUTPUT_HISTORY_SIZE];
+static uint16_t outputIndexIn;
+static filterFixed_sample_t displacedOutput[FILTER_FREQUENCY_COUNT];
+static filterFixed_power_t currentPower[FILTER_FREQUENCY_COUNT];
+
+// Rounds value * 2^fractionBits to the nearest integer.
+static int32_t quantize(double value, uint16_t fractionBits) {
+  return (int32_t)lround(ldexp(value, fractionBits));
+}
+
+// Square of an IIR output, reduced to Q20 first so 2000 of them fit in 64 bits.
+static filterFixed_power_t square(filterFixed_sample_t z) {
+  int64_t reduced = z >> POWER_SAMPLE_SHIFT;
+  return reduced * reduced;
+}
+
+// Must call this prior to using any filterFixed functions.
+// Quantizes the coefficients in filter.c and zeros all state. Returns false if
+// an IIR filter can't be factored into SECTION_COUNT biquads.
+bool filterFixed_init(void) {
+  bool factored = true;
+  const double *fir = filter_getFirCoefficientArray();
+  for (uint16_t i = 0; i < FIR_COEFF_COUNT; i++) {
+    firCoeffs[i] = quantize(fir[i], FILTER_FIXED_INPUT_FRACTION_BITS);
+    xHistory[i] = 0;
+  }
+  xIndexIn = 0;
+  firOutput = 0;
+
+  for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+       filterNumber++) {
+    biquad_section_t designed[BIQUAD_MAX_SECTION_COUNT];
+    uint16_t designedCount = 0;
+    double centerFrequency = 2.0 * M_PI * FILTER_FIR_DECIMATION_FACTOR /
+                             filter_frequencyTickTable[filterNumber];
+    if (!biquad_design(filter_getIirBCoefficientArray(filterNumber),
+                       filter_getIirACoefficientArray(filterNumber),
+                       FILTER_IIR_ORDER, centerFrequency, designed,
+                       &designedCount) ||
+        designedCount != SECTION_COUNT) {
+      factored = false;
+      designedCount = 0; // The filter outputs zeros.
+    }
+    for (uint16_t s = 0; s < SECTION_COUNT; s++) {
+      fixedSection_t *section = &sections[filterNumber][s];
+      for (uint16_t i = 0; i < 3; i++) {
+        section->b[i] = s < designedCount
+                            ? quantize(designed[s].b[i], COEFF_FRACTION_BITS)
+                            : 0;
+      }
+      for (uint16_t i = 0; i < 2; i++) {
+        section->a[i] = s < designedCount
+                            ? quantize(designed[s].a[i], COEFF_FRACTION_BITS)
+                            : 0;
+      }
+      section->x1 = section->x2 = section->y1 = section->y2 = 0;
+    }
+
+    for (uint16_t i = 0; i < OUTPUT_HISTORY_SIZE; i++) {
+      outputHistory[filterNumber][i] = 0;
+    }
+    displacedOutput[filterNumber] = 0;
+    currentPower[filterNumber] = 0;
+  }
+  outputIndexIn = 0;
+  return factored;
+}
+
+// Adds a Q15 input to the FIR history.
+void filterFixed_addNewInput(filterFixed_sample_t x) {
+  xHistory[xIndexIn] = x;
+  xIndexIn = (xIndexIn + 1 == FIR_COEFF_COUNT) ? 0 : xIndexIn + 1;
+}
+
+// Runs the FIR filter over the FIR history. The Q15 output is returned and
+// becomes the input to the IIR filters.
+filterFixed_sample_t filterFixed_firFilter(void) {
+  // sum(|h|) < 2, so 81 Q15 x Q15 products can't overflow 32 bits.
+  int32_t acc = 0;
+  uint16_t newest = (xIndexIn == 0) ? FIR_COEFF_COUNT - 1 : xIndexIn - 1;
+  // Walk the history newest to oldest in two contiguous runs.
+  uint16_t i = 0;
+  for (int16_t j = newest; j >= 0; j--) {
+    acc += (int32_t)firCoeffs[i++] * xHistory[j];
+  }
+  for (int16_t j = FIR_COEFF_COUNT - 1; j > newest; j--) {
+    acc += (int32_t)firCoeffs[i++] * xHistory[j];
+  }
+  firOutput = (acc + (1 << (FILTER_FIXED_INPUT_FRACTION_BITS - 1))) >>
+              FILTER_FIXED_INPUT_FRACTION_BITS;
+  // The new output index is shared by all IIR filters.
+  outputIndexIn = (outputIndexIn + 1 == OUTPUT_HISTORY_SIZE)
+                      ? 0
+                      : outputIndexIn + 1;
+  return firOutput;
+}
+
+// Runs a single IIR filter on the most recent FIR output.
+// The Q24 output is returned and is also stored for the power computation.
+filterFixed_sample_t filterFixed_iirFilter(uint16_t filterNumber) {
+  // Multiplied, not shifted: shifting a negative value left is undefined.
+  int32_t x = firOutput * (1 << INPUT_TO_IIR_SHIFT);
+  for (uint16_t s = 0; s < SECTION_COUNT; s++) {
+    fixedSection_t *section = &sections[filterNumber][s];
+    int64_t acc = (int64_t)section->b[0] * x +
+                  (int64_t)section->b[1] * section->x1 +
+                  (int64_t)section->b[2] * section->x2 -
+                  (int64_t)section->a[0] * section->y1 -
+                  (int64_t)section->a[1] * section->y2;
+    int32_t y = (int32_t)((acc + (1LL << (COEFF_FRACTION_BITS - 1))) >>
+                          COEFF_FRACTION_BITS);
+    section->x2 = section->x1;
+    section->x1 = x;
+    section->y2 = section->y1;
+    section->y1 = y;
+    x = y;
+  }
+  displacedOutput[filterNumber] = outputHistory[filterNumber][outputIndexIn];
+  outputHistory[filterNumber][outputIndexIn] = x;
+  return x;
+}
+
+// Same contract as filter_computePower(): recomputes from every stored output
+// if forceComputeFromScratch is true, otherwise updates incrementally.
+filterFixed_power_t filterFixed_computePower(uint16_t filterNumber,
+                                             bool forceComputeFromScratch) {
+  if (forceComputeFromScratch) {
+    filterFixed_power_t power = 0;
+    for (uint16_t i = 0; i < OUTPUT_HISTORY_SIZE; i++) {
+      power += square(outputHistory[filterNumber][i]);
+    }
+    currentPower[filterNumber] = power;
+  } else {
+    currentPower[filterNumber] +=
+        square(outputHistory[filterNumber][outputIndexIn]) -
+        square(displacedOutput[filterNumber]);
+  }
+  // Only the first call after a new output may remove the displaced one.
+  displacedOutput[filterNumber] = outputHistory[filterNumber][outputIndexIn];
+  return currentPower[filterNumber];
+}
+
+// Converts a value in [-1.0, 1.0] to a saturated Q15 input.
+filterFixed_sample_t filterFixed_inputFromDouble(double x) {
+  int32_t q = quantize(x, FILTER_FIXED_INPUT_FRACTION_BITS);
+  if (q > Q15_MAX)
+    return Q15_MAX;
+  if (q < Q15_MIN)
+    return Q15_MIN;
+  return q;
+}
+
+// Converts fixed-point results back to the units used by filter.c.
+double filterFixed_firOutputToDouble(filterFixed_sample_t y) {
+  return ldexp(y, -FILTER_FIXED_INPUT_FRACTION_BITS);
+}
+
+double filterFixed_iirOutputToDouble(filterFixed_sample_t z) {
+  return ldexp(z, -FILTER_FIXED_IIR_FRACTION_BITS);
+}
+
+double filterFixed_powerToDouble(filterFixed_power_t power) {
+  return ldexp((double)power, -FILTER_FIXED_POWER_FRACTION_BITS);
+}
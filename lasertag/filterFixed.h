@@ -0,0 +1,65 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERFIXED_H_
+#define FILTERFIXED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Integer implementation of the filter chain in filter.c.
+// 1. The decimating FIR filter uses Q15 inputs and Q15 coefficients with a
+// 32-bit accumulator.
+// 2. Each IIR filter runs as a cascade of biquads (see biquad.h) with Q29
+// coefficients, Q24 state and a 64-bit accumulator.
+// 3. Power is an exact integer running sum of squared outputs, so the
+// incremental update never drifts from the from-scratch value.
+// Define FILTER_FIXED_POINT in filter.h to route the filter_* API through this
+// module. It can also be called directly, e.g. to compare it against the
+// double-precision path.
+
+// Number of fractional bits in each fixed-point quantity.
+#define FILTER_FIXED_INPUT_FRACTION_BITS 15 // FIR inputs and outputs.
+#define FILTER_FIXED_IIR_FRACTION_BITS 24   // IIR state and outputs.
+#define FILTER_FIXED_POWER_FRACTION_BITS 40 // Sum of squared Q20 outputs.
+
+typedef int32_t filterFixed_sample_t;
+typedef int64_t filterFixed_power_t;
+
+// Must call this prior to using any filterFixed functions.
+// Quantizes the coefficients in filter.c and zeros all state. Returns false if
+// an IIR filter can't be factored into FILTER_IIR_ORDER / 2 biquads; the chain
+// must not be used then.
+bool filterFixed_init(void);
+
+// Adds a Q15 input to the FIR history.
+void filterFixed_addNewInput(filterFixed_sample_t x);
+
+// Runs the FIR filter over the FIR history. The Q15 output is returned and
+// becomes the input to the IIR filters.
+filterFixed_sample_t filterFixed_firFilter(void);
+
+// Runs a single IIR filter on the most recent FIR output.
+// The Q24 output is returned and is also stored for the power computation.
+filterFixed_sample_t filterFixed_iirFilter(uint16_t filterNumber);
+
+// Same contract as filter_computePower(): recomputes from every stored output
+// if forceComputeFromScratch is true, otherwise updates incrementally.
+filterFixed_power_t filterFixed_computePower(uint16_t filterNumber,
+                                             bool forceComputeFromScratch);
+
+// Converts a value in [-1.0, 1.0] to a saturated Q15 input.
+filterFixed_sample_t filterFixed_inputFromDouble(double x);
+
+// Converts fixed-point results back to the units used by filter.c.
+double filterFixed_firOutputToDouble(filterFixed_sample_t y);
+double filterFixed_iirOutputToDouble(filterFixed_sample_t z);
+double filterFixed_powerToDouble(filterFixed_power_t power);
+
+#endif /* FILTERFIXED_H_ */
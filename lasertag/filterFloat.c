@@ -0,0 +1,138 @@
+#include "filterFloat.h"
+#include "biquad.h"
+#include "filter.h"
+#include <math.h>
+#include <stdio.h>
+
+#define FIR_COEFF_COUNT FILTER_FIR_COEFFICIENT_COUNT
+#define SECTION_COUNT (FILTER_IIR_ORDER / 2)
+#define OUTPUT_HISTORY_SIZE FILTER_INPUT_PULSE_WIDTH
+
+static float firCoeffs[FIR_COEFF_COUNT];
+// FIR inputs, each written twice, FIR_COEFF_COUNT apart, so the newest
+// FIR_COEFF_COUNT are always contiguous.
+static float xHistory[2 * FIR_COEFF_COUNT];
+static uint16_t xIndexIn; // Next slot to write; also the oldest sample.
+static float firOutput;
+
+static biquad_floatSection_t sections[FILTER_FREQUENCY_COUNT][SECTION_COUNT];
+
+// Ring of IIR outputs per filter, and the output each new one displaced.
+static float outputHistory[FILTER_FREQUENCY_COUNT][OUTPUT_HISTORY_SIZE];
+static uint16_t outputIndexIn;
+static float displacedOutput[FILTER_FREQUENCY_COUNT];
+// Running power as a sum plus the rounding error it has lost.
+static float powerSum[FILTER_FREQUENCY_COUNT];
+static float powerCompensation[FILTER_FREQUENCY_COUNT];
+
+// Adds value to *sum, keeping the rounding error in *compensation (Neumaier).
+static void addCompensated(float *sum, float *compensation, float value) {
+  float t = *sum + value;
+  if (fabsf(*sum) >= fabsf(value))
+    *compensation += (*sum - t) + value;
+  else
+    *compensation += (value - t) + *sum;
+  *sum = t;
+}
+
+// Must call this prior to using any filterFloat functions.
+// Rounds the coefficients in filter.c to float and zeros all state.
+void filterFloat_init(void) {
+  const double *fir = filter_getFirCoefficientArray();
+  for (uint16_t i = 0; i < FIR_COEFF_COUNT; i++) {
+    firCoeffs[i] = (float)fir[i];
+  }
+  for (uint16_t i = 0; i < 2 * FIR_COEFF_COUNT; i++) {
+    xHistory[i] = 0.0f;
+  }
+  xIndexIn = 0;
+  firOutput = 0.0f;
+
+  for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+       filterNumber++) {
+    biquad_section_t designed[BIQUAD_MAX_SECTION_COUNT];
+    uint16_t designedCount = 0;
+    double centerFrequency = 2.0 * M_PI * FILTER_FIR_DECIMATION_FACTOR /
+                             filter_frequencyTickTable[filterNumber];
+    if (!biquad_design(filter_getIirBCoefficientArray(filterNumber),
+                       filter_getIirACoefficientArray(filterNumber),
+                       FILTER_IIR_ORDER, centerFrequency, designed,
+                       &designedCount)) {
+      printf("filterFloat_init(): unable to factor IIR filter %d into "
+             "biquads.\n",
+             filterNumber);
+      designedCount = 0;
+    }
+    // Sections the filter could not be factored into pass nothing.
+    for (uint16_t s = designedCount; s < SECTION_COUNT; s++) {
+      designed[s] = (biquad_section_t){{0.0, 0.0, 0.0}, {0.0, 0.0}};
+    }
+    biquad_initFloatSections(designed, SECTION_COUNT, sections[filterNumber]);
+
+    for (uint16_t i = 0; i < OUTPUT_HISTORY_SIZE; i++) {
+      outputHistory[filterNumber][i] = 0.0f;
+    }
+    displacedOutput[filterNumber] = 0.0f;
+    powerSum[filterNumber] = 0.0f;
+    powerCompensation[filterNumber] = 0.0f;
+  }
+  outputIndexIn = 0;
+}
+
+// Adds an input to the FIR history.
+void filterFloat_addNewInput(float x) {
+  xHistory[xIndexIn] = x;
+  xHistory[xIndexIn + FIR_COEFF_COUNT] = x;
+  xIndexIn = (xIndexIn + 1 == FIR_COEFF_COUNT) ? 0 : xIndexIn + 1;
+}
+
+// Runs the FIR filter over the FIR history. The output is returned and
+// becomes the input to the IIR filters.
+float filterFloat_firFilter(void) {
+  const float *window = &xHistory[xIndexIn]; // Oldest first.
+  float acc = 0.0f;
+  for (uint16_t i = 0; i < FIR_COEFF_COUNT; i++) {
+    acc += firCoeffs[i] * window[(FIR_COEFF_COUNT - 1) - i];
+  }
+  firOutput = acc;
+  // The new output index is shared by all IIR filters.
+  outputIndexIn = (outputIndexIn + 1 == OUTPUT_HISTORY_SIZE)
+                      ? 0
+                      : outputIndexIn + 1;
+  return firOutput;
+}
+
+// Runs a single IIR filter on the most recent FIR output.
+// The output is returned and is also stored for the power computation.
+float filterFloat_iirFilter(uint16_t filterNumber) {
+  float z = biquad_runFloatCascade(sections[filterNumber], SECTION_COUNT,
+                                   firOutput);
+  displacedOutput[filterNumber] = outputHistory[filterNumber][outputIndexIn];
+  outputHistory[filterNumber][outputIndexIn] = z;
+  return z;
+}
+
+// Same contract as filter_computePower(): recomputes from every stored output
+// if forceComputeFromScratch is true, otherwise updates incrementally.
+float filterFloat_computePower(uint16_t filterNumber,
+                               bool forceComputeFromScratch) {
+  if (forceComputeFromScratch) {
+    powerSum[filterNumber] = 0.0f;
+    powerCompensation[filterNumber] = 0.0f;
+    for (uint16_t i = 0; i < OUTPUT_HISTORY_SIZE; i++) {
+      float z = outputHistory[filterNumber][i];
+      addCompensated(&powerSum[filterNumber], &powerCompensation[filterNumber],
+                     z * z);
+    }
+  } else {
+    float newest = outputHistory[filterNumber][outputIndexIn];
+    float displaced = displacedOutput[filterNumber];
+    addCompensated(&powerSum[filterNumber], &powerCompensation[filterNumber],
+                   newest * newest);
+    addCompensated(&powerSum[filterNumber], &powerCompensation[filterNumber],
+                   -(displaced * displaced));
+  }
+  // Only the first call after a new output may remove the displaced one.
+  displacedOutput[filterNumber] = outputHistory[filterNumber][outputIndexIn];
+  return powerSum[filterNumber] + powerCompensation[filterNumber];
+}
@@ -0,0 +1,50 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERFLOAT_H_
+#define FILTERFLOAT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single-precision implementation of the filter chain in filter.c, a step
+// between the double chain and filterFixed.c. Single precision runs faster on
+// the VFPv3 and is the only floating-point type NEON handles.
+// 1. The decimating FIR filter uses float coefficients, a float input history
+// and a float accumulator.
+// 2. Each IIR filter runs as a cascade of single-precision biquads (see
+// biquad.h). A 10th-order direct form does not keep its poles inside the unit
+// circle once its coefficients are rounded to float.
+// 3. Power is a compensated running sum of squared outputs, so the 24-bit
+// mantissa does not drift as outputs are added and removed.
+// Define FILTER_SINGLE_PRECISION in filter.h to route the filter_* API through
+// this module. It can also be called directly, e.g. to compare it against the
+// double-precision path.
+
+// Must call this prior to using any filterFloat functions.
+// Rounds the coefficients in filter.c to float and zeros all state.
+void filterFloat_init(void);
+
+// Adds an input to the FIR history.
+void filterFloat_addNewInput(float x);
+
+// Runs the FIR filter over the FIR history. The output is returned and
+// becomes the input to the IIR filters.
+float filterFloat_firFilter(void);
+
+// Runs a single IIR filter on the most recent FIR output.
+// The output is returned and is also stored for the power computation.
+float filterFloat_iirFilter(uint16_t filterNumber);
+
+// Same contract as filter_computePower(): recomputes from every stored output
+// if forceComputeFromScratch is true, otherwise updates incrementally.
+float filterFloat_computePower(uint16_t filterNumber,
+                               bool forceComputeFromScratch);
+
+#endif /* FILTERFLOAT_H_ */
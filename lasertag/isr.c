@@ -1,8 +1,11 @@
 #include "isr.h"
 #include "buffer.h"
+#include "cic.h"
+#include "filter.h"
 #include "hitLedTimer.h"
 #include "include/interrupts.h"
 #include "lockoutTimer.h"
+#include "sensors.h"
 #include "transmitter.h"
 #include "trigger.h"
 #include "sound/sound.h"
@@ -11,6 +14,11 @@
 // Add function calls for state machine tick functions and
 // other interrupt related modules.
 
+#if INTERRUPTS_XADC_SENSOR_COUNT == 1 && defined(FILTER_CIC_IN_ISR)
+// Decimates the ADC values, so only the CIC outputs enter the ADC buffer.
+static cic_t adcDecimator;
+#endif
+
 // Perform initialization for interrupt and timing related modules.
 void isr_init() {
   trigger_init();
@@ -18,6 +26,9 @@ void isr_init() {
   lockoutTimer_init();
   transmitter_init();
   buffer_init();
+#if INTERRUPTS_XADC_SENSOR_COUNT == 1 && defined(FILTER_CIC_IN_ISR)
+  cic_init(&adcDecimator, FILTER_FIR_DECIMATION_FACTOR, FILTER_ADC_MAX_VALUE);
+#endif
   sound_init();
   hitLedTimer_enable();
 }
@@ -30,5 +41,17 @@ void isr_function() {
   transmitter_tick();
   sound_tick();
   // Grab data from the ADC and store it in the ADC buffer
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+  uint32_t sensorValues[INTERRUPTS_XADC_SENSOR_COUNT];
+  sensors_read(sensorValues);
+  for (uint16_t i = 0; i < INTERRUPTS_XADC_SENSOR_COUNT; i++) {
+    buffer_pushoverSensor(i, sensorValues[i]);
+  }
+#elif defined(FILTER_CIC_IN_ISR)
+  uint32_t cicOutput;
+  if (cic_addSample(&adcDecimator, interrupts_getAdcData(), &cicOutput))
+    buffer_pushover(cicOutput);
+#else
   buffer_pushover(interrupts_getAdcData());
+#endif
 }
@@ -36,6 +36,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "lockoutTimer.h"
 #include "mio.h"
 #include "runningModes.h"
+#include "sensors.h"
 #include "sound.h"
 #include "switches.h"
 #include "transmitter.h"
@@ -68,6 +69,7 @@ int main() {
   isr_init();
 
   interrupts_initAll(false);          // main interrupt init function.
+  sensors_init();                     // XADC sensor channels, if several.
   interrupts_enableTimerGlobalInts(); // enable global interrupts.
   interrupts_startArmPrivateTimer();  // start the main timer.
   interrupts_enableArmInts(); // now the ARM processor can see interrupts.
@@ -1,9 +1,73 @@
+#include <assert.h> // assert
 #include <stdio.h>  // printf
 #include <stdlib.h> // malloc, free, abort
-#include <string.h> // strncpy
+#include <string.h> // memcpy, strncpy
  
+#include "cycleCounter.h"
 #include "queue.h"
  
+// One error in the global error log.
+typedef struct {
+	char name[QUEUE_MAX_NAME_SIZE]; // The queue's, copied so it may go away.
+	queue_error_t kind;
+	queue_index_t index; // See queue_error_t.
+	uint64_t time; // cycleCounter_read() when it happened.
+} queue_errorLogEntry_t;
+ 
+// The newest QUEUE_ERROR_LOG_SIZE errors, oldest at errorLog[errorLogIndexOut].
+static queue_errorLogEntry_t errorLog[QUEUE_ERROR_LOG_SIZE];
+static uint32_t errorLogIndexOut;
+static uint32_t errorLogCount;
+// Errors pushed out of the full log since the last queue_printErrors().
+static uint32_t errorLogDropCount;
+ 
+// printf() formats of each kind, given the queue name and the index.
+static const char *errorFormats[QUEUE_ERROR_KIND_COUNT] = {
+	"Error: queue %s is full, %u value(s) not pushed",
+	"Error: queue %s is empty, %u element(s) not popped",
+	"Error: queue %s: index or count %u is out of bounds",
+	"Error: queue %s is not mirrored, no window of %u elements",
+};
+ 
+// Prints one error on a line.
+static void printError(const char *name, queue_error_t kind,
+                       queue_index_t index, uint64_t time)
+{
+	printf(errorFormats[kind], name, index);
+	printf(" (at %llu)\n", (unsigned long long)time);
+}
+ 
+// Counts an error in the queue and adds it to the error log, dropping the
+// oldest entry if the log is full. Bounded work and no I/O, unless
+// QUEUE_ASSERT_ON_ERROR is defined.
+static void recordError(queue_t *q, queue_error_t kind, queue_index_t index)
+{
+	q->errorCounts[kind]++;
+#ifdef QUEUE_ASSERT_ON_ERROR
+	printError(q->name, kind, index, cycleCounter_read());
+	assert(false);
+#endif
+	if (errorLogCount == QUEUE_ERROR_LOG_SIZE) {
+		errorLogIndexOut = (errorLogIndexOut + 1) % QUEUE_ERROR_LOG_SIZE;
+		errorLogCount--;
+		errorLogDropCount++;
+	}
+	queue_errorLogEntry_t *entry =
+		&errorLog[(errorLogIndexOut + errorLogCount) % QUEUE_ERROR_LOG_SIZE];
+	errorLogCount++;
+	memcpy(entry->name, q->name, QUEUE_MAX_NAME_SIZE);
+	entry->kind = kind;
+	entry->index = index;
+	entry->time = cycleCounter_read();
+}
+ 
+// Counts of each kind start at zero.
+static void clearErrorCounts(queue_t *q)
+{
+	for (uint16_t k = 0; k < QUEUE_ERROR_KIND_COUNT; k++)
+		q->errorCounts[k] = 0;
+}
+ 
 // Allocates memory for the queue (the data* pointer) and initializes all
 // parts of the data structure. Prints out an error message if malloc() fails
 // and calls assert(false) to print-out line-number information and die.
@@ -20,20 +84,68 @@ void queue_init(queue_t *q, queue_size_t size, const char *name)
 	q->elementCount = 0;
 	// Queue capacity.
 	q->size = size;
+	// The data array is rounded up to a power of two and indexed with a mask.
+	q->mask = QUEUE_STORAGE_SIZE(size) - 1;
 	// Points to a dynamically-allocated array.
-	q->data = malloc(size * sizeof(queue_data_t));
+	q->data = malloc((q->mask + 1) * sizeof(queue_data_t));
 	if (q->data == NULL) abort();
+	q->ownsData = true;
+	// Not mirrored: pushes write each element once.
+	q->mirrorOffset = 0;
 	// True if queue_pop() is called on an empty queue. Reset
 	// to false after queue_push() is called.
 	q->underflowFlag = false;
 	// True if queue_push() is called on a full queue. Reset to
 	// false once queue_pop() is called.
 	q->overflowFlag = false;
+	// Errors of each kind since initialization.
+	clearErrorCounts(q);
 	// Name for debugging purposes.
 	strncpy(q->name, name, QUEUE_MAX_NAME_SIZE);
 	q->name[QUEUE_MAX_NAME_SIZE-1] = '\0';
 }
  
+// Same as queue_init(), but the queue keeps its data in
+// storage[0..QUEUE_STORAGE_SIZE(size)-1], which the caller provides, instead of
+// malloc()'ing it.
+void queue_initWithStorage(queue_t *q, queue_data_t *storage,
+                           queue_size_t size, const char *name)
+{
+	q->indexIn = 0;
+	q->indexOut = 0;
+	q->elementCount = 0;
+	q->size = size;
+	q->mask = QUEUE_STORAGE_SIZE(size) - 1;
+	q->mirrorOffset = 0;
+	q->data = storage;
+	q->ownsData = false; // queue_garbageCollect() must not free it.
+	q->underflowFlag = false;
+	q->overflowFlag = false;
+	clearErrorCounts(q);
+	strncpy(q->name, name, QUEUE_MAX_NAME_SIZE);
+	q->name[QUEUE_MAX_NAME_SIZE-1] = '\0';
+}
+ 
+// Same as queue_init(), but every push writes the element twice,
+// QUEUE_STORAGE_SIZE(size) apart.
+void queue_initMirrored(queue_t *q, queue_size_t size, const char *name)
+{
+	queue_data_t *storage =
+		malloc(QUEUE_MIRRORED_STORAGE_SIZE(size) * sizeof(queue_data_t));
+	if (storage == NULL) abort();
+	queue_initMirroredWithStorage(q, storage, size, name);
+	q->ownsData = true;
+}
+ 
+// queue_initMirrored() on caller storage of QUEUE_MIRRORED_STORAGE_SIZE(size)
+// elements.
+void queue_initMirroredWithStorage(queue_t *q, queue_data_t *storage,
+                                   queue_size_t size, const char *name)
+{
+	queue_initWithStorage(q, storage, size, name);
+	q->mirrorOffset = q->mask + 1;
+}
+ 
 // Get the user-assigned name for the queue.
 const char *queue_name(queue_t *q)
 {
@@ -59,42 +171,43 @@ bool queue_empty(queue_t *q)
 }
  
 // If the queue is not full, pushes a new element into the queue and clears the
-// underflowFlag. IF the queue is full, set the overflowFlag, print an error
-// message and DO NOT change the queue.
+// underflowFlag. IF the queue is full, set the overflowFlag, record an error
+// and DO NOT change the queue.
 void queue_push(queue_t *q, queue_data_t value)
 {
 	// if queue isn't full, add given element, increment 
 	// elementCount, set underflowFlag to false, and update indexIn.
-	// otherwise, set overflowFlag and print error message
+	// otherwise, set overflowFlag and record an error
 	if (!queue_full(q)) {
 		q->data[q->indexIn] = value;
-        q->indexIn = (q->indexIn + 1) % q->size;
+		q->data[q->indexIn + q->mirrorOffset] = value; // The mirror copy.
+        q->indexIn = (q->indexIn + 1) & q->mask;
 		q->elementCount++;
 		q->underflowFlag = false;
 	} else {
 		q->overflowFlag = true;
-		printf("Error: the queue is full.\n");
+		recordError(q, queue_overflowError_e, 1);
 	}
 }
  
 // If the queue is not empty, remove and return the oldest element in the queue.
 // If the overflowFlag is set, unset it
-// If the queue is empty, set the underflowFlag, print an error message, and DO
-// NOT change the queue.
+// If the queue is empty, set the underflowFlag, record an error, and DO NOT
+// change the queue.
 queue_data_t queue_pop(queue_t *q)
 {
 	// if queue isn't empty, return and remove oldest element, decrement 
 	// elementCount, set overflowFlag to false, and update indexOut.
-	// otherwise, set underflowFlag and print error message
+	// otherwise, set underflowFlag and record an error
 	if (!queue_empty(q)) {
         queue_data_t value = q->data[q->indexOut];
-        q->indexOut = (q->indexOut + 1) % q->size;
+        q->indexOut = (q->indexOut + 1) & q->mask;
         q->elementCount--;
         q->overflowFlag = false; 
         return value;
     } else {
         q->underflowFlag = true;
-        printf("Error: the queue is empty.\n");
+        recordError(q, queue_underflowError_e, 1);
         return 0;
     }
 }
@@ -111,20 +224,130 @@ void queue_overwritePush(queue_t *q, queue_data_t value)
 	}
 }
  
+// Copies count values into the slots from indexIn on, in at most two pieces,
+// and into their mirror copies. The caller checks that they fit.
+static void copyIn(queue_t *q, const queue_data_t values[], queue_size_t count)
+{
+	queue_size_t firstCount = (q->mask + 1) - q->indexIn;
+	if (firstCount > count)
+		firstCount = count;
+	queue_size_t secondCount = count - firstCount;
+	memcpy(&q->data[q->indexIn], values, firstCount * sizeof(queue_data_t));
+	memcpy(q->data, &values[firstCount], secondCount * sizeof(queue_data_t));
+	if (q->mirrorOffset != 0) {
+		memcpy(&q->data[q->indexIn + q->mirrorOffset], values,
+		       firstCount * sizeof(queue_data_t));
+		memcpy(&q->data[q->mirrorOffset], &values[firstCount],
+		       secondCount * sizeof(queue_data_t));
+	}
+	q->indexIn = (q->indexIn + count) & q->mask;
+	q->elementCount += count;
+}
+ 
+// Pushes as many of values[0..count-1] as fit. If some do not, sets the
+// overflowFlag and records an error.
+queue_size_t queue_pushMany(queue_t *q, const queue_data_t values[],
+                            queue_size_t count)
+{
+	queue_size_t pushCount = q->size - q->elementCount;
+	if (pushCount > count)
+		pushCount = count;
+	if (pushCount > 0) {
+		copyIn(q, values, pushCount);
+		q->underflowFlag = false;
+	}
+	if (pushCount < count) {
+		q->overflowFlag = true;
+		recordError(q, queue_overflowError_e, count - pushCount);
+	}
+	return pushCount;
+}
+ 
+// Pops up to count elements into values[] (if not NULL). If the queue holds
+// fewer, sets the underflowFlag and records an error.
+queue_size_t queue_popMany(queue_t *q, queue_data_t values[],
+                           queue_size_t count)
+{
+	queue_size_t popCount = (count < q->elementCount) ? count : q->elementCount;
+	if (values != NULL) {
+		queue_span_t span = queue_span(q);
+		queue_size_t firstCount =
+			(popCount < span.firstCount) ? popCount : span.firstCount;
+		memcpy(values, span.first, firstCount * sizeof(queue_data_t));
+		memcpy(&values[firstCount], span.second,
+		       (popCount - firstCount) * sizeof(queue_data_t));
+	}
+	if (popCount > 0) {
+		q->indexOut = (q->indexOut + popCount) & q->mask;
+		q->elementCount -= popCount;
+		q->overflowFlag = false;
+	}
+	if (popCount < count) {
+		q->underflowFlag = true;
+		recordError(q, queue_underflowError_e, count - popCount);
+	}
+	return popCount;
+}
+ 
+// Fills the queue with value, mirror copy included.
+void queue_fill(queue_t *q, queue_data_t value)
+{
+	queue_size_t slotCount = (q->mask + 1) + q->mirrorOffset;
+	for (queue_index_t i = 0; i < slotCount; i++) {
+		q->data[i] = value;
+	}
+	q->indexOut = 0;
+	q->indexIn = q->size & q->mask;
+	q->elementCount = q->size;
+	q->underflowFlag = false;
+	q->overflowFlag = false;
+}
+ 
+// Returns the elements of the queue as at most two contiguous pieces. A
+// mirrored queue's elements continue into the mirror copy, so it needs one.
+queue_span_t queue_span(const queue_t *q)
+{
+	queue_span_t span;
+	queue_size_t firstCount = (q->mask + 1) - q->indexOut;
+	if (q->mirrorOffset != 0 || firstCount > q->elementCount)
+		firstCount = q->elementCount;
+	span.first = &q->data[q->indexOut];
+	span.firstCount = firstCount;
+	span.second = q->data;
+	span.secondCount = q->elementCount - firstCount;
+	return span;
+}
+ 
 // Provides random-access read capability to the queue.
 // Low-valued indexes access older queue elements while higher-value indexes
-// access newer elements (according to the order that they were added). Print a
-// meaningful error message if an error condition is detected.
+// access newer elements (according to the order that they were added). Record
+// an error if the index is out of bounds.
 queue_data_t queue_readElementAt(queue_t *q, queue_index_t index)
 {
 	if (index >= 0 && index < q->elementCount) {
-		return q->data[(q->indexOut + index) % q->size];
+		return q->data[(q->indexOut + index) & q->mask];
 	} else {
-		printf("Error: Index %d is out of bounds\n", index);
+		recordError(q, queue_outOfBoundsError_e, index);
 		return 0;
 	}
 }
  
+// Returns a pointer to the newest count elements of a mirrored queue, oldest
+// first. Record an error if the queue is not mirrored or the window is too
+// large.
+const queue_data_t *queue_window(queue_t *q, queue_size_t count)
+{
+	if (q->mirrorOffset == 0) {
+		recordError(q, queue_notMirroredError_e, count);
+		return NULL;
+	}
+	if (count > q->elementCount) {
+		recordError(q, queue_outOfBoundsError_e, count);
+		return NULL;
+	}
+	return &q->data[(q->indexIn - count) & q->mask];
+}
+ 
 // Returns a count of the elements currently contained in the queue.
 queue_size_t queue_elementCount(queue_t *q)
 {
@@ -145,8 +368,34 @@ bool queue_overflow(queue_t *q)
 	return q->overflowFlag;
 }
  
-// Frees the storage that you malloc'd before.
+// Frees the storage that you malloc'd before. Does nothing to storage passed to
+// queue_initWithStorage().
 void queue_garbageCollect(queue_t *q)
 {
-	free(q->data);
+	if (q->ownsData)
+		free(q->data);
+}
+ 
+// Returns the number of errors of the given kind recorded for the queue.
+uint32_t queue_errorCount(queue_t *q, queue_error_t kind)
+{
+	return q->errorCounts[kind];
+}
+ 
+// Prints and empties the error log, oldest first.
+uint32_t queue_printErrors(void)
+{
+	uint32_t printCount = errorLogCount;
+	while (errorLogCount > 0) {
+		queue_errorLogEntry_t *entry = &errorLog[errorLogIndexOut];
+		printError(entry->name, entry->kind, entry->index, entry->time);
+		errorLogIndexOut = (errorLogIndexOut + 1) % QUEUE_ERROR_LOG_SIZE;
+		errorLogCount--;
+	}
+	if (errorLogDropCount > 0) {
+		printf("Error: %u more queue errors were dropped from the log\n",
+		       errorLogDropCount);
+		errorLogDropCount = 0;
+	}
+	return printCount;
 }
\ No newline at end of file
@@ -29,6 +29,36 @@ typedef double queue_data_t;
 // Not sure we need something different from the index type.
 typedef uint32_t queue_size_t;
 
+// The data array of a queue of capacity size holds QUEUE_STORAGE_SIZE(size)
+// elements: size rounded up to a power of two, so indexes wrap with a mask
+// instead of a divide. Constant for a constant size, so it can size arrays.
+#define QUEUE_SMEAR_1(n) ((n) | ((n) >> 1))
+#define QUEUE_SMEAR_2(n) (QUEUE_SMEAR_1(n) | (QUEUE_SMEAR_1(n) >> 2))
+#define QUEUE_SMEAR_4(n) (QUEUE_SMEAR_2(n) | (QUEUE_SMEAR_2(n) >> 4))
+#define QUEUE_SMEAR_8(n) (QUEUE_SMEAR_4(n) | (QUEUE_SMEAR_4(n) >> 8))
+#define QUEUE_SMEAR_16(n) (QUEUE_SMEAR_8(n) | (QUEUE_SMEAR_8(n) >> 16))
+#define QUEUE_STORAGE_SIZE(size) (QUEUE_SMEAR_16((queue_size_t)(size)-1) + 1)
+// A mirrored queue (see queue_initMirrored()) keeps a second copy of its data
+// right after the first.
+#define QUEUE_MIRRORED_STORAGE_SIZE(size) (2 * QUEUE_STORAGE_SIZE(size))
+
+// The checked functions never print: each error goes to a counter in its queue
+// and to a global error log, which queue_printErrors() prints later. The log
+// keeps the newest QUEUE_ERROR_LOG_SIZE errors and counts the ones it drops.
+#define QUEUE_ERROR_LOG_SIZE 32
+// Uncomment to stop at the first error: it is printed at once and
+// assert(false) is called. Only for debugging, since it prints from the caller.
+// #define QUEUE_ASSERT_ON_ERROR
+
+// Kinds of error, with the index each records in the error log.
+typedef enum {
+  queue_overflowError_e,    // Push to a full queue: values that did not fit.
+  queue_underflowError_e,   // Pop from an empty queue: elements missing.
+  queue_outOfBoundsError_e, // Read or window past the elements: index/count.
+  queue_notMirroredError_e  // Window of a queue that is not mirrored: count.
+} queue_error_t;
+#define QUEUE_ERROR_KIND_COUNT 4
+
 // The queue struct with elementCount to speed up computations to determine
 // element count. Queue will use the empty location and pointer arithmetic to
 // determine full and empty.
@@ -40,28 +70,68 @@ typedef struct {
   queue_index_t indexOut;
   // Keep track of the number of elements currently in queue.
   queue_size_t elementCount;
-  // This is the size of the data array. Actual queue
-  // capacity is one less.
+  // Capacity of the queue.
   queue_size_t size;
-  // Points to a dynamically-allocated array.
+  // QUEUE_STORAGE_SIZE(size) - 1: indexes into data wrap with this mask.
+  queue_index_t mask;
+  // QUEUE_STORAGE_SIZE(size) for a mirrored queue, whose pushes also write
+  // each element this far on, 0 otherwise.
+  queue_index_t mirrorOffset;
+  // Points to a dynamically-allocated array, or to the caller's storage
+  // (see queue_initWithStorage()).
   queue_data_t *data;
+  // True if data was malloc'd by queue_init() and queue_garbageCollect()
+  // frees it.
+  bool ownsData;
   // True if queue_pop() is called on an empty queue. Reset
   // to false after queue_push() is called.
   bool underflowFlag;
   // True if queue_push() is called on a full queue. Reset to
   // false once queue_pop() is called.
   bool overflowFlag;
+  // Errors of each kind (queue_error_t) since initialization.
+  uint32_t errorCounts[QUEUE_ERROR_KIND_COUNT];
   // Name for debugging purposes.
   char name[QUEUE_MAX_NAME_SIZE];
 } queue_t;
 
-// Allocates memory for the queue (the data* pointer) and initializes all
-// parts of the data structure. Prints out an error message if malloc() fails
-// and calls assert(false) to print-out line-number information and die.
+// The elements of a queue as at most two contiguous pieces, oldest first:
+// first[0..firstCount-1], then second[0..secondCount-1]. secondCount is 0 if
+// the elements do not wrap, and always for a mirrored queue. Valid until the
+// queue changes.
+typedef struct {
+  const queue_data_t *first;
+  queue_size_t firstCount;
+  const queue_data_t *second;
+  queue_size_t secondCount;
+} queue_span_t;
+
+// Allocates memory for the queue (the data* pointer, QUEUE_STORAGE_SIZE(size)
+// elements) and initializes all parts of the data structure. Prints out an
+// error message if malloc() fails and calls assert(false) to print-out
+// line-number information and die.
 // The queue is empty after initialization. To fill the queue with known
 // values (e.g. zeros), call queue_overwritePush() up to queue_size() times.
 void queue_init(queue_t *q, queue_size_t size, const char *name);
 
+// Same as queue_init(), but the queue keeps its data in
+// storage[0..QUEUE_STORAGE_SIZE(size)-1], which the caller provides and must
+// keep alive, instead of malloc()'ing it.
+// queue_garbageCollect() leaves the storage alone.
+void queue_initWithStorage(queue_t *q, queue_data_t *storage,
+                           queue_size_t size, const char *name);
+
+// Same as queue_init(), but the queue is mirrored: every push writes the
+// element twice, QUEUE_STORAGE_SIZE(size) apart, so the newest elements always
+// lie in order in one contiguous span (see queue_window()). Twice the memory
+// and one more store per push.
+void queue_initMirrored(queue_t *q, queue_size_t size, const char *name);
+
+// queue_initMirrored() on caller storage of
+// QUEUE_MIRRORED_STORAGE_SIZE(size) elements, like queue_initWithStorage().
+void queue_initMirroredWithStorage(queue_t *q, queue_data_t *storage,
+                                   queue_size_t size, const char *name);
+
 // Get the user-assigned name for the queue.
 const char *queue_name(queue_t *q);
 
@@ -75,25 +145,64 @@ bool queue_full(queue_t *q);
 bool queue_empty(queue_t *q);
 
 // If the queue is not full, pushes a new element into the queue and clears the
-// underflowFlag. IF the queue is full, set the overflowFlag, print an error
-// message and DO NOT change the queue.
+// underflowFlag. IF the queue is full, set the overflowFlag, record an error
+// and DO NOT change the queue.
 void queue_push(queue_t *q, queue_data_t value);
 
 // If the queue is not empty, remove and return the oldest element in the queue.
-// If the queue is empty, set the underflowFlag, print an error message, and DO
-// NOT change the queue.
+// If the queue is empty, set the underflowFlag, record an error, and DO NOT
+// change the queue.
 queue_data_t queue_pop(queue_t *q);
 
 // If the queue is full, call queue_pop() and then call queue_push().
 // If the queue is not full, just call queue_push().
 void queue_overwritePush(queue_t *q, queue_data_t value);
 
+// Pushes values[0..count-1], oldest first, with at most two block copies. Same
+// result as count calls to queue_push(): the values that fit are pushed and,
+// if some do not, the overflowFlag is set and one error is recorded.
+// Returns the number of values pushed.
+queue_size_t queue_pushMany(queue_t *q, const queue_data_t values[],
+                            queue_size_t count);
+
+// Pops up to count elements into values[], oldest first, or drops them if
+// values is NULL. Same result as count calls to queue_pop(): if the queue
+// holds fewer, all are popped, the underflowFlag is set and one error is
+// recorded. Returns the number of elements popped.
+queue_size_t queue_popMany(queue_t *q, queue_data_t values[],
+                           queue_size_t count);
+
+// Fills the queue with value, the same as queue_size() calls to
+// queue_overwritePush(q, value).
+void queue_fill(queue_t *q, queue_data_t value);
+
+// Returns the elements of the queue as at most two contiguous pieces, without
+// copying (see queue_span_t).
+queue_span_t queue_span(const queue_t *q);
+
 // Provides random-access read capability to the queue.
 // Low-valued indexes access older queue elements while higher-value indexes
-// access newer elements (according to the order that they were added). Print a
-// meaningful error message if an error condition is detected.
+// access newer elements (according to the order that they were added). Records
+// an error and returns 0 if index is out of bounds.
 queue_data_t queue_readElementAt(queue_t *q, queue_index_t index);
 
+// Returns a pointer to the newest count elements of a mirrored queue, in
+// order: [0] is the oldest of them, [count - 1] the newest. The span stays
+// valid until the next push. Records an error and returns NULL if the queue is
+// not mirrored or holds fewer than count elements.
+const queue_data_t *queue_window(queue_t *q, queue_size_t count);
+
+// Returns the number of errors of the given kind recorded for the queue since
+// it was initialized.
+uint32_t queue_errorCount(queue_t *q, queue_error_t kind);
+
+// Prints and removes the errors in the global error log, oldest first: the
+// queue name, kind, index and time (cycleCounter_read()) of each, then how many
+// were dropped since the last call. Call it where blocking on the console does
+// no harm, not from the ISR or the filters. Returns the number of errors
+// printed.
+uint32_t queue_printErrors(void);
+
 // Returns a count of the elements currently contained in the queue.
 queue_size_t queue_elementCount(queue_t *q);
 
@@ -105,7 +214,58 @@ bool queue_underflow(queue_t *q);
 // queue).
 bool queue_overflow(queue_t *q);
 
-// Frees the storage that you malloc'd before.
+// Frees the storage that you malloc'd before. Does nothing to storage passed to
+// queue_initWithStorage().
 void queue_garbageCollect(queue_t *q);
 
+/******************************************************************************
+***** Unchecked accessors for hot loops. The caller guarantees what the checked
+***** functions above would test: no error is recorded and no flag is set.
+******************************************************************************/
+
+// queue_readElementAt() for index < queue_elementCount(q).
+static inline queue_data_t queue_fastReadElementAt(const queue_t *q,
+                                                   queue_index_t index) {
+  return q->data[(q->indexOut + index) & q->mask];
+}
+
+// Returns the newest element of a queue that is not empty.
+static inline queue_data_t queue_fastReadNewest(const queue_t *q) {
+  return q->data[(q->indexIn - 1) & q->mask];
+}
+
+// queue_window() on a mirrored queue holding at least count elements.
+static inline const queue_data_t *queue_fastWindow(const queue_t *q,
+                                                   queue_size_t count) {
+  return &q->data[(q->indexIn - count) & q->mask];
+}
+
+// queue_push() on a queue that is not full.
+static inline void queue_fastPush(queue_t *q, queue_data_t value) {
+  q->data[q->indexIn] = value;
+  q->data[q->indexIn + q->mirrorOffset] = value; // Same slot if not mirrored.
+  q->indexIn = (q->indexIn + 1) & q->mask;
+  q->elementCount++;
+  q->underflowFlag = false;
+}
+
+// queue_pop() on a queue that is not empty.
+static inline queue_data_t queue_fastPop(queue_t *q) {
+  queue_data_t value = q->data[q->indexOut];
+  q->indexOut = (q->indexOut + 1) & q->mask;
+  q->elementCount--;
+  q->overflowFlag = false;
+  return value;
+}
+
+// queue_overwritePush(), which never fails, without the calls.
+static inline void queue_fastOverwritePush(queue_t *q, queue_data_t value) {
+  if (q->elementCount == q->size) {
+    q->indexOut = (q->indexOut + 1) & q->mask; // Drop the oldest.
+    q->elementCount--;
+    q->overflowFlag = false;
+  }
+  queue_fastPush(q, value);
+}
+
 #endif /* QUEUE_H_ */
\ No newline at end of file
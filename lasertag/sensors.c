@@ -0,0 +1,54 @@
+#include "sensors.h"
+#include "include/interrupts.h"
+
+#include <stdio.h>
+
+#include "xparameters.h"
+#include "xsysmon.h"
+
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+// The XADC that interrupts_initAll() sets up. interrupts.c keeps its own handle
+// to itself, so this one only reaches the same registers.
+static XSysMon sensorsXadc;
+static const u8 sensorChannels[] = INTERRUPTS_XADC_SENSOR_CHANNELS;
+// Sequencer enable bit of each channel in INTERRUPTS_XADC_SENSOR_CHANNELS.
+static const u64 sensorSequencerBits[] = {XSM_SEQ_CH_AUX14, XSM_SEQ_CH_AUX15,
+                                          XSM_SEQ_CH_AUX07, XSM_SEQ_CH_AUX06};
+#endif
+
+// Call after interrupts_initAll(). Returns false, and prints why, if the XADC
+// could not be set up.
+bool sensors_init() {
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+  XSysMon_Config *config = XSysMon_LookupConfig(XPAR_AXI_XADC_0_DEVICE_ID);
+  if (config == NULL || XSysMon_CfgInitialize(&sensorsXadc, config,
+                                              config->BaseAddress) != XST_SUCCESS) {
+    printf("sensors_init(): XSysMon initialize failed.\n");
+    return false;
+  }
+  u64 sequencerChannels = 0;
+  for (uint16_t i = 0; i < INTERRUPTS_XADC_SENSOR_COUNT; i++) {
+    sequencerChannels |= sensorSequencerBits[i];
+  }
+  // The channel enables can only be changed with the sequencer in safe mode.
+  XSysMon_SetSequencerMode(&sensorsXadc, XSM_SEQ_MODE_SAFE);
+  if (XSysMon_SetSeqChEnables(&sensorsXadc, sequencerChannels) != XST_SUCCESS) {
+    printf("sensors_init(): XSysMon set sequencer channels failed.\n");
+    return false;
+  }
+  XSysMon_SetSequencerMode(&sensorsXadc, XSM_SEQ_MODE_CONTINPASS);
+#endif
+  return true;
+}
+
+// Reads the latest conversion of each sensor into
+// values[0 .. INTERRUPTS_XADC_SENSOR_COUNT - 1].
+void sensors_read(uint32_t values[]) {
+#if INTERRUPTS_XADC_SENSOR_COUNT > 1
+  for (uint16_t i = 0; i < INTERRUPTS_XADC_SENSOR_COUNT; i++) {
+    values[i] = XSysMon_GetAdcData(&sensorsXadc, sensorChannels[i]) >> 4;
+  }
+#else
+  values[0] = interrupts_getAdcData();
+#endif
+}
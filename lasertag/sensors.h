@@ -0,0 +1,30 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SENSORS_H_
+#define SENSORS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Reads the photodiodes on the XADC channels of
+// INTERRUPTS_XADC_SENSOR_CHANNELS (interrupts.h). interrupts_initAll() sets the
+// XADC up to convert channel 14 alone; with more than one sensor
+// (INTERRUPTS_XADC_SENSOR_COUNT), sensors_init() switches it to a sequencer
+// that cycles through the sensor channels.
+
+// Call after interrupts_initAll(). Returns false, and prints why, if the XADC
+// could not be set up; isr_function() must not run in that case.
+bool sensors_init();
+
+// Reads the latest conversion of each sensor into
+// values[0 .. INTERRUPTS_XADC_SENSOR_COUNT - 1]. Called by isr_function().
+void sensors_read(uint32_t values[]);
+
+#endif /* SENSORS_H_ */
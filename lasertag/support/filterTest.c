@@ -18,16 +18,24 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #ifdef ADC_THROUGH_DETECTOR
-#include "detector.h"
 #include "buffer.h"
 #define ADC_INTEGER_MIN_VALUE 0
 #define ADC_INTEGER_MAX_VALUE 4095
 #endif
 
 #include "queue.h"
+#include "cic.h"
+#include "cycleCounter.h"
+#include "detector.h"
+#include "dft.h"
+#include "diversity.h"
 #include "filter.h"
+#include "filterDesign.h"
+#include "filterFixed.h"
+#include "filterFloat.h"
 #include "histogram.h"
 #include "utils.h"
 
@@ -951,6 +959,2093 @@ bool filterTest_runPowerTest(void) {
   return firstComputeStatus & incrementalComputeStatus;
 }
 
+// filterTest_runPowerDriftTest() alternates loud and quiet stretches of
+// outputs, each longer than the power window.
+#define POWER_DRIFT_TEST_FILTER_NUMBER 0
+#define POWER_DRIFT_TEST_CYCLE_COUNT 50
+#define POWER_DRIFT_TEST_STRETCH_LENGTH 3000
+#define POWER_DRIFT_TEST_LOUD_AMPLITUDE 100.0
+#define POWER_DRIFT_TEST_QUIET_AMPLITUDE 0.001
+// Largest allowed error of the incremental power, relative to the golden power,
+// at the end of each quiet stretch.
+#define POWER_DRIFT_TEST_EPSILON 1.0E-9
+// Subtracting loud outputs from a running sum leaves rounding errors that are
+// large next to the power of quiet outputs. This pushes alternating loud and
+// quiet random outputs into one output queue and checks the incremental power
+// at the end of each quiet stretch. Also prints the drift statistics.
+bool filterTest_runPowerDriftTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runPowerDriftTest() =====\n");
+  bool success = true; // Be optimistic.
+  filter_init();
+  queue_t *q = filter_getIirOutputQueue(POWER_DRIFT_TEST_FILTER_NUMBER);
+  filter_computePower(POWER_DRIFT_TEST_FILTER_NUMBER, true, false);
+  double maxRelativeError = 0.0;
+  for (uint32_t cycle = 0; cycle < POWER_DRIFT_TEST_CYCLE_COUNT; cycle++) {
+    for (uint32_t i = 0; i < 2 * POWER_DRIFT_TEST_STRETCH_LENGTH; i++) {
+      double amplitude = (i < POWER_DRIFT_TEST_STRETCH_LENGTH)
+                             ? POWER_DRIFT_TEST_LOUD_AMPLITUDE
+                             : POWER_DRIFT_TEST_QUIET_AMPLITUDE;
+      queue_overwritePush(q, amplitude * (filterTest_randomValue0To1() - 0.5));
+      filter_computePower(POWER_DRIFT_TEST_FILTER_NUMBER, false, false);
+    }
+    double goldenValue = filterTest_computeGoldenPowerValue(q);
+    double relativeError =
+        fabs(filter_getCurrentPowerValue(POWER_DRIFT_TEST_FILTER_NUMBER) -
+             goldenValue) /
+        goldenValue;
+    if (relativeError > maxRelativeError)
+      maxRelativeError = relativeError;
+  }
+  if (maxRelativeError > POWER_DRIFT_TEST_EPSILON) {
+    printf("Incremental power drifted by %le of the quiet power.\n",
+           maxRelativeError);
+    success = false;
+  }
+  if (printMessageFlag) {
+    filter_powerDriftStatistics_t statistics;
+    filter_getPowerDriftStatistics(&statistics);
+    printf("Largest relative error after a quiet stretch: %le\n",
+           maxRelativeError);
+    printf("%d resyncs, largest drift corrected: %le (%le relative).\n",
+           statistics.resyncCount, statistics.maxAbsoluteDrift,
+           statistics.maxRelativeDrift);
+  }
+  filter_init(); // Leave the filters in a clean state for the next test.
+  printf("+++++ Exiting filterTest_runPowerDriftTest() +++++\n");
+  return success;
+}
+
+#ifndef FILTER_REDUCED_PRECISION
+// Number of FIR outputs compared by filterTest_runFirBlockTest().
+#define FIR_BLOCK_TEST_OUTPUT_COUNT 3000
+// Feeds the same random ADC values to filter_firFilterBlock() and, one at a
+// time, to filter_addNewInput()/filter_firFilter(). The outputs must be
+// identical, not just close. Reports the cost of both paths per output,
+// including the scaling of the raw values.
+bool filterTest_runFirBlockTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runFirBlockTest() =====\n");
+  bool success = true; // Be optimistic.
+  filter_init();       // Start both FIR paths from zero.
+  uint64_t sampleCycles = 0;
+  uint64_t blockCycles = 0;
+  for (uint32_t outputCount = 0; outputCount < FIR_BLOCK_TEST_OUTPUT_COUNT;
+       outputCount++) {
+    buffer_data_t rawAdcBlock[FILTER_FIR_DECIMATION_FACTOR];
+    for (uint16_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+      rawAdcBlock[i] = rand() % (FILTER_ADC_MAX_VALUE + 1);
+    }
+    uint64_t startCycles = cycleCounter_read();
+    for (uint16_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+      filter_addNewInput(filter_scaleAdcValue(rawAdcBlock[i]));
+    }
+    double firOutput = filter_firFilter();
+    uint64_t middleCycles = cycleCounter_read();
+    double firBlockOutput = filter_firFilterBlock(rawAdcBlock);
+    blockCycles += cycleCounter_read() - middleCycles;
+    sampleCycles += middleCycles - startCycles;
+    if (firOutput != firBlockOutput) {
+      printf("Output %d: filter_firFilterBlock() (%20.24le) does not match "
+             "filter_firFilter() (%20.24le).\n",
+             outputCount, firBlockOutput, firOutput);
+      success = false;
+      break;
+    }
+  }
+  if (printMessageFlag && success) {
+    printf("%d block FIR outputs matched bit for bit.\n",
+           FIR_BLOCK_TEST_OUTPUT_COUNT);
+    printf("Per output: %.1lf counts one sample at a time, %.1lf as a "
+           "block.\n",
+           (double)sampleCycles / FIR_BLOCK_TEST_OUTPUT_COUNT,
+           (double)blockCycles / FIR_BLOCK_TEST_OUTPUT_COUNT);
+  }
+  filter_init(); // Leave the filters in a clean state for the next test.
+  printf("+++++ Exiting filterTest_runFirBlockTest() +++++\n");
+  return success;
+}
+
+// filterTest_runProcessBlockTest() filters this many raw ADC values: noise with
+// a square wave at one player frequency in the middle.
+#define PROCESS_BLOCK_TEST_SAMPLE_COUNT 60000
+#define PROCESS_BLOCK_TEST_FILTER_NUMBER 3
+#define PROCESS_BLOCK_TEST_SEED 808
+// filter_processBlock() is called on chunks of 1 to this many values, so most
+// chunks split a decimation block.
+#define PROCESS_BLOCK_TEST_MAX_CHUNK 37
+
+// Returns raw ADC value n of the filterTest_runProcessBlockTest() input. Must be
+// called for n = 0, 1, 2, ... after srand(PROCESS_BLOCK_TEST_SEED).
+buffer_data_t filterTest_processBlockTestInput(uint32_t n) {
+  uint16_t tickCount =
+      filter_frequencyTickTable[PROCESS_BLOCK_TEST_FILTER_NUMBER];
+  int32_t value = ONE_HALF(FILTER_ADC_MAX_VALUE) + (rand() % 201) - 100;
+  if (n >= PROCESS_BLOCK_TEST_SAMPLE_COUNT / 3 &&
+      n < 2 * PROCESS_BLOCK_TEST_SAMPLE_COUNT / 3)
+    value += (n % tickCount < ONE_HALF(tickCount)) ? -1000 : 1000;
+  return value;
+}
+
+// Filters the same input one sample at a time (filter_addNewInput(),
+// filter_firFilter(), filter_iirFilterBank(), filter_computePower()) and in
+// uneven chunks with filter_processBlock(). The power values, the largest
+// power and the first output detector_detectHit() accepts must be identical.
+bool filterTest_runProcessBlockTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runProcessBlockTest() =====\n");
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+
+  // Per-sample API.
+  filter_init();
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    filter_computePower(i, true, false); // Clear power left by earlier tests.
+  srand(PROCESS_BLOCK_TEST_SEED);
+  double maxPower = 0.0;
+  uint32_t outputCount = 0;
+  int32_t crossingOutput = -1;
+  uint64_t startCycles = cycleCounter_read();
+  for (uint32_t n = 0; n < PROCESS_BLOCK_TEST_SAMPLE_COUNT; n++) {
+    filter_addNewInput(filter_scaleAdcValue(filterTest_processBlockTestInput(n)));
+    if ((n + 1) % FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    filter_firFilter();
+    filter_iirFilterBank();
+    double powerValues[FILTER_FREQUENCY_COUNT];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      powerValues[i] = filter_computePower(i, false, false);
+      if (powerValues[i] > maxPower)
+        maxPower = powerValues[i];
+    }
+    if (crossingOutput < 0 && detector_detectHit(powerValues))
+      crossingOutput = outputCount;
+    outputCount++;
+  }
+  uint64_t sampleCycles = cycleCounter_read() - startCycles;
+  double samplePowers[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(samplePowers);
+
+  // Block API.
+  filter_init();
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    filter_computePower(i, true, false);
+  srand(PROCESS_BLOCK_TEST_SEED);
+  double blockMaxPower = 0.0;
+  uint32_t blockOutputCount = 0;
+  int32_t blockCrossingOutput = -1;
+  uint16_t crossingFilterNumber = 0;
+  uint64_t blockCycles = 0;
+  for (uint32_t n = 0, chunk = 0; n < PROCESS_BLOCK_TEST_SAMPLE_COUNT; chunk++) {
+    buffer_data_t samples[PROCESS_BLOCK_TEST_MAX_CHUNK];
+    uint32_t count = 1 + (chunk * 7) % PROCESS_BLOCK_TEST_MAX_CHUNK;
+    if (count > PROCESS_BLOCK_TEST_SAMPLE_COUNT - n)
+      count = PROCESS_BLOCK_TEST_SAMPLE_COUNT - n;
+    for (uint32_t i = 0; i < count; i++)
+      samples[i] = filterTest_processBlockTestInput(n++);
+    filter_blockResult_t result;
+    startCycles = cycleCounter_read();
+    filter_processBlock(samples, count,
+                        blockCrossingOutput < 0 ? detector_detectHit : NULL,
+                        &result);
+    blockCycles += cycleCounter_read() - startCycles;
+    if (result.outputCount && result.maxPower > blockMaxPower)
+      blockMaxPower = result.maxPower;
+    if (result.thresholdCrossed) {
+      blockCrossingOutput = blockOutputCount + result.crossingOutputIndex;
+      crossingFilterNumber = result.crossingFilterNumber;
+    }
+    blockOutputCount += result.outputCount;
+  }
+  double blockPowers[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(blockPowers);
+
+  if (blockOutputCount != outputCount) {
+    printf("filter_processBlock() produced %d outputs instead of %d.\n",
+           blockOutputCount, outputCount);
+    success = false;
+  }
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    if (blockPowers[i] != samplePowers[i]) {
+      printf("Filter %d: filter_processBlock() power (%le) does not match "
+             "the per-sample power (%le).\n",
+             i, blockPowers[i], samplePowers[i]);
+      success = false;
+    }
+  }
+  if (blockMaxPower != maxPower) {
+    printf("filter_processBlock() largest power (%le) does not match the "
+           "per-sample largest power (%le).\n",
+           blockMaxPower, maxPower);
+    success = false;
+  }
+  if (crossingOutput < 0 || blockCrossingOutput != crossingOutput ||
+      crossingFilterNumber != PROCESS_BLOCK_TEST_FILTER_NUMBER) {
+    printf("filter_processBlock() crossed at output %d on filter %d, the "
+           "per-sample API at output %d.\n",
+           blockCrossingOutput, crossingFilterNumber, crossingOutput);
+    success = false;
+  }
+  if (printMessageFlag) {
+    printf("Per-sample API: %.1lf cycles per raw sample.\n",
+           (double)sampleCycles / PROCESS_BLOCK_TEST_SAMPLE_COUNT);
+    printf("filter_processBlock(): %.1lf cycles per raw sample.\n",
+           (double)blockCycles / PROCESS_BLOCK_TEST_SAMPLE_COUNT);
+  }
+  filter_init(); // Leave the filters in a clean state for the next test.
+  printf("+++++ Exiting filterTest_runProcessBlockTest() +++++\n");
+  return success;
+}
+
+// Number of IIR outputs per filter compared by the IIR bank and engine tests.
+#define IIR_TEST_OUTPUT_COUNT 3000
+// Every pass of filterTest_runRandomIirInputs() sees the same random inputs.
+#define IIR_TEST_SEED 390
+// Largest allowed difference between filter_iirFilterBank() and
+// filter_iirFilter(), relative to the largest output. Scaling the shared
+// numerator instead of each filter's own taps changes the last bit of the
+// feed-forward sum, and the 10th-order direct form amplifies that to a few
+// parts per million.
+#define IIR_BANK_TEST_EPSILON 1.0E-5
+
+// Outputs recorded by filterTest_runRandomIirInputs().
+static double iirTestOutputs[IIR_TEST_OUTPUT_COUNT][FILTER_FREQUENCY_COUNT];
+static double iirTestMaxOutput;
+
+// Calls filter_init(), then pushes IIR_TEST_OUTPUT_COUNT seeded random values
+// into yQueue and runs all IIR filters after each one, with
+// filter_iirFilterBank() if useBank is true or filter_iirFilter() otherwise.
+// If record is true the outputs are stored and 0.0 is returned, otherwise the
+// largest difference from the stored outputs is returned.
+double filterTest_runRandomIirInputs(bool useBank, bool record) {
+  double maxError = 0.0;
+  filter_init();
+  srand(IIR_TEST_SEED);
+  if (record)
+    iirTestMaxOutput = 0.0;
+  for (uint32_t n = 0; n < IIR_TEST_OUTPUT_COUNT; n++) {
+    queue_overwritePush(filter_getYQueue(), filterTest_randomValue0To1());
+    if (useBank)
+      filter_iirFilterBank();
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      double output =
+          useBank ? filterTest_readMostRecentValueFromQueue(
+                        filter_getIirOutputQueue(i))
+                  : filter_iirFilter(i);
+      if (record) {
+        iirTestOutputs[n][i] = output;
+        if (fabs(output) > iirTestMaxOutput)
+          iirTestMaxOutput = fabs(output);
+      } else if (fabs(output - iirTestOutputs[n][i]) > maxError) {
+        maxError = fabs(output - iirTestOutputs[n][i]);
+      }
+    }
+  }
+  return maxError;
+}
+
+// Runs the same random yQueue inputs through filter_iirFilterBank() and through
+// filter_iirFilter() for each filter. The outputs must agree within epsilon.
+bool filterTest_runIirBankTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runIirBankTest() =====\n");
+  bool success = true; // Be optimistic.
+  filterTest_runRandomIirInputs(true, true);
+  double maxError = filterTest_runRandomIirInputs(false, false);
+  if (maxError > IIR_BANK_TEST_EPSILON * iirTestMaxOutput) {
+    printf("filter_iirFilterBank() differs from filter_iirFilter() by %le "
+           "(largest output %le).\n",
+           maxError, iirTestMaxOutput);
+    success = false;
+  } else if (printMessageFlag) {
+    printf("filter_iirFilterBank() matches filter_iirFilter(), largest "
+           "difference %le.\n",
+           maxError);
+  }
+  filter_init(); // Leave the filters in a clean state for the next test.
+  printf("+++++ Exiting filterTest_runIirBankTest() +++++\n");
+  return success;
+}
+
+// The interleaved engine does the same arithmetic as the direct form, only
+// with a different memory layout, so its outputs must match exactly, both for
+// filter_iirFilterBank() and for filter_iirFilter().
+bool filterTest_runInterleavedEngineTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runInterleavedEngineTest() =====\n");
+  bool success = true; // Be optimistic.
+  for (uint16_t useBank = 0; useBank <= 1; useBank++) {
+    filter_setEngine(filter_directFormEngine_e);
+    filterTest_runRandomIirInputs(useBank, true);
+    filter_setEngine(filter_interleavedEngine_e);
+    double maxError = filterTest_runRandomIirInputs(useBank, false);
+    if (maxError != 0.0) {
+      printf("Interleaved engine differs from the direct form by %le using "
+             "%s.\n",
+             maxError,
+             useBank ? "filter_iirFilterBank()" : "filter_iirFilter()");
+      success = false;
+    }
+  }
+  filter_setEngine(filter_directFormEngine_e); // Back to the default engine.
+  filter_init();
+  if (printMessageFlag && success)
+    printf("Interleaved engine matches the direct form bit for bit.\n");
+  printf("+++++ Exiting filterTest_runInterleavedEngineTest() +++++\n");
+  return success;
+}
+
+// Decimated samples run through the IIR bank by filterTest_runIirBenchmark().
+#define IIR_BENCHMARK_SAMPLE_COUNT 20000
+// Prints how many decimated samples per second filter_iirFilterBank() and
+// filter_computePower() sustain with the direct-form and interleaved engines.
+void filterTest_runIirBenchmark(void) {
+  printf("===== Starting filterTest_runIirBenchmark() =====\n");
+  const filter_engine_t engines[] = {filter_directFormEngine_e,
+                                     filter_interleavedEngine_e};
+  const char *engineNames[] = {"direct form", "interleaved"};
+  for (uint16_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+    filter_setEngine(engines[e]);
+    filter_init();
+    uint64_t startCycles = cycleCounter_read();
+    for (uint32_t n = 0; n < IIR_BENCHMARK_SAMPLE_COUNT; n++) {
+      queue_overwritePush(filter_getYQueue(), (n & 1) ? 1.0 : -1.0);
+      filter_iirFilterBank();
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        filter_computePower(i, false, false);
+      }
+    }
+    uint64_t elapsedCycles = cycleCounter_read() - startCycles;
+    printf("%s engine: %.0f decimated samples per second.\n", engineNames[e],
+           (double)IIR_BENCHMARK_SAMPLE_COUNT *
+               cycleCounter_getCountsPerSecond() / elapsedCycles);
+  }
+  filter_setEngine(filter_directFormEngine_e); // Back to the default engine.
+  filter_init();
+  printf("+++++ Exiting filterTest_runIirBenchmark() +++++\n");
+}
+
+// filterTest_runDenormalBenchmark() follows an impulse through the direct-form
+// filters for this many decimated samples, timed in this many windows. The
+// squared outputs in the power sums become subnormal after about 75000
+// samples, and the slowest filter's state after about 145000.
+#define DENORMAL_BENCHMARK_SAMPLE_COUNT 160000
+#define DENORMAL_BENCHMARK_WINDOW_COUNT 8
+#define DENORMAL_BENCHMARK_WINDOW_LENGTH                                       \
+  (DENORMAL_BENCHMARK_SAMPLE_COUNT / DENORMAL_BENCHMARK_WINDOW_COUNT)
+
+// Prints the cost per decimated sample of filter_iirFilterBank() and
+// filter_computePower() while an impulse decays through the direct-form
+// filters, a window at a time, without and with the denormal guard (see
+// filter_setDenormalGuard()).
+void filterTest_runDenormalBenchmark(void) {
+  printf("===== Starting filterTest_runDenormalBenchmark() =====\n");
+  for (uint16_t guard = 0; guard < 2; guard++) {
+    filter_setDenormalGuard(guard);
+    filter_init();
+    queue_overwritePush(filter_getYQueue(), 1.0);
+    printf("Denormal guard %s, cycles per sample in windows of %d:",
+           guard ? "on" : "off", DENORMAL_BENCHMARK_WINDOW_LENGTH);
+    for (uint16_t w = 0; w < DENORMAL_BENCHMARK_WINDOW_COUNT; w++) {
+      uint64_t startCycles = cycleCounter_read();
+      for (uint32_t n = 0; n < DENORMAL_BENCHMARK_WINDOW_LENGTH; n++) {
+        filter_iirFilterBank();
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+          filter_computePower(i, false, false);
+        }
+        queue_overwritePush(filter_getYQueue(), 0.0);
+      }
+      printf(" %.0lf", (double)(cycleCounter_read() - startCycles) /
+                           DENORMAL_BENCHMARK_WINDOW_LENGTH);
+    }
+    printf("\n");
+  }
+  filter_setDenormalGuard(true); // Back to the default.
+  filter_init();
+  printf("+++++ Exiting filterTest_runDenormalBenchmark() +++++\n");
+}
+
+// Channel counts timed by filterTest_runChannelCountBenchmark(), and the band
+// their frequencies are spread over.
+static const uint16_t channelBenchmarkCounts[] = {10, 16, 32};
+#define CHANNEL_BENCHMARK_LOW_FREQUENCY_HZ 1000.0
+#define CHANNEL_BENCHMARK_HIGH_FREQUENCY_HZ 4500.0
+#define CHANNEL_BENCHMARK_BANDWIDTH_HZ 50.0
+#define CHANNEL_BENCHMARK_SAMPLE_COUNT 20000 // Decimated samples per run.
+// Blocks for the Goertzel recurrence and the channelizer, as in filter.c.
+#define CHANNEL_BENCHMARK_BLOCK_LENGTH 200
+#define CHANNEL_BENCHMARK_BLOCK_COUNT                                          \
+  (FILTER_INPUT_PULSE_WIDTH / CHANNEL_BENCHMARK_BLOCK_LENGTH)
+
+// Runs one decimated sample through a direct-form bank of the designed IIR
+// filters and updates each filter's boxcar power, the work filter.c does per
+// sample. x[] and y[][] are circular histories indexed by newest.
+static double channelBenchmarkX[FILTER_DESIGN_IIR_ORDER + 1];
+static double channelBenchmarkY[FILTER_DESIGN_MAX_CHANNEL_COUNT]
+                               [FILTER_DESIGN_IIR_ORDER + 1];
+static double channelBenchmarkPower[FILTER_DESIGN_MAX_CHANNEL_COUNT];
+static void filterTest_runDesignedIirBank(const filterDesign_tables_t *tables,
+                                          uint16_t channelCount, double x,
+                                          uint16_t newest) {
+  channelBenchmarkX[newest] = x;
+  for (uint16_t i = 0; i < channelCount; i++) {
+    double y = 0.0;
+    for (uint16_t k = 0; k <= FILTER_DESIGN_IIR_ORDER; k++) {
+      y += tables->iirB[i][k] *
+           channelBenchmarkX[(newest + FILTER_DESIGN_IIR_ORDER + 1 - k) %
+                             (FILTER_DESIGN_IIR_ORDER + 1)];
+    }
+    for (uint16_t k = 1; k <= FILTER_DESIGN_IIR_ORDER; k++) {
+      y -= tables->iirA[i][k - 1] *
+           channelBenchmarkY[i][(newest + FILTER_DESIGN_IIR_ORDER + 1 - k) %
+                                (FILTER_DESIGN_IIR_ORDER + 1)];
+    }
+    channelBenchmarkY[i][newest] = y;
+    channelBenchmarkPower[i] += y * y; // Stands in for the boxcar update.
+  }
+}
+
+// Prints the cost per decimated sample, in cycleCounter counts, of measuring
+// 10, 16 and 32 channel powers with a designed IIR bank, the Goertzel
+// recurrence and the FFT channelizer. The IIR bank and Goertzel grow linearly
+// with the channel count; the channelizer runs one FFT per block, which only
+// grows when the channels get close enough to need a longer FFT.
+void filterTest_runChannelCountBenchmark(void) {
+  printf("===== Starting filterTest_runChannelCountBenchmark() =====\n");
+  double decimatedFrequencyHz =
+      FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000.0 / FILTER_FIR_DECIMATION_FACTOR;
+  for (uint16_t c = 0;
+       c < sizeof(channelBenchmarkCounts) / sizeof(channelBenchmarkCounts[0]);
+       c++) {
+    uint16_t channelCount = channelBenchmarkCounts[c];
+    filterDesign_plan_t plan;
+    plan.sampleFrequencyHz = FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000.0;
+    plan.decimationFactor = FILTER_FIR_DECIMATION_FACTOR;
+    plan.channelCount = channelCount;
+    plan.bandwidthHz = CHANNEL_BENCHMARK_BANDWIDTH_HZ;
+    double frequencies[FILTER_DESIGN_MAX_CHANNEL_COUNT]; // Radians/sample.
+    for (uint16_t i = 0; i < channelCount; i++) {
+      plan.channelFrequencyHz[i] =
+          CHANNEL_BENCHMARK_LOW_FREQUENCY_HZ +
+          (CHANNEL_BENCHMARK_HIGH_FREQUENCY_HZ -
+           CHANNEL_BENCHMARK_LOW_FREQUENCY_HZ) *
+              i / (channelCount - 1);
+      frequencies[i] = 2.0 * M_PI * plan.channelFrequencyHz[i] /
+                       decimatedFrequencyHz;
+    }
+    static filterDesign_tables_t tables;
+    if (!filterDesign_design(&plan, &tables) ||
+        !dft_initGoertzel(frequencies, channelCount,
+                          CHANNEL_BENCHMARK_BLOCK_LENGTH,
+                          CHANNEL_BENCHMARK_BLOCK_COUNT) ||
+        !dft_initChannelizer(frequencies, channelCount,
+                             CHANNEL_BENCHMARK_BLOCK_LENGTH,
+                             CHANNEL_BENCHMARK_BLOCK_COUNT)) {
+      printf("%d channels: can't set up the benchmark.\n", channelCount);
+      continue;
+    }
+    uint64_t startCycles = cycleCounter_read();
+    for (uint32_t n = 0; n < CHANNEL_BENCHMARK_SAMPLE_COUNT; n++) {
+      filterTest_runDesignedIirBank(&tables, channelCount, (n & 1) ? 1.0 : -1.0,
+                                    n % (FILTER_DESIGN_IIR_ORDER + 1));
+    }
+    uint64_t iirCycles = cycleCounter_read() - startCycles;
+    startCycles = cycleCounter_read();
+    for (uint32_t n = 0; n < CHANNEL_BENCHMARK_SAMPLE_COUNT; n++) {
+      dft_goertzelAddSample((n & 1) ? 1.0 : -1.0);
+    }
+    uint64_t goertzelCycles = cycleCounter_read() - startCycles;
+    startCycles = cycleCounter_read();
+    for (uint32_t n = 0; n < CHANNEL_BENCHMARK_SAMPLE_COUNT; n++) {
+      dft_channelizerAddSample((n & 1) ? 1.0 : -1.0);
+    }
+    uint64_t channelizerCycles = cycleCounter_read() - startCycles;
+    printf("%2d channels, counts per decimated sample: IIR bank %.1f, Goertzel "
+           "%.1f, channelizer %.1f (%d-point FFT).\n",
+           channelCount, (double)iirCycles / CHANNEL_BENCHMARK_SAMPLE_COUNT,
+           (double)goertzelCycles / CHANNEL_BENCHMARK_SAMPLE_COUNT,
+           (double)channelizerCycles / CHANNEL_BENCHMARK_SAMPLE_COUNT,
+           dft_getChannelizerFftLength());
+  }
+  filter_init(); // Set dft.c up again for the current engine.
+  printf("+++++ Exiting filterTest_runChannelCountBenchmark() +++++\n");
+}
+
+// Runs a square wave at a user frequency through the FIR and all IIR filters
+// with the current engine and leaves the power of each filter in powerValues[].
+void filterTest_computeSquareWaveIirPowers(uint16_t currentPeriodTickCount,
+                                           double powerValues[]) {
+  filter_init();
+  uint16_t decimationCount = 0;
+  uint32_t totalTickCount = 0;
+  while (totalTickCount < FILTER_TEST_PULSE_WIDTH_LENGTH) {
+    for (uint16_t freqTick = 0; freqTick < currentPeriodTickCount; freqTick++) {
+      filter_addNewInput(computeFilterInput(freqTick, currentPeriodTickCount));
+      if (++decimationCount == FILTER_FIR_DECIMATION_FACTOR) {
+        decimationCount = 0;
+        filter_firFilter();
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+          filter_iirFilter(i);
+        }
+      }
+      totalTickCount++;
+    }
+  }
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    powerValues[i] = filter_computePower(i, true, false);
+  }
+}
+
+// Synthetic bursts for filterTest_runDftEngineTest(), in raw ADC samples: noise,
+// then a square wave plus noise for one pulse width, then noise again.
+#define BURST_LEAD_IN_LENGTH 10000
+#define BURST_LENGTH FILTER_TEST_PULSE_WIDTH_LENGTH
+#define BURST_TAIL_LENGTH 60000 // Long enough for the lockout to run out.
+#define BURST_ADC_CENTER ((FILTER_ADC_MAX_VALUE + 1) / 2)
+#define BURST_ADC_AMPLITUDE 1000 // Square wave swings this far from center.
+#define BURST_ADC_NOISE 50       // Uniform noise of up to this much either way.
+#define BURST_SEED 1234 // Each burst uses the same noise for every engine.
+#define BURST_NO_HIT -1
+// Outputs after a hit during which no hit is counted, like the lockout timer
+// (0.5 s of decimated samples).
+#define BURST_LOCKOUT_OUTPUT_COUNT 5000
+// One burst per test frequency (player and out-of-band) plus a noise-only burst.
+#define BURST_COUNT (FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT + 1)
+
+// Returns raw ADC value tick of a burst that starts after leadInLength values:
+// noise, plus a square wave with the given period during the burst. Must be
+// called for tick = 0, 1, 2, ... with *freqTick starting at 0.
+int32_t filterTest_burstAdcValue(uint32_t tick, uint32_t leadInLength,
+                                 uint16_t currentPeriodTickCount,
+                                 uint16_t *freqTick) {
+  int32_t adcValue = BURST_ADC_CENTER +
+                     (rand() % (2 * BURST_ADC_NOISE + 1)) - BURST_ADC_NOISE;
+  if (currentPeriodTickCount && tick >= leadInLength &&
+      tick < leadInLength + BURST_LENGTH) {
+    adcValue += (*freqTick < ONE_HALF(currentPeriodTickCount))
+                    ? -BURST_ADC_AMPLITUDE
+                    : BURST_ADC_AMPLITUDE;
+    *freqTick = (*freqTick + 1 == currentPeriodTickCount) ? 0 : *freqTick + 1;
+  }
+  return adcValue;
+}
+
+// Runs one burst through the filters with the current engine. Returns
+// BURST_NO_HIT if detector_detectHit() never fires, otherwise the filter with
+// the most power once the power window lies entirely inside the burst.
+// *hitCount is set to the number of hits, with a lockout after each one.
+// A tick count of 0 gives a noise-only burst.
+int16_t filterTest_runBurst(uint16_t currentPeriodTickCount, uint16_t burstNumber,
+                            uint16_t *hitCount) {
+  filter_init();
+  srand(BURST_SEED + burstNumber);
+  buffer_data_t rawAdcBlock[FILTER_FIR_DECIMATION_FACTOR];
+  uint16_t blockIndex = 0;
+  uint16_t freqTick = 0;
+  uint16_t maxIndex = 0;
+  uint32_t lockoutCount = 0;
+  *hitCount = 0;
+  for (uint32_t tick = 0;
+       tick < BURST_LEAD_IN_LENGTH + BURST_LENGTH + BURST_TAIL_LENGTH; tick++) {
+    rawAdcBlock[blockIndex++] = filterTest_burstAdcValue(
+        tick, BURST_LEAD_IN_LENGTH, currentPeriodTickCount, &freqTick);
+    if (blockIndex < FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    blockIndex = 0;
+    filter_firFilterBlock(rawAdcBlock);
+    filter_iirFilterBank();
+    double powerValues[FILTER_FREQUENCY_COUNT];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      // Power left over from earlier tests is cleared by the first call.
+      powerValues[i] = filter_computePower(i, tick < FILTER_FIR_DECIMATION_FACTOR,
+                                           false);
+    }
+    if (lockoutCount > 0) {
+      lockoutCount--;
+    } else if (detector_detectHit(powerValues)) {
+      (*hitCount)++;
+      lockoutCount = BURST_LOCKOUT_OUTPUT_COUNT;
+    }
+    if (tick + 1 == BURST_LEAD_IN_LENGTH + BURST_LENGTH) {
+      filter_getNormalizedPowerValues(powerValues, &maxIndex);
+    }
+  }
+  return *hitCount ? maxIndex : BURST_NO_HIT;
+}
+
+// Runs the same synthetic bursts through the direct-form IIR engine and the
+// Goertzel, sliding-DFT and channelizer engines. For each player frequency
+// every engine must hit once, on the matching filter, and every other burst
+// must make the same decision as the direct form. An out-of-band square wave
+// can alias close to a player frequency after decimation (tick count 16 lands
+// 96 Hz from player 8), so this also checks that the DFT engines are no wider
+// than the IIR filters. Last, a channelizer setup with a bin at the Nyquist
+// frequency must fail and leave the running channelizer alone.
+bool filterTest_runDftEngineTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runDftEngineTest() =====\n");
+  const filter_engine_t engines[] = {
+      filter_directFormEngine_e, filter_goertzelEngine_e,
+      filter_slidingDftEngine_e, filter_channelizerEngine_e};
+  const char *engineNames[] = {"direct form", "Goertzel", "sliding DFT",
+                               "channelizer"};
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+  for (uint16_t burst = 0; burst < BURST_COUNT; burst++) {
+    uint16_t tickCount = (burst < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT)
+                             ? filterTest_firTestTickCounts[burst]
+                             : 0;
+    int16_t decisions[sizeof(engines) / sizeof(engines[0])];
+    for (uint16_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+      filter_setEngine(engines[e]);
+      uint16_t hitCount;
+      decisions[e] = filterTest_runBurst(tickCount, burst, &hitCount);
+      if (hitCount > 1) {
+        printf("Tick count %d: %s engine hit %d times.\n", tickCount,
+               engineNames[e], hitCount);
+        success = false;
+      }
+      bool inBand = burst < FILTER_FREQUENCY_COUNT;
+      int16_t expected = inBand ? (int16_t)burst : BURST_NO_HIT;
+      if ((inBand || tickCount == 0) && decisions[e] != expected) {
+        printf("Tick count %d: %s engine decided %d instead of %d.\n",
+               tickCount, engineNames[e], decisions[e], expected);
+        success = false;
+      } else if (decisions[e] != decisions[0]) {
+        printf("Tick count %d (out of band): %s engine decided %d, direct "
+               "form decided %d.\n",
+               tickCount, engineNames[e], decisions[e], decisions[0]);
+        success = false;
+      }
+    }
+    if (printMessageFlag)
+      printf("Tick count %2d: decision %d\n", tickCount, decisions[0]);
+  }
+  filter_setEngine(filter_channelizerEngine_e);
+  filter_init();
+  uint16_t fftLength = dft_getChannelizerFftLength();
+  const double nyquistFrequency[] = {M_PI};
+  if (dft_initChannelizer(nyquistFrequency, 1, 1, 1) ||
+      dft_getChannelizerFftLength() != fftLength) {
+    printf("A rejected channelizer setup changed the FFT length from %d to "
+           "%d.\n",
+           fftLength, dft_getChannelizerFftLength());
+    success = false;
+  }
+  filter_setEngine(filter_directFormEngine_e); // Back to the default engine.
+  filter_init();
+  if (success)
+    printf("Goertzel, sliding-DFT and channelizer engines detect every player "
+           "frequency.\n");
+  printf("+++++ Exiting filterTest_runDftEngineTest() +++++\n");
+  return success;
+}
+
+// Runs the synthetic bursts of filterTest_runDftEngineTest() with the exact
+// boxcar power and with the block-sum and exponential estimators. Every
+// estimator must make the same hit decision as the boxcar for every burst, and
+// hit no more than once.
+bool filterTest_runPowerEstimatorTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runPowerEstimatorTest() =====\n");
+  const filter_powerEstimator_t estimators[] = {filter_boxcarPower_e,
+                                                filter_blockSumPower_e,
+                                                filter_exponentialPower_e};
+  const char *estimatorNames[] = {"boxcar", "block-sum", "exponential"};
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+  for (uint16_t burst = 0; burst < BURST_COUNT; burst++) {
+    uint16_t tickCount = (burst < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT)
+                             ? filterTest_firTestTickCounts[burst]
+                             : 0;
+    int16_t decisions[sizeof(estimators) / sizeof(estimators[0])];
+    for (uint16_t e = 0; e < sizeof(estimators) / sizeof(estimators[0]); e++) {
+      filter_setPowerEstimator(estimators[e]);
+      uint16_t hitCount;
+      decisions[e] = filterTest_runBurst(tickCount, burst, &hitCount);
+      if (hitCount > 1) {
+        printf("Tick count %d: %s power hit %d times.\n", tickCount,
+               estimatorNames[e], hitCount);
+        success = false;
+      }
+      if (decisions[e] != decisions[0]) {
+        printf("Tick count %d: %s power decided %d, boxcar power decided "
+               "%d.\n",
+               tickCount, estimatorNames[e], decisions[e], decisions[0]);
+        success = false;
+      }
+    }
+    if (printMessageFlag)
+      printf("Tick count %2d: decision %d\n", tickCount, decisions[0]);
+  }
+  filter_setPowerEstimator(filter_boxcarPower_e); // Back to the default.
+  filter_init();
+  if (success)
+    printf("Block-sum and exponential power match the boxcar hit "
+           "decisions.\n");
+  printf("+++++ Exiting filterTest_runPowerEstimatorTest() +++++\n");
+  return success;
+}
+
+// The energy gate test leads each burst in with enough noise for the gate to
+// learn the floor and close, and feeds filter_processBlock() in batches like
+// detector().
+#define ENERGY_GATE_TEST_LEAD_IN_LENGTH 60000
+#define ENERGY_GATE_TEST_SAMPLE_COUNT                                          \
+  (ENERGY_GATE_TEST_LEAD_IN_LENGTH + BURST_LENGTH + BURST_TAIL_LENGTH)
+#define ENERGY_GATE_TEST_BATCH_SIZE 200
+// Hits are not tested while the filters settle after filter_init().
+#define ENERGY_GATE_TEST_SETTLE_LENGTH 20000
+// The gate must idle for at least this fraction of the noise-only burst.
+#define ENERGY_GATE_TEST_MIN_IDLE_FRACTION 0.5
+
+// Runs one burst through filter_processBlock() with detector_detectHit() as the
+// hit test once the filters have settled, and a lockout after each hit. Returns BURST_NO_HIT or the filter
+// that crossed first. Sets *hitCount, *idleFraction and the run time in
+// cycleCounter counts.
+int16_t filterTest_runGatedBurst(uint16_t currentPeriodTickCount,
+                                 uint16_t burstNumber, uint16_t *hitCount,
+                                 double *idleFraction, uint64_t *cycles) {
+  filter_init();
+  srand(BURST_SEED + burstNumber);
+  buffer_data_t batch[ENERGY_GATE_TEST_BATCH_SIZE];
+  uint16_t freqTick = 0;
+  int16_t decision = BURST_NO_HIT;
+  uint32_t lockoutCount = 0;
+  *hitCount = 0;
+  *cycles = 0;
+  for (uint32_t tick = 0; tick < ENERGY_GATE_TEST_SAMPLE_COUNT;
+       tick += ENERGY_GATE_TEST_BATCH_SIZE) {
+    for (uint32_t i = 0; i < ENERGY_GATE_TEST_BATCH_SIZE; i++) {
+      batch[i] = filterTest_burstAdcValue(tick + i,
+                                          ENERGY_GATE_TEST_LEAD_IN_LENGTH,
+                                          currentPeriodTickCount, &freqTick);
+    }
+    filter_blockResult_t result;
+    uint64_t startCycles = cycleCounter_read();
+    bool testHits = tick >= ENERGY_GATE_TEST_SETTLE_LENGTH && !lockoutCount;
+    filter_processBlock(batch, ENERGY_GATE_TEST_BATCH_SIZE,
+                        testHits ? detector_detectHit : NULL, &result);
+    *cycles += cycleCounter_read() - startCycles;
+    lockoutCount = (lockoutCount > result.outputCount)
+                       ? lockoutCount - result.outputCount
+                       : 0;
+    if (result.thresholdCrossed) {
+      if ((*hitCount)++ == 0)
+        decision = result.crossingFilterNumber;
+      lockoutCount = BURST_LOCKOUT_OUTPUT_COUNT;
+    }
+  }
+  *idleFraction = filter_getIdleFraction();
+  return decision;
+}
+
+// Runs the synthetic bursts through filter_processBlock() with the energy gate
+// off and on. The gate must not change any hit decision or hit count, and must
+// idle the IIR filters for most of the noise-only burst. Reports the idle
+// fraction and run time of each burst.
+bool filterTest_runEnergyGateTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runEnergyGateTest() =====\n");
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+  uint64_t totalCycles[2] = {0, 0};
+  for (uint16_t burst = 0; burst < BURST_COUNT; burst++) {
+    uint16_t tickCount = (burst < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT)
+                             ? filterTest_firTestTickCounts[burst]
+                             : 0;
+    int16_t decisions[2];
+    uint16_t hitCounts[2];
+    double idleFraction;
+    uint64_t cycles[2];
+    for (uint16_t gate = 0; gate < 2; gate++) {
+      filter_setEnergyGate(gate);
+      decisions[gate] = filterTest_runGatedBurst(tickCount, burst,
+                                                 &hitCounts[gate],
+                                                 &idleFraction, &cycles[gate]);
+      totalCycles[gate] += cycles[gate];
+    }
+    if (decisions[1] != decisions[0] || hitCounts[1] != hitCounts[0]) {
+      printf("Tick count %d: gated decision %d (%d hits), ungated decision "
+             "%d (%d hits).\n",
+             tickCount, decisions[1], hitCounts[1], decisions[0],
+             hitCounts[0]);
+      success = false;
+    }
+    if (tickCount == 0 && idleFraction < ENERGY_GATE_TEST_MIN_IDLE_FRACTION) {
+      printf("Noise only: the gate idled for %.1lf%% of the outputs, at "
+             "least %.1lf%% expected.\n",
+             idleFraction * 100, ENERGY_GATE_TEST_MIN_IDLE_FRACTION * 100);
+      success = false;
+    }
+    if (printMessageFlag)
+      printf("Tick count %2d: decision %d, idle %.1lf%%, %.2lf ms gated vs. "
+             "%.2lf ms ungated.\n",
+             tickCount, decisions[1], idleFraction * 100,
+             1000.0 * cycles[1] / cycleCounter_getCountsPerSecond(),
+             1000.0 * cycles[0] / cycleCounter_getCountsPerSecond());
+  }
+  printf("Energy gate saves %.1lf%% of the filter_processBlock() time.\n",
+         totalCycles[0] ? 100.0 * (1.0 - (double)totalCycles[1] / totalCycles[0])
+                        : 0.0);
+  filter_setEnergyGate(false); // Back to the default.
+  filter_init();
+  if (success)
+    printf("The energy gate does not change any hit decision.\n");
+  printf("+++++ Exiting filterTest_runEnergyGateTest() +++++\n");
+  return success;
+}
+
+// filterTest_runStateTest() saves the state after this many raw samples of
+// filterTest_processBlockTestInput(), then runs this many more twice.
+#define STATE_TEST_SPLIT_LENGTH 25000
+#define STATE_TEST_CONTINUATION_LENGTH 20000
+#define STATE_TEST_CONTINUATION_SEED 909
+// Noise-only raw samples behind the ambient snapshot, and after it.
+#define STATE_TEST_AMBIENT_LENGTH 30000
+#define STATE_TEST_NOISE_SEED 1717
+
+// Runs count values of filterTest_processBlockTestInput(), starting with value
+// n, through filter_processBlock() in batches like detector(). Returns true if
+// hitTest passed for any output.
+bool filterTest_runStateTestInput(uint32_t n, uint32_t count,
+                                  filter_hitTest_t hitTest) {
+  bool crossed = false;
+  buffer_data_t batch[ENERGY_GATE_TEST_BATCH_SIZE];
+  for (uint32_t done = 0; done < count; done += ENERGY_GATE_TEST_BATCH_SIZE) {
+    for (uint32_t i = 0; i < ENERGY_GATE_TEST_BATCH_SIZE; i++) {
+      batch[i] = filterTest_processBlockTestInput(n + done + i);
+    }
+    filter_blockResult_t result;
+    filter_processBlock(batch, ENERGY_GATE_TEST_BATCH_SIZE, hitTest, &result);
+    crossed |= result.thresholdCrossed;
+  }
+  return crossed;
+}
+
+// Runs count noise-only burst samples through filter_processBlock(). Returns
+// true if detector_detectHit() passed for any output.
+bool filterTest_runStateTestNoise(uint32_t count) {
+  bool crossed = false;
+  buffer_data_t batch[ENERGY_GATE_TEST_BATCH_SIZE];
+  uint16_t freqTick = 0;
+  for (uint32_t done = 0; done < count; done += ENERGY_GATE_TEST_BATCH_SIZE) {
+    for (uint32_t i = 0; i < ENERGY_GATE_TEST_BATCH_SIZE; i++) {
+      batch[i] = filterTest_burstAdcValue(done + i, 0, 0, &freqTick);
+    }
+    filter_blockResult_t result;
+    filter_processBlock(batch, ENERGY_GATE_TEST_BATCH_SIZE, detector_detectHit,
+                        &result);
+    crossed |= result.thresholdCrossed;
+  }
+  return crossed;
+}
+
+// Checks filter_saveState(), filter_restoreState() and filter_setWarmStart():
+// 1. filter_init() reuses the queue storage instead of allocating it again.
+// 2. After a restore, the filters produce exactly the power values they did
+// after the save, with the energy gate off and on, and filter_saveState()
+// writes no more than filter_getStateSize() bytes.
+// 3. A snapshot taken with another power estimator is rejected.
+// 4. A warm start from an ambient snapshot starts with the snapshot's power
+// values and does not hit on noise, where a cold start may.
+bool filterTest_runStateTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runStateTest() =====\n");
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+
+  filter_init();
+  const queue_data_t *xData = filter_getXQueue()->data;
+  const queue_data_t *outputData = filter_getIirOutputQueue(0)->data;
+  filter_init();
+  if (filter_getXQueue()->data != xData ||
+      filter_getIirOutputQueue(0)->data != outputData) {
+    printf("filter_init() allocated new queues.\n");
+    success = false;
+  }
+
+  // One more byte, which filter_saveState() must not write.
+  uint32_t stateSize = filter_getStateSize();
+  filter_state_t *savedState = malloc(stateSize + 1);
+  uint8_t *pastState = (uint8_t *)savedState + stateSize;
+  for (uint16_t gate = 0; gate < 2; gate++) {
+    filter_setEnergyGate(gate);
+    filter_init();
+    srand(PROCESS_BLOCK_TEST_SEED);
+    filterTest_runStateTestInput(0, STATE_TEST_SPLIT_LENGTH, NULL);
+    *pastState = 0xA5;
+    if (!filter_saveState(savedState)) {
+      printf("filter_saveState() failed.\n");
+      success = false;
+    }
+    double powers[2][FILTER_FREQUENCY_COUNT];
+    for (uint16_t run = 0; run < 2; run++) {
+      if (run == 1 && !filter_restoreState(savedState)) {
+        printf("filter_restoreState() rejected its own snapshot.\n");
+        success = false;
+      }
+      srand(STATE_TEST_CONTINUATION_SEED);
+      filterTest_runStateTestInput(STATE_TEST_SPLIT_LENGTH,
+                                   STATE_TEST_CONTINUATION_LENGTH, NULL);
+      filter_getCurrentPowerValues(powers[run]);
+    }
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (powers[1][i] != powers[0][i]) {
+        printf("Gate %s, filter %d: power after the restore (%le) does not "
+               "match the power after the save (%le).\n",
+               gate ? "on" : "off", i, powers[1][i], powers[0][i]);
+        success = false;
+      }
+    }
+    if (*pastState != 0xA5) {
+      printf("filter_saveState() wrote past filter_getStateSize().\n");
+      success = false;
+    }
+  }
+  filter_setEnergyGate(false); // Back to the default.
+
+  filter_setPowerEstimator(filter_blockSumPower_e);
+  filter_init();
+  uint32_t blockSumStateSize = filter_getStateSize();
+  if (filter_restoreState(savedState)) {
+    printf("filter_restoreState() took a boxcar snapshot for the block-sum "
+           "estimator.\n");
+    success = false;
+  }
+  filter_setPowerEstimator(filter_boxcarPower_e); // Back to the default.
+  if (printMessageFlag)
+    printf("A snapshot takes %u bytes with the boxcar estimator, %u with the "
+           "block-sum estimator.\n",
+           stateSize, blockSumStateSize);
+
+  // Ambient snapshot, then a cold and a warm start on fresh noise.
+  filter_init();
+  srand(STATE_TEST_NOISE_SEED);
+  filterTest_runStateTestNoise(STATE_TEST_AMBIENT_LENGTH);
+  filter_saveState(savedState);
+  double ambientPowers[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(ambientPowers);
+  bool crossed[2];
+  for (uint16_t warm = 0; warm < 2; warm++) {
+    filter_setWarmStart(warm ? savedState : NULL);
+    filter_init();
+    if (warm) {
+      double powers[FILTER_FREQUENCY_COUNT];
+      filter_getCurrentPowerValues(powers);
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (powers[i] != ambientPowers[i]) {
+          printf("Filter %d: warm-start power (%le) does not match the "
+                 "snapshot (%le).\n",
+                 i, powers[i], ambientPowers[i]);
+          success = false;
+        }
+      }
+    }
+    srand(STATE_TEST_NOISE_SEED + 1);
+    crossed[warm] = filterTest_runStateTestNoise(STATE_TEST_AMBIENT_LENGTH);
+  }
+  filter_setWarmStart(NULL); // Back to the default.
+  free(savedState);
+  if (crossed[1]) {
+    printf("A warm start hit on noise.\n");
+    success = false;
+  }
+  if (printMessageFlag)
+    printf("On noise, a cold start %s and a warm start does not hit.\n",
+           crossed[0] ? "hits" : "does not hit");
+  filter_init(); // Leave the filters in a clean state for the next test.
+  if (success)
+    printf("Filter state snapshots restore exactly.\n");
+  printf("+++++ Exiting filterTest_runStateTest() +++++\n");
+  return success;
+}
+
+// filterTest_runDiversityTest() feeds four synthetic sensors after the same
+// noise-only lead-in as the energy gate test. Sensor 0 is much noisier than the
+// others, and the shot reaches only sensors 1 and 2, mostly 2.
+#define DIVERSITY_TEST_SENSOR_COUNT 4
+#define DIVERSITY_TEST_SAMPLE_COUNT                                            \
+  (ENERGY_GATE_TEST_LEAD_IN_LENGTH + BURST_LENGTH)
+#define DIVERSITY_TEST_FILTER_NUMBER 3 // Frequency of the shot.
+#define DIVERSITY_TEST_SEED 2468
+static const int32_t diversityTestNoise[DIVERSITY_TEST_SENSOR_COUNT] = {
+    400, 60, 60, 60};
+static const int32_t diversityTestAmplitude[DIVERSITY_TEST_SENSOR_COUNT] = {
+    0, 20, 60, 0};
+// Receivers compared by the test, and whether each must hit.
+#define DIVERSITY_TEST_RECEIVER_COUNT 4
+static const char *diversityTestReceiverNames[DIVERSITY_TEST_RECEIVER_COUNT] = {
+    "sensor 0 alone", "equal-gain average", "selection", "maximal ratio"};
+static const bool diversityTestMustHit[DIVERSITY_TEST_RECEIVER_COUNT] = {
+    false, false, true, true};
+#define DIVERSITY_TEST_SELECTION_RECEIVER 2
+
+static buffer_data_t diversityTestBatches[DIVERSITY_TEST_SENSOR_COUNT]
+                                         [ENERGY_GATE_TEST_BATCH_SIZE];
+
+// Writes raw ADC value tick of every sensor. Must be called for tick = 0, 1,
+// 2, ... with *freqTick starting at 0.
+void filterTest_diversitySamples(uint32_t tick, uint16_t *freqTick,
+                                 buffer_data_t values[]) {
+  uint16_t tickCount = filter_frequencyTickTable[DIVERSITY_TEST_FILTER_NUMBER];
+  int32_t square = 0;
+  if (tick >= ENERGY_GATE_TEST_LEAD_IN_LENGTH) {
+    square = (*freqTick < ONE_HALF(tickCount)) ? -1 : 1;
+    *freqTick = (*freqTick + 1 == tickCount) ? 0 : *freqTick + 1;
+  }
+  for (uint16_t s = 0; s < DIVERSITY_TEST_SENSOR_COUNT; s++) {
+    values[s] = BURST_ADC_CENTER + (rand() % (2 * diversityTestNoise[s] + 1)) -
+                diversityTestNoise[s] + square * diversityTestAmplitude[s];
+  }
+}
+
+// Runs the sensors through one receiver, in batches like detector(), with
+// detector_detectHit() as the hit test once the filters have settled. The
+// first two receivers use filter_processBlock(), the others
+// diversity_processBlock(). Returns BURST_NO_HIT or the filter that crossed
+// first. Copies the final weights to weights[] for the diversity receivers
+// and adds the run time to *cycles.
+int16_t filterTest_runDiversityReceiver(uint16_t receiver, double weights[],
+                                        uint64_t *cycles) {
+  filter_init();
+  if (receiver >= DIVERSITY_TEST_SELECTION_RECEIVER)
+    diversity_init(DIVERSITY_TEST_SENSOR_COUNT,
+                   (receiver == DIVERSITY_TEST_SELECTION_RECEIVER)
+                       ? diversity_selection_e
+                       : diversity_maxRatio_e);
+  srand(DIVERSITY_TEST_SEED);
+  const buffer_data_t *batches[DIVERSITY_TEST_SENSOR_COUNT];
+  for (uint16_t s = 0; s < DIVERSITY_TEST_SENSOR_COUNT; s++) {
+    batches[s] = diversityTestBatches[s];
+  }
+  buffer_data_t batch[ENERGY_GATE_TEST_BATCH_SIZE];
+  uint16_t freqTick = 0;
+  int16_t decision = BURST_NO_HIT;
+  for (uint32_t tick = 0; tick < DIVERSITY_TEST_SAMPLE_COUNT;
+       tick += ENERGY_GATE_TEST_BATCH_SIZE) {
+    for (uint32_t i = 0; i < ENERGY_GATE_TEST_BATCH_SIZE; i++) {
+      buffer_data_t values[DIVERSITY_TEST_SENSOR_COUNT];
+      filterTest_diversitySamples(tick + i, &freqTick, values);
+      uint32_t sum = 0;
+      for (uint16_t s = 0; s < DIVERSITY_TEST_SENSOR_COUNT; s++) {
+        diversityTestBatches[s][i] = values[s];
+        sum += values[s];
+      }
+      batch[i] = (receiver == 0) ? values[0] : sum / DIVERSITY_TEST_SENSOR_COUNT;
+    }
+    filter_hitTest_t hitTest =
+        (tick >= ENERGY_GATE_TEST_SETTLE_LENGTH && decision == BURST_NO_HIT)
+            ? detector_detectHit
+            : NULL;
+    filter_blockResult_t result;
+    uint64_t startCycles = cycleCounter_read();
+    if (receiver >= DIVERSITY_TEST_SELECTION_RECEIVER)
+      diversity_processBlock(batches, ENERGY_GATE_TEST_BATCH_SIZE, hitTest,
+                             &result);
+    else
+      filter_processBlock(batch, ENERGY_GATE_TEST_BATCH_SIZE, hitTest, &result);
+    *cycles += cycleCounter_read() - startCycles;
+    if (result.thresholdCrossed)
+      decision = result.crossingFilterNumber;
+  }
+  if (receiver >= DIVERSITY_TEST_SELECTION_RECEIVER)
+    diversity_getWeights(weights);
+  return decision;
+}
+
+// Checks diversity.c:
+// 1. With one sensor, diversity_processBlock() gives exactly the same power as
+// filter_processBlock().
+// 2. On four synthetic sensors, where the shot is weak and reaches only two of
+// them, selection and maximal-ratio combining hit on the right frequency and
+// weight the best sensor most. Sensor 0 alone and an equal-gain average of
+// all four do not hit.
+// Reports the cost per sample of four sensors and of one.
+bool filterTest_runDiversityTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runDiversityTest() =====\n");
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+
+  double powers[2][FILTER_FREQUENCY_COUNT];
+  for (uint16_t run = 0; run < 2; run++) {
+    filter_init();
+    diversity_init(1, diversity_maxRatio_e);
+    srand(PROCESS_BLOCK_TEST_SEED);
+    buffer_data_t *batch = diversityTestBatches[0];
+    const buffer_data_t *batches[1] = {batch};
+    for (uint32_t n = 0; n < PROCESS_BLOCK_TEST_SAMPLE_COUNT;
+         n += ENERGY_GATE_TEST_BATCH_SIZE) {
+      for (uint32_t i = 0; i < ENERGY_GATE_TEST_BATCH_SIZE; i++) {
+        batch[i] = filterTest_processBlockTestInput(n + i);
+      }
+      filter_blockResult_t result;
+      if (run == 0)
+        filter_processBlock(batch, ENERGY_GATE_TEST_BATCH_SIZE, NULL, &result);
+      else
+        diversity_processBlock(batches, ENERGY_GATE_TEST_BATCH_SIZE, NULL,
+                               &result);
+    }
+    filter_getCurrentPowerValues(powers[run]);
+  }
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    if (powers[1][i] != powers[0][i]) {
+      printf("One sensor, filter %d: diversity power (%le) does not match "
+             "filter_processBlock() (%le).\n",
+             i, powers[1][i], powers[0][i]);
+      success = false;
+    }
+  }
+
+  uint64_t cycles[DIVERSITY_TEST_RECEIVER_COUNT];
+  for (uint16_t receiver = 0; receiver < DIVERSITY_TEST_RECEIVER_COUNT;
+       receiver++) {
+    double weights[DIVERSITY_TEST_SENSOR_COUNT];
+    cycles[receiver] = 0;
+    int16_t decision =
+        filterTest_runDiversityReceiver(receiver, weights, &cycles[receiver]);
+    int16_t expected = diversityTestMustHit[receiver]
+                           ? DIVERSITY_TEST_FILTER_NUMBER
+                           : BURST_NO_HIT;
+    if (decision != expected) {
+      printf("%s: decision %d, %d expected.\n",
+             diversityTestReceiverNames[receiver], decision, expected);
+      success = false;
+    }
+    if (receiver < DIVERSITY_TEST_SELECTION_RECEIVER)
+      continue;
+    uint16_t best = 0;
+    for (uint16_t s = 1; s < DIVERSITY_TEST_SENSOR_COUNT; s++) {
+      if (weights[s] > weights[best])
+        best = s;
+    }
+    if (best != 2) {
+      printf("%s: sensor %d has the largest weight, sensor 2 expected.\n",
+             diversityTestReceiverNames[receiver], best);
+      success = false;
+    }
+    if (printMessageFlag)
+      printf("%s: decision %d, weights %.3lf %.3lf %.3lf %.3lf.\n",
+             diversityTestReceiverNames[receiver], decision, weights[0],
+             weights[1], weights[2], weights[3]);
+  }
+  double countsPerSample = (double)cycleCounter_getCountsPerSecond() /
+                           (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000);
+  printf("Four sensors take %.0lf counts per sample, one takes %.0lf, of %.0lf "
+         "available.\n",
+         (double)cycles[DIVERSITY_TEST_RECEIVER_COUNT - 1] /
+             DIVERSITY_TEST_SAMPLE_COUNT,
+         (double)cycles[0] / DIVERSITY_TEST_SAMPLE_COUNT, countsPerSample);
+  filter_init(); // Leave the filters in a clean state for the next test.
+  if (success)
+    printf("Diversity combining hits where one sensor does not.\n");
+  printf("+++++ Exiting filterTest_runDiversityTest() +++++\n");
+  return success;
+}
+
+// Largest difference, in dB, between the CIC and FIR output power at a player
+// frequency.
+#define CIC_TEST_MAX_PLAYER_DIFFERENCE_DB 1.0
+// Largest amount, in dB, by which the CIC output power may exceed the FIR's in
+// the stopband. The transition band in between is not checked.
+#define CIC_TEST_MAX_STOPBAND_EXCESS_DB 3.0
+// The stopband runs from this fraction of the decimated sample rate to the ADC
+// Nyquist frequency, as in filterDesign.h.
+#define CIC_TEST_STOPBAND_START_RATIO 0.8
+// Frequencies checked against the stopband spec.
+#define CIC_TEST_STOPBAND_GRID_COUNT 1000
+// Runs the square wave of filterTest_runSquareWaveFirPowerTest(), as raw ADC
+// values, through filter_firFilterBlock() with the given front end. Returns the
+// summed squared output and adds the FIR cycles per block to *cyclesPerBlock.
+static double filterTest_computeFrontEndPower(filter_frontEnd_t frontEnd,
+                                              uint16_t currentPeriodTickCount,
+                                              double *cyclesPerBlock) {
+  filter_setFrontEnd(frontEnd);
+  filter_init();
+  double power = 0.0;
+  buffer_data_t block[FILTER_FIR_DECIMATION_FACTOR];
+  uint16_t freqTick = 0;
+  for (uint32_t n = 0; n < FILTER_TEST_PULSE_WIDTH_LENGTH;
+       n += FILTER_FIR_DECIMATION_FACTOR) {
+    for (uint16_t i = 0; i < FILTER_FIR_DECIMATION_FACTOR; i++) {
+      block[i] = (freqTick < ONE_HALF(currentPeriodTickCount))
+                     ? 0
+                     : FILTER_ADC_MAX_VALUE;
+      freqTick = (freqTick + 1 == currentPeriodTickCount) ? 0 : freqTick + 1;
+    }
+    double y = filter_firFilterBlock(block);
+    power += y * y;
+  }
+  filter_firStatistics_t statistics;
+  filter_getFirStatistics(&statistics);
+  *cyclesPerBlock += (frontEnd == filter_cicFrontEnd_e)
+                         ? statistics.cicCyclesPerCall
+                         : statistics.blockCyclesPerCall;
+  return power;
+}
+
+// Compares the CIC front end against the FIR front end:
+// 1. On the square waves of filterTest_runSquareWaveFirPowerTest(), the output
+// power at every player frequency is within CIC_TEST_MAX_PLAYER_DIFFERENCE_DB
+// of the FIR's, and no stopband frequency gets through much more than it does
+// through the FIR. The CIC response is plotted like the FIR's.
+// 2. The designed response (decimator and compensator) meets the FIR passband
+// and stopband specs in filterDesign.h.
+// Reports the cost per block of both front ends.
+bool filterTest_runCicFrontEndTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runCicFrontEndTest() =====\n");
+  bool success = true; // Be optimistic.
+  double firPowers[FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT];
+  double cicPowers[FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT];
+  double firCycles = 0.0;
+  double cicCycles = 0.0;
+  for (uint16_t i = 0; i < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT; i++) {
+    firPowers[i] = filterTest_computeFrontEndPower(
+        filter_firFrontEnd_e, filterTest_firTestTickCounts[i], &firCycles);
+    cicPowers[i] = filterTest_computeFrontEndPower(
+        filter_cicFrontEnd_e, filterTest_firTestTickCounts[i], &cicCycles);
+    if (filter_getFrontEnd() != filter_cicFrontEnd_e) {
+      printf("filter_init() did not select the CIC front end.\n");
+      filter_setFrontEnd(filter_firFrontEnd_e);
+      filter_init();
+      return false;
+    }
+  }
+  for (uint16_t i = 0; i < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT; i++) {
+    double frequency = (double)FILTER_SAMPLE_FREQUENCY_IN_KHZ /
+                       filterTest_firTestTickCounts[i];
+    double differenceDb = 10.0 * log10(cicPowers[i] / firPowers[i]);
+    bool inStopband =
+        filterTest_firTestTickCounts[i] * CIC_TEST_STOPBAND_START_RATIO <=
+        FILTER_FIR_DECIMATION_FACTOR;
+    if (printMessageFlag)
+      printf("%5.2lf kHz: FIR %le, CIC %le (%+.2lf dB).\n", frequency,
+             firPowers[i], cicPowers[i], differenceDb);
+    if (i < FILTER_FREQUENCY_COUNT &&
+        fabs(differenceDb) > CIC_TEST_MAX_PLAYER_DIFFERENCE_DB) {
+      printf("%.2lf kHz: CIC power is %.2lf dB from the FIR's.\n", frequency,
+             differenceDb);
+      success = false;
+    }
+    if (inStopband && differenceDb > CIC_TEST_MAX_STOPBAND_EXCESS_DB) {
+      printf("%.2lf kHz: CIC passes %.2lf dB more than the FIR.\n", frequency,
+             differenceDb);
+      success = false;
+    }
+  }
+
+  // Check the designed response against the FIR specs.
+  const double *compensator = filter_getCicCompensatorCoefficientArray();
+  double worstPassbandLossDb = 0.0;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    double w = 2.0 * M_PI / filter_frequencyTickTable[i];
+    double magnitude =
+        cic_getMagnitude(FILTER_FIR_DECIMATION_FACTOR, w) *
+        filterDesign_getFirMagnitude(compensator, CIC_COMPENSATOR_TAP_COUNT,
+                                     w * FILTER_FIR_DECIMATION_FACTOR);
+    worstPassbandLossDb =
+        fmax(worstPassbandLossDb, fabs(20.0 * log10(magnitude)));
+  }
+  double worstStopbandLossDb = INFINITY;
+  double stopbandStart =
+      CIC_TEST_STOPBAND_START_RATIO * 2.0 * M_PI / FILTER_FIR_DECIMATION_FACTOR;
+  for (uint16_t j = 0; j <= CIC_TEST_STOPBAND_GRID_COUNT; j++) {
+    double w = stopbandStart +
+               (M_PI - stopbandStart) * j / CIC_TEST_STOPBAND_GRID_COUNT;
+    double magnitude =
+        cic_getMagnitude(FILTER_FIR_DECIMATION_FACTOR, w) *
+        filterDesign_getFirMagnitude(compensator, CIC_COMPENSATOR_TAP_COUNT,
+                                     w * FILTER_FIR_DECIMATION_FACTOR);
+    worstStopbandLossDb = fmin(worstStopbandLossDb, -20.0 * log10(magnitude));
+  }
+  printf("CIC front end: worst player-frequency loss %.2lf dB, least "
+         "stopband loss %.1lf dB.\n",
+         worstPassbandLossDb, worstStopbandLossDb);
+  if (worstPassbandLossDb > FILTER_DESIGN_FIR_MAX_PASSBAND_LOSS ||
+      worstStopbandLossDb < FILTER_DESIGN_FIR_MIN_STOPBAND_LOSS) {
+    printf("The CIC front end misses the FIR specs in filterDesign.h.\n");
+    success = false;
+  }
+  printf("FIR takes %.0lf counts per block, CIC %.0lf.\n",
+         firCycles / FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT,
+         cicCycles / FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT);
+  filter_setFrontEnd(filter_firFrontEnd_e);
+  filter_init(); // Leave the filters in a clean state for the next test.
+  printf("Plotting the CIC front end's response to square-wave input.\n");
+  filterTest_plotFirFrequencyResponse(cicPowers);
+  if (success)
+    printf("The CIC front end matches the FIR at the player frequencies.\n");
+  printf("+++++ Exiting filterTest_runCicFrontEndTest() +++++\n");
+  return success;
+}
+
+// filterTest_runNoiseFloorTest() feeds three ambients, each followed by a shot:
+// indoors, low noise plus a steady lamp tone in another channel's band;
+// outdoors, strong sunlight noise; and a lamp in the shot channel's own band,
+// which raises that channel's floor above its neighbours'. The shot starts
+// after the floors have settled.
+#define NOISE_FLOOR_TEST_SCENARIO_COUNT 3
+#define NOISE_FLOOR_TEST_LEAD_IN_LENGTH 100000
+#define NOISE_FLOOR_TEST_SAMPLE_COUNT                                          \
+  (NOISE_FLOOR_TEST_LEAD_IN_LENGTH + BURST_LENGTH)
+#define NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER 2
+#define NOISE_FLOOR_TEST_SEED 1357
+#define NOISE_FLOOR_TEST_COST_CALL_COUNT 10000
+// Indoors, the lamp's floor must be at least this many times the shot
+// channel's.
+#define NOISE_FLOOR_TEST_MIN_LAMP_RATIO 100.0
+static const char
+    *noiseFloorTestScenarioNames[NOISE_FLOOR_TEST_SCENARIO_COUNT] = {
+        "indoors", "outdoors", "lamp on the shot channel"};
+static const int32_t noiseFloorTestNoise[NOISE_FLOOR_TEST_SCENARIO_COUNT] = {
+    50, 400, 50};
+static const int32_t noiseFloorTestLamp[NOISE_FLOOR_TEST_SCENARIO_COUNT] = {
+    300, 0, 100};
+static const uint16_t
+    noiseFloorTestLampFilterNumber[NOISE_FLOOR_TEST_SCENARIO_COUNT] = {
+        7, 7, NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER};
+static const int32_t noiseFloorTestShot[NOISE_FLOOR_TEST_SCENARIO_COUNT] = {
+    600, 300, 600};
+// First hit of detector_detectHit() with the default fudge factor: the lamp,
+// before the shot, indoors and on the shot channel; none outdoors, where it
+// misses the shot.
+static const int16_t
+    noiseFloorTestMedianDecision[NOISE_FLOOR_TEST_SCENARIO_COUNT] = {
+        7, BURST_NO_HIT, NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER};
+
+static uint16_t noiseFloorTestSnrFrequency; // Set by filterTest_snrHitTest().
+
+// detector_detectHitSnr(), noting the frequency it picked: the highest power.
+static bool filterTest_snrHitTest(double powerValues[]) {
+  if (!detector_detectHitSnr(powerValues))
+    return false;
+  noiseFloorTestSnrFrequency = 0;
+  for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++) {
+    if (powerValues[i] > powerValues[noiseFloorTestSnrFrequency])
+      noiseFloorTestSnrFrequency = i;
+  }
+  return true;
+}
+
+// Returns raw ADC value tick of a scenario. Must be called for tick = 0, 1, 2,
+// ... with lampTick and shotTick starting at 0.
+static buffer_data_t filterTest_noiseFloorSample(uint16_t scenario,
+                                                 uint32_t tick,
+                                                 uint16_t *lampTick,
+                                                 uint16_t *shotTick) {
+  uint16_t lampTickCount =
+      filter_frequencyTickTable[noiseFloorTestLampFilterNumber[scenario]];
+  uint16_t shotTickCount =
+      filter_frequencyTickTable[NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER];
+  int32_t value = BURST_ADC_CENTER +
+                  (rand() % (2 * noiseFloorTestNoise[scenario] + 1)) -
+                  noiseFloorTestNoise[scenario];
+  value += (*lampTick < ONE_HALF(lampTickCount)) ? -noiseFloorTestLamp[scenario]
+                                                 : noiseFloorTestLamp[scenario];
+  *lampTick = (*lampTick + 1 == lampTickCount) ? 0 : *lampTick + 1;
+  if (tick >= NOISE_FLOOR_TEST_LEAD_IN_LENGTH) {
+    value += (*shotTick < ONE_HALF(shotTickCount))
+                 ? -noiseFloorTestShot[scenario]
+                 : noiseFloorTestShot[scenario];
+    *shotTick = (*shotTick + 1 == shotTickCount) ? 0 : *shotTick + 1;
+  }
+  return value;
+}
+
+// Runs a scenario through filter_processBlock() in batches like detector(),
+// with hitTest once the floors have been learned. Returns BURST_NO_HIT or the
+// frequency of the first hit, and sets *hitTick to the sample it came in. The
+// frequency is the highest power.
+static int16_t filterTest_runNoiseFloorScenario(uint16_t scenario,
+                                                filter_hitTest_t hitTest,
+                                                uint32_t *hitTick) {
+  filter_init();
+  srand(NOISE_FLOOR_TEST_SEED);
+  buffer_data_t batch[ENERGY_GATE_TEST_BATCH_SIZE];
+  uint16_t lampTick = 0;
+  uint16_t shotTick = 0;
+  for (uint32_t tick = 0; tick < NOISE_FLOOR_TEST_SAMPLE_COUNT;
+       tick += ENERGY_GATE_TEST_BATCH_SIZE) {
+    for (uint32_t i = 0; i < ENERGY_GATE_TEST_BATCH_SIZE; i++) {
+      batch[i] =
+          filterTest_noiseFloorSample(scenario, tick + i, &lampTick, &shotTick);
+    }
+    filter_blockResult_t result;
+    filter_processBlock(batch, ENERGY_GATE_TEST_BATCH_SIZE,
+                        (tick >= ENERGY_GATE_TEST_SETTLE_LENGTH) ? hitTest
+                                                                 : NULL,
+                        &result);
+    if (result.thresholdCrossed) {
+      *hitTick = tick + (result.crossingOutputIndex + 1) *
+                            FILTER_FIR_DECIMATION_FACTOR;
+      return (hitTest == detector_detectHit) ? result.crossingFilterNumber
+                                             : noiseFloorTestSnrFrequency;
+    }
+  }
+  return BURST_NO_HIT;
+}
+
+// Checks the noise floors and detector_detectHitSnr() in three ambients:
+// 1. Before the shot, no channel's power is far above its floor, so the SNR
+// test does not hit, even on the lamps that the median test hits.
+// 2. The SNR test hits the shot, on the right frequency, in every ambient. The
+// median test misses it outdoors. With the lamp on the shot channel, the shot
+// leaks into the quiet neighbours further above their floors than it rises
+// above its own, so picking the channel by power over floor would miss it.
+// 3. Indoors, the lamp's floor is far above the shot channel's.
+// Reports the cost of the median and the SNR hit tests.
+bool filterTest_runNoiseFloorTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runNoiseFloorTest() =====\n");
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+  for (uint16_t scenario = 0; scenario < NOISE_FLOOR_TEST_SCENARIO_COUNT;
+       scenario++) {
+    const char *name = noiseFloorTestScenarioNames[scenario];
+    uint32_t medianTick = 0;
+    int16_t median = filterTest_runNoiseFloorScenario(
+        scenario, detector_detectHit, &medianTick);
+    if (median != noiseFloorTestMedianDecision[scenario]) {
+      printf("%s: the median test hits %d, %d expected.\n", name, median,
+             noiseFloorTestMedianDecision[scenario]);
+      success = false;
+    }
+    uint32_t snrTick = 0;
+    int16_t snr = filterTest_runNoiseFloorScenario(
+        scenario, filterTest_snrHitTest, &snrTick);
+    if (snr != NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER ||
+        snrTick < NOISE_FLOOR_TEST_LEAD_IN_LENGTH) {
+      printf("%s: the SNR test hits %d at sample %d, %d after sample %d "
+             "expected.\n",
+             name, snr, snrTick, NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER,
+             NOISE_FLOOR_TEST_LEAD_IN_LENGTH);
+      success = false;
+    }
+    double floors[FILTER_FREQUENCY_COUNT];
+    filter_getNoiseFloors(floors);
+    double lampRatio = floors[noiseFloorTestLampFilterNumber[scenario]] /
+                       floors[NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER];
+    if (noiseFloorTestLamp[scenario] > 0 &&
+        noiseFloorTestLampFilterNumber[scenario] !=
+            NOISE_FLOOR_TEST_SHOT_FILTER_NUMBER &&
+        lampRatio < NOISE_FLOOR_TEST_MIN_LAMP_RATIO) {
+      printf("%s: the lamp's floor is only %.1lf times the shot channel's.\n",
+             name, lampRatio);
+      success = false;
+    }
+    if (printMessageFlag)
+      printf("%s: median test hits %d at sample %d, SNR test hits %d at "
+             "sample %d, lamp floor %.1lf times the shot channel's.\n",
+             name, median, medianTick, snr, snrTick, lampRatio);
+  }
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(powerValues);
+  volatile bool sink; // Keeps the compiler from discarding the calls.
+  uint64_t startCycles = cycleCounter_read();
+  for (uint32_t i = 0; i < NOISE_FLOOR_TEST_COST_CALL_COUNT; i++) {
+    sink = detector_detectHit(powerValues);
+  }
+  uint64_t medianCycles = cycleCounter_read() - startCycles;
+  startCycles = cycleCounter_read();
+  for (uint32_t i = 0; i < NOISE_FLOOR_TEST_COST_CALL_COUNT; i++) {
+    sink = detector_detectHitSnr(powerValues);
+  }
+  uint64_t snrCycles = cycleCounter_read() - startCycles;
+  (void)sink;
+  printf("The median hit test takes %.0lf counts per output, the SNR test "
+         "%.0lf.\n",
+         (double)medianCycles / NOISE_FLOOR_TEST_COST_CALL_COUNT,
+         (double)snrCycles / NOISE_FLOOR_TEST_COST_CALL_COUNT);
+  filter_init(); // Leave the filters in a clean state for the next test.
+  if (success)
+    printf("The SNR hit test ignores the ambient and hits the shot.\n");
+  printf("+++++ Exiting filterTest_runNoiseFloorTest() +++++\n");
+  return success;
+}
+
+// Largest allowed difference between the biquad and direct-form power for any
+// filter, as a fraction of the largest direct-form power at that frequency.
+#define BIQUAD_ENGINE_POWER_ERROR_BUDGET 1.0E-4
+// Runs each user frequency through the direct-form and the single-precision
+// biquad engines. The power of every filter must agree within the error budget
+// and both engines must pick the same strongest filter.
+bool filterTest_runBiquadEngineTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runBiquadEngineTest() =====\n");
+  bool success = true; // Be optimistic.
+  double worstError = 0.0;
+  for (uint16_t testPeriodIndex = 0; testPeriodIndex < FILTER_FREQUENCY_COUNT;
+       testPeriodIndex++) {
+    double directFormPower[FILTER_FREQUENCY_COUNT];
+    double biquadPower[FILTER_FREQUENCY_COUNT];
+    filter_setEngine(filter_directFormEngine_e);
+    filterTest_computeSquareWaveIirPowers(
+        filterTest_firTestTickCounts[testPeriodIndex], directFormPower);
+    filter_setEngine(filter_biquadEngine_e);
+    filterTest_computeSquareWaveIirPowers(
+        filterTest_firTestTickCounts[testPeriodIndex], biquadPower);
+    if (filter_getEngine() != filter_biquadEngine_e) {
+      printf("filter_init() did not select the biquad engine.\n");
+      success = false;
+      break;
+    }
+    uint16_t directFormMaxIndex = 0;
+    uint16_t biquadMaxIndex = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (directFormPower[i] > directFormPower[directFormMaxIndex])
+        directFormMaxIndex = i;
+      if (biquadPower[i] > biquadPower[biquadMaxIndex])
+        biquadMaxIndex = i;
+    }
+    double maxPower = directFormPower[directFormMaxIndex];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      double error = fabs(biquadPower[i] - directFormPower[i]) / maxPower;
+      if (error > worstError)
+        worstError = error;
+      if (error > BIQUAD_ENGINE_POWER_ERROR_BUDGET) {
+        printf("Frequency %d, filter %d: biquad power %le differs from "
+               "direct-form power %le by %le of the maximum.\n",
+               testPeriodIndex, i, biquadPower[i], directFormPower[i], error);
+        success = false;
+      }
+    }
+    if (directFormMaxIndex != biquadMaxIndex) {
+      printf("Frequency %d: biquad engine picked filter %d, direct form "
+             "picked filter %d.\n",
+             testPeriodIndex, biquadMaxIndex, directFormMaxIndex);
+      success = false;
+    }
+  }
+  if (printMessageFlag)
+    printf("Worst biquad power error: %le of the maximum power.\n",
+           worstError);
+  filter_setEngine(filter_directFormEngine_e); // Back to the default engine.
+  filter_init();
+  if (success)
+    printf("Biquad engine matches the direct-form engine.\n");
+  printf("+++++ Exiting filterTest_runBiquadEngineTest() +++++\n");
+  return success;
+}
+
+// Largest allowed difference between the fixed-point and double power for any
+// filter, as a fraction of the largest power seen for a user frequency (a
+// full-scale hit). Out-of-band powers are tiny, so scaling by their own maximum
+// would only measure quantization noise.
+#define FIXED_POINT_POWER_ERROR_BUDGET 1.0E-3
+// Runs the filter_* (double) chain and the filterFixed_* chain side by side on
+// the user and out-of-band square waves. For each test frequency the power of
+// all 10 filters must agree within the error budget and, for the user
+// frequencies, both chains must pick the same filter as the strongest.
+// Reports the worst error and the cost of both chains per input sample.
+// Only meaningful when filter.c is built in double precision.
+bool filterTest_runFixedPointAccuracyTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runFixedPointAccuracyTest() =====\n");
+  bool success = true; // Be optimistic.
+  double worstError = 0.0;
+  double fullScalePower = 0.0; // User frequencies run first and set this.
+  uint32_t sampleCount = 0;
+  uint64_t doubleCycles = 0;
+  uint64_t fixedCycles = 0;
+  for (uint16_t testPeriodIndex = 0;
+       testPeriodIndex < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT;
+       testPeriodIndex++) {
+    filter_init(); // Start both chains from zero.
+    if (!filterFixed_init()) {
+      printf("filterFixed_init() could not factor the IIR filters.\n");
+      success = false;
+      break;
+    }
+    uint16_t currentPeriodTickCount =
+        filterTest_firTestTickCounts[testPeriodIndex];
+    uint16_t decimationCount = 0;
+    uint32_t totalTickCount = 0;
+    while (totalTickCount < FILTER_TEST_PULSE_WIDTH_LENGTH) {
+      for (uint16_t freqTick = 0; freqTick < currentPeriodTickCount;
+           freqTick++) {
+        double filterValue = computeFilterInput(freqTick, currentPeriodTickCount);
+        filterFixed_sample_t fixedValue =
+            filterFixed_inputFromDouble(filterValue);
+        uint64_t startCycles = cycleCounter_read();
+        filter_addNewInput(filterValue);
+        uint64_t middleCycles = cycleCounter_read();
+        filterFixed_addNewInput(fixedValue);
+        doubleCycles += middleCycles - startCycles;
+        fixedCycles += cycleCounter_read() - middleCycles;
+        if (++decimationCount == FILTER_FIR_DECIMATION_FACTOR) {
+          decimationCount = 0;
+          startCycles = cycleCounter_read();
+          filter_firFilter();
+          for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            filter_iirFilter(i);
+            filter_computePower(i, false, false);
+          }
+          middleCycles = cycleCounter_read();
+          filterFixed_firFilter();
+          for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            filterFixed_iirFilter(i);
+            filterFixed_computePower(i, false);
+          }
+          doubleCycles += middleCycles - startCycles;
+          fixedCycles += cycleCounter_read() - middleCycles;
+        }
+        totalTickCount++;
+      }
+    }
+    sampleCount += totalTickCount;
+    double doublePower[FILTER_FREQUENCY_COUNT];
+    double fixedPower[FILTER_FREQUENCY_COUNT];
+    uint16_t doubleMaxIndex = 0;
+    uint16_t fixedMaxIndex = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      doublePower[i] = filter_computePower(i, true, false);
+      fixedPower[i] =
+          filterFixed_powerToDouble(filterFixed_computePower(i, true));
+      if (doublePower[i] > doublePower[doubleMaxIndex])
+        doubleMaxIndex = i;
+      if (fixedPower[i] > fixedPower[fixedMaxIndex])
+        fixedMaxIndex = i;
+    }
+    if (doublePower[doubleMaxIndex] > fullScalePower)
+      fullScalePower = doublePower[doubleMaxIndex];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      double error = fullScalePower > 0.0
+                         ? fabs(fixedPower[i] - doublePower[i]) / fullScalePower
+                         : 0.0;
+      if (error > worstError)
+        worstError = error;
+      if (error > FIXED_POINT_POWER_ERROR_BUDGET) {
+        printf("Tick count %d, filter %d: fixed-point power %le differs from "
+               "double power %le by %le of full scale.\n",
+               currentPeriodTickCount, i, fixedPower[i], doublePower[i], error);
+        success = false;
+      }
+    }
+    if (testPeriodIndex < FILTER_FREQUENCY_COUNT &&
+        doubleMaxIndex != fixedMaxIndex) {
+      printf("Tick count %d: fixed-point chain picked filter %d, double chain "
+             "picked filter %d.\n",
+             currentPeriodTickCount, fixedMaxIndex, doubleMaxIndex);
+      success = false;
+    }
+  }
+  if (printMessageFlag && sampleCount > 0) {
+    printf("Worst fixed-point power error: %le of full scale (%le).\n",
+           worstError, fullScalePower);
+    printf("Double chain takes %.1lf counts per input sample, fixed point "
+           "%.1lf.\n",
+           (double)doubleCycles / sampleCount,
+           (double)fixedCycles / sampleCount);
+  }
+  filter_init(); // Leave the filters in a clean state for the next test.
+  if (success)
+    printf("Fixed-point filter chain matches the double-precision chain.\n");
+  printf("+++++ Exiting filterTest_runFixedPointAccuracyTest() +++++\n");
+  return success;
+}
+
+// Largest allowed difference between the single- and double-precision power
+// for any filter, as a fraction of the largest power seen for a user
+// frequency, as in the fixed-point test.
+#define SINGLE_PRECISION_POWER_ERROR_BUDGET 5.0E-5
+// Largest allowed difference in the power of the strongest filter at each
+// user frequency, as a fraction of that power.
+#define SINGLE_PRECISION_PEAK_ERROR_BUDGET 5.0E-5
+// Each test frequency runs for this many pulse widths, so the power window
+// wraps several times and any drift of the incremental float power shows.
+#define SINGLE_PRECISION_TEST_PULSE_WIDTH_COUNT 5
+// Hit decisions are compared only while the strongest filter has at least the
+// power that 12-bit ADC quantization noise alone gives over a pulse width
+// (an LSB of 2/4096, noise power LSB^2/12 per output). Below it the receiver
+// cannot decide anything, and float rounding of powers near zero flips the
+// median rule at random.
+#define SINGLE_PRECISION_MIN_DECISION_POWER                                    \
+  (FILTER_INPUT_PULSE_WIDTH * (2.0 / 4096) * (2.0 / 4096) / 12.0)
+// Runs the filter_* (double) chain and the filterFloat_* chain side by side on
+// the user and out-of-band square waves, updating both powers incrementally
+// after every FIR output. At the end of each test frequency the power of all
+// filters must agree within the error budgets. After every output above
+// SINGLE_PRECISION_MIN_DECISION_POWER, both powers go through
+// detector_detectHit(), and the two must agree every time.
+// Reports the worst errors, the disagreements and the cost of both chains.
+// Only meaningful when filter.c is built in double precision.
+bool filterTest_runSinglePrecisionAccuracyTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runSinglePrecisionAccuracyTest() =====\n");
+  bool success = true; // Be optimistic.
+  detector_init();     // Default fudge factor.
+  double worstError = 0.0;
+  double worstPeakError = 0.0;
+  double fullScalePower = 0.0; // User frequencies run first and set this.
+  uint32_t outputCount = 0;
+  uint32_t decisionCount = 0; // Outputs where the hit decisions are compared.
+  uint32_t disagreementCount = 0;
+  uint64_t doubleCycles = 0;
+  uint64_t floatCycles = 0;
+  for (uint16_t testPeriodIndex = 0;
+       testPeriodIndex < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT;
+       testPeriodIndex++) {
+    filter_init(); // Start both chains from zero.
+    filterFloat_init();
+    uint16_t currentPeriodTickCount =
+        filterTest_firTestTickCounts[testPeriodIndex];
+    uint16_t decimationCount = 0;
+    uint16_t freqTick = 0;
+    double doublePower[FILTER_FREQUENCY_COUNT];
+    double floatPower[FILTER_FREQUENCY_COUNT];
+    for (uint32_t tick = 0; tick < SINGLE_PRECISION_TEST_PULSE_WIDTH_COUNT *
+                                       FILTER_TEST_PULSE_WIDTH_LENGTH;
+         tick++) {
+      double filterValue = computeFilterInput(freqTick, currentPeriodTickCount);
+      freqTick = (freqTick + 1 == currentPeriodTickCount) ? 0 : freqTick + 1;
+      uint64_t startCycles = cycleCounter_read();
+      filter_addNewInput(filterValue);
+      uint64_t middleCycles = cycleCounter_read();
+      filterFloat_addNewInput(filterValue);
+      doubleCycles += middleCycles - startCycles;
+      floatCycles += cycleCounter_read() - middleCycles;
+      if (++decimationCount < FILTER_FIR_DECIMATION_FACTOR)
+        continue;
+      decimationCount = 0;
+      startCycles = cycleCounter_read();
+      filter_firFilter();
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        filter_iirFilter(i);
+        doublePower[i] = filter_computePower(i, false, false);
+      }
+      middleCycles = cycleCounter_read();
+      filterFloat_firFilter();
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        filterFloat_iirFilter(i);
+        floatPower[i] = filterFloat_computePower(i, false);
+      }
+      doubleCycles += middleCycles - startCycles;
+      floatCycles += cycleCounter_read() - middleCycles;
+      outputCount++;
+      double strongestPower = 0.0;
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        strongestPower = fmax(strongestPower, doublePower[i]);
+      }
+      if (strongestPower < SINGLE_PRECISION_MIN_DECISION_POWER)
+        continue;
+      decisionCount++;
+      if (detector_detectHit(doublePower) != detector_detectHit(floatPower))
+        disagreementCount++;
+    }
+    uint16_t doubleMaxIndex = 0;
+    uint16_t floatMaxIndex = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (doublePower[i] > doublePower[doubleMaxIndex])
+        doubleMaxIndex = i;
+      if (floatPower[i] > floatPower[floatMaxIndex])
+        floatMaxIndex = i;
+    }
+    if (doublePower[doubleMaxIndex] > fullScalePower)
+      fullScalePower = doublePower[doubleMaxIndex];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      double error = fabs(floatPower[i] - doublePower[i]) / fullScalePower;
+      if (error > worstError)
+        worstError = error;
+      if (error > SINGLE_PRECISION_POWER_ERROR_BUDGET) {
+        printf("Tick count %d, filter %d: single-precision power %le differs "
+               "from double power %le by %le of full scale.\n",
+               currentPeriodTickCount, i, floatPower[i], doublePower[i], error);
+        success = false;
+      }
+    }
+    if (testPeriodIndex >= FILTER_FREQUENCY_COUNT)
+      continue;
+    double peakError =
+        fabs(floatPower[doubleMaxIndex] - doublePower[doubleMaxIndex]) /
+        doublePower[doubleMaxIndex];
+    if (peakError > worstPeakError)
+      worstPeakError = peakError;
+    if (peakError > SINGLE_PRECISION_PEAK_ERROR_BUDGET) {
+      printf("Tick count %d: single-precision power of filter %d is off by "
+             "%le of itself.\n",
+             currentPeriodTickCount, doubleMaxIndex, peakError);
+      success = false;
+    }
+    if (doubleMaxIndex != floatMaxIndex) {
+      printf("Tick count %d: single-precision chain picked filter %d, double "
+             "chain picked filter %d.\n",
+             currentPeriodTickCount, floatMaxIndex, doubleMaxIndex);
+      success = false;
+    }
+  }
+  if (disagreementCount > 0) {
+    printf("detector_detectHit() disagrees on %d of %d outputs.\n",
+           disagreementCount, decisionCount);
+    success = false;
+  }
+  if (printMessageFlag) {
+    printf("Worst single-precision power error: %le of full scale (%le), "
+           "%le of the strongest filter's power.\n",
+           worstError, fullScalePower, worstPeakError);
+    printf("Hit decisions disagree on %d of %d outputs above the ADC noise.\n",
+           disagreementCount, decisionCount);
+    printf("Double chain takes %.0lf counts per output, single precision "
+           "%.0lf.\n",
+           (double)doubleCycles / outputCount,
+           (double)floatCycles / outputCount);
+  }
+  filter_init(); // Leave the filters in a clean state for the next test.
+  if (success)
+    printf("Single-precision filter chain matches the double-precision "
+           "chain.\n");
+  printf("+++++ Exiting filterTest_runSinglePrecisionAccuracyTest() +++++\n");
+  return success;
+}
+
+// Checks the queue arena in filter.c: the coefficient tables and queue data
+// start on a cache line, and the zQueues follow each other. Also checks the
+// footprint: without the boxcar estimator filter.c holds at most
+// QUEUE_LAYOUT_MAX_ARENA_BYTES, and the boxcar windows are allocated only while
+// that estimator is selected.
+#define QUEUE_LAYOUT_MAX_ARENA_BYTES 8192
+bool filterTest_runQueueLayoutTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runQueueLayoutTest() =====\n");
+  bool success = true; // Be optimistic.
+  filter_init();
+  if ((uintptr_t)filter_getFirCoefficientArray() % FILTER_CACHE_LINE_SIZE ||
+      (uintptr_t)filter_getXQueue()->data % FILTER_CACHE_LINE_SIZE) {
+    printf("The FIR coefficients or xQueue do not start on a cache line.\n");
+    success = false;
+  }
+  for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++) {
+    if (filter_getZQueue(i)->data !=
+        filter_getZQueue(i - 1)->data +
+            QUEUE_MIRRORED_STORAGE_SIZE(queue_size(filter_getZQueue(i - 1)))) {
+      printf("zQueue %d does not follow zQueue %d in the arena.\n", i, i - 1);
+      success = false;
+    }
+  }
+  if (printMessageFlag) {
+    queue_t *lastZQueue = filter_getZQueue(FILTER_FREQUENCY_COUNT - 1);
+    const queue_data_t *end =
+        lastZQueue->data + QUEUE_MIRRORED_STORAGE_SIZE(queue_size(lastZQueue));
+    printf("xQueue, yQueue and the zQueues take %d bytes.\n",
+           (int)((const char *)end - (const char *)filter_getXQueue()->data));
+  }
+  uint32_t boxcarBytes = filter_getStorageSize();
+  uint32_t windowBytes = FILTER_FREQUENCY_COUNT *
+                         queue_size(filter_getIirOutputQueue(0)) *
+                         sizeof(queue_data_t);
+  filter_setPowerEstimator(filter_blockSumPower_e);
+  filter_init();
+  uint32_t arenaBytes = filter_getStorageSize();
+  if (arenaBytes > QUEUE_LAYOUT_MAX_ARENA_BYTES) {
+    printf("filter.c holds %d bytes without the boxcar estimator, more than "
+           "%d.\n",
+           (int)arenaBytes, QUEUE_LAYOUT_MAX_ARENA_BYTES);
+    success = false;
+  }
+  if (boxcarBytes < arenaBytes + windowBytes) {
+    printf("filter.c holds %d bytes with the boxcar estimator, less than its "
+           "%d-byte windows need.\n",
+           (int)boxcarBytes, (int)windowBytes);
+    success = false;
+  }
+  if (printMessageFlag)
+    printf("filter.c holds %d bytes, %d with the boxcar windows.\n",
+           (int)arenaBytes, (int)boxcarBytes);
+  filter_setPowerEstimator(filter_boxcarPower_e); // Back to the default.
+  filter_init();
+  if (success)
+    printf("The filter queues are packed in the aligned arena.\n");
+  printf("+++++ Exiting filterTest_runQueueLayoutTest() +++++\n");
+  return success;
+}
+#endif
+
+#ifdef FILTER_REDUCED_PRECISION
+// Runs a pulse width of each user frequency through the filter_* API, which
+// FILTER_FIXED_POINT or FILTER_SINGLE_PRECISION routes to filterFixed.c or
+// filterFloat.c, updating the power incrementally after every FIR output as
+// detector() does. The filter for that frequency must have the most power,
+// and the incremental power must match a from-scratch recomputation within
+// REDUCED_PRECISION_POWER_TOLERANCE of itself. Reports the cost of the chain
+// per input sample.
+#define REDUCED_PRECISION_POWER_TOLERANCE 1.0E-4
+bool filterTest_runReducedPrecisionChainTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  printf("===== Starting filterTest_runReducedPrecisionChainTest() =====\n");
+  bool success = true; // Be optimistic.
+  uint32_t sampleCount = 0;
+  uint64_t cycles = 0;
+  for (uint16_t freqIndex = 0; freqIndex < FILTER_FREQUENCY_COUNT;
+       freqIndex++) {
+    filter_init();
+    uint16_t currentPeriodTickCount = filterTest_firTestTickCounts[freqIndex];
+    uint16_t decimationCount = 0;
+    uint16_t freqTick = 0;
+    for (uint32_t tick = 0; tick < FILTER_TEST_PULSE_WIDTH_LENGTH; tick++) {
+      double filterValue = computeFilterInput(freqTick, currentPeriodTickCount);
+      freqTick = (freqTick + 1 == currentPeriodTickCount) ? 0 : freqTick + 1;
+      uint64_t startCycles = cycleCounter_read();
+      filter_addNewInput(filterValue);
+      if (++decimationCount == FILTER_FIR_DECIMATION_FACTOR) {
+        decimationCount = 0;
+        filter_firFilter();
+        filter_iirFilterBank();
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+          filter_computePower(i, false, false);
+        }
+      }
+      cycles += cycleCounter_read() - startCycles;
+    }
+    sampleCount += FILTER_TEST_PULSE_WIDTH_LENGTH;
+    uint16_t maxIndex = 0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      double incrementalPower = filter_getCurrentPowerValue(i);
+      double exactPower = filter_computePower(i, true, false);
+      if (fabs(incrementalPower - exactPower) >
+          REDUCED_PRECISION_POWER_TOLERANCE * exactPower) {
+        printf("Tick count %d, filter %d: incremental power %le does not "
+               "match %le.\n",
+               currentPeriodTickCount, i, incrementalPower, exactPower);
+        success = false;
+      }
+      if (exactPower > filter_getCurrentPowerValue(maxIndex))
+        maxIndex = i;
+    }
+    if (maxIndex != freqIndex ||
+        filter_getCurrentPowerValue(maxIndex) <= 0.0) {
+      printf("Tick count %d: filter %d has the most power (%le), not filter "
+             "%d.\n",
+             currentPeriodTickCount, maxIndex,
+             filter_getCurrentPowerValue(maxIndex), freqIndex);
+      success = false;
+    }
+  }
+  if (printMessageFlag)
+    printf("The filter chain takes %.1lf counts per input sample.\n",
+           (double)cycles / sampleCount);
+  filter_init(); // Leave the filters in a clean state for the next test.
+  if (success)
+    printf("The reduced-precision chain picks every user frequency.\n");
+  printf("+++++ Exiting filterTest_runReducedPrecisionChainTest() +++++\n");
+  return success;
+}
+#endif
+
+// The designed tables must match filter.c within these relative errors. The
+// FIR taps are reproduced almost exactly; the IIR denominator expands ten
+// complex roots, so its taps only carry about 13 digits.
+#define FILTER_DESIGN_FIR_TOLERANCE 1.0E-12
+#define FILTER_DESIGN_IIR_TOLERANCE 1.0E-9
+#define FILTER_DESIGN_BANDWIDTH_HZ 50.0
+// Relative difference of designed from expected, scaled by scale.
+static double filterTest_relativeError(double designed, double expected,
+                                       double scale) {
+  return fabs(designed - expected) / fabs(scale);
+}
+
+// Designs the tables for the current plan (sample rate, decimation and the
+// frequencies of filter_frequencyTickTable) with filterDesign.c and checks
+// that they match the tables that filter.c uses and meet the specs in
+// filterDesign.h.
+bool filterTest_runFilterDesignTest(bool printMessageFlag) {
+  printf("===== Starting filterTest_runFilterDesignTest() =====\n");
+  bool success = true; // Be optimistic.
+  filterDesign_plan_t plan;
+  plan.sampleFrequencyHz = FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000.0;
+  plan.decimationFactor = FILTER_FIR_DECIMATION_FACTOR;
+  plan.channelCount = FILTER_FREQUENCY_COUNT;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    // The player frequencies were rounded to whole hertz for the design.
+    plan.channelFrequencyHz[i] =
+        round(plan.sampleFrequencyHz / filter_frequencyTickTable[i]);
+  }
+  plan.bandwidthHz = FILTER_DESIGN_BANDWIDTH_HZ;
+  static filterDesign_tables_t tables;
+  if (!filterDesign_design(&plan, &tables)) {
+    printf("+++++ Exiting filterTest_runFilterDesignTest() +++++\n");
+    return false;
+  }
+
+  if (tables.firCoefficientCount != filter_getFirCoefficientCount() ||
+      tables.pulseWidth != FILTER_INPUT_PULSE_WIDTH) {
+    printf("Designed %d FIR taps and a pulse width of %u, filter.c uses %d "
+           "and %d.\n",
+           tables.firCoefficientCount, tables.pulseWidth,
+           filter_getFirCoefficientCount(), FILTER_INPUT_PULSE_WIDTH);
+    success = false;
+  }
+  const double *fir = filter_getFirCoefficientArray();
+  double worstFirError = 0.0;
+  double firScale = fir[(filter_getFirCoefficientCount() - 1) / 2];
+  for (uint16_t i = 0; success && i < tables.firCoefficientCount; i++) {
+    worstFirError = fmax(worstFirError,
+                         filterTest_relativeError(tables.fir[i], fir[i],
+                                                  firScale));
+  }
+  double worstIirError = 0.0;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    if (tables.tickCount[i] != filter_frequencyTickTable[i]) {
+      printf("Filter %d: designed tick count %d, expected %d.\n", i,
+             tables.tickCount[i], filter_frequencyTickTable[i]);
+      success = false;
+    }
+    const double *a = filter_getIirACoefficientArray(i);
+    const double *b = filter_getIirBCoefficientArray(i);
+    for (uint16_t j = 0; j < filter_getIirACoefficientCount(); j++) {
+      worstIirError = fmax(worstIirError, filterTest_relativeError(
+                                              tables.iirA[i][j], a[j], a[j]));
+    }
+    // The B taps are scaled by b[0]: half of them are zero.
+    for (uint16_t j = 0; j < filter_getIirBCoefficientCount(); j++) {
+      worstIirError = fmax(worstIirError, filterTest_relativeError(
+                                              tables.iirB[i][j], b[j], b[0]));
+    }
+  }
+  if (worstFirError > FILTER_DESIGN_FIR_TOLERANCE ||
+      worstIirError > FILTER_DESIGN_IIR_TOLERANCE) {
+    printf("Designed tables differ from filter.c: FIR by %le, IIR by %le.\n",
+           worstFirError, worstIirError);
+    success = false;
+  }
+  if (!filterDesign_check(&plan, &tables, true))
+    success = false;
+  if (printMessageFlag)
+    printf("Designed tables match filter.c: FIR within %le, IIR within %le.\n",
+           worstFirError, worstIirError);
+  if (success)
+    printf("Designed filter tables match filter.c and meet the specs.\n");
+  printf("+++++ Exiting filterTest_runFilterDesignTest() +++++\n");
+  return success;
+}
+
 // Copies powerValues to currentPowerValues, the same array
 // that is used to hold the values after power has been computed
 // by filter_computePower().
@@ -973,13 +3068,47 @@ bool filterTest_runPowerTest(void) {
 // 3. Test alignment of the IIR A and B coefficients.
 // 4. Plots the frequency response of the FIR filter on the TFT display.
 // 5. Plots the frequency response of each of the IIR bandpass filters on the
-// TFT display. Returns true if all tests passed, false otherwise. Various
-// informational prints are provided in the console during the run of the test.
+// TFT display.
+// 6. Checks the block FIR against filter_firFilter() bit for bit.
+// 7. Checks filter_processBlock() against the per-sample API bit for bit.
+// 8. Checks the IIR bank against the individual IIR filters.
+// 9. Checks the interleaved IIR engine against the direct form and reports
+// the throughput of both, the cost of 10, 16 and 32 channels, and the cost of
+// decaying inputs without and with the denormal guard.
+// 10. Compares Goertzel, sliding-DFT and channelizer hit decisions against the
+// IIR filters.
+// 11. Compares block-sum and exponential power hit decisions against the
+// boxcar power.
+// 12. Compares hit decisions with and without the energy gate and reports
+// how long the gate idles the IIR filters.
+// 13. Checks that filter state snapshots restore exactly and warm-start the
+// filters.
+// 14. Checks that diversity combining of several sensors hits where one
+// sensor does not.
+// 15. Compares the CIC front end against the FIR front end and plots its
+// frequency response on the TFT display.
+// 16. Checks that the noise floors let the SNR hit test ignore the ambient
+// light and hit a shot indoors and outdoors.
+// 17. Compares the biquad IIR engine against the direct form.
+// 18. Compares the fixed-point filter chain against the double chain.
+// 19. Compares the single-precision filter chain against the double chain.
+// 20. Checks the arena layout of the filter state.
+// 21. Checks that filterDesign.c reproduces the coefficient tables and that
+// they meet the passband and stopband specs.
+// With FILTER_REDUCED_PRECISION only test 21 runs, after a check that the
+// fixed-point or single-precision chain picks every user frequency.
+// Returns true if all tests passed, false otherwise. Various informational
+// prints are provided in the console during the run of the test.
 bool filter_runTest(void) {
   printf("******** filterTest_runTest() **********\n");
   bool success = true; // Be optimistic.
   filter_init();       // Always must init stuff.
   filterTest_init();   // More init stuff.
+#ifdef FILTER_REDUCED_PRECISION
+  // The tests below check the double arithmetic through the filter queues,
+  // which this chain does not keep. Check the chain through the API instead.
+  success &= filterTest_runReducedPrecisionChainTest(PRINT_INFO_MESSAGES);
+#else
   // Confirm that the FIR coefficients are properly aligned with the incoming
   // data.
   success &= filterTest_runFirAlignmentTest(PRINT_INFO_MESSAGES);
@@ -995,6 +3124,53 @@ bool filter_runTest(void) {
                                              PRINT_INFO_MESSAGES);
   // Verifies correct functionality of the power computation.
   success &= filterTest_runPowerTest();
+  // Verifies that the incremental power does not drift.
+  success &= filterTest_runPowerDriftTest(PRINT_INFO_MESSAGES);
+  // Verifies that the block FIR matches the sample-at-a-time FIR exactly.
+  success &= filterTest_runFirBlockTest(PRINT_INFO_MESSAGES);
+  // Verifies that filter_processBlock() matches the per-sample API exactly.
+  success &= filterTest_runProcessBlockTest(PRINT_INFO_MESSAGES);
+  // Verifies that the IIR bank matches the individual IIR filters.
+  success &= filterTest_runIirBankTest(PRINT_INFO_MESSAGES);
+  // Verifies that the interleaved engine matches the direct form exactly.
+  success &= filterTest_runInterleavedEngineTest(PRINT_INFO_MESSAGES);
+  // Reports IIR bank throughput for the direct-form and interleaved engines.
+  filterTest_runIirBenchmark();
+  // Reports the IIR bank cost on decaying inputs with and without flushing
+  // subnormals to zero.
+  filterTest_runDenormalBenchmark();
+  // Reports the cost of 10, 16 and 32 channels with each power measurement.
+  filterTest_runChannelCountBenchmark();
+  // Verifies that the Goertzel and sliding-DFT engines make the same hit
+  // decisions as the IIR filters.
+  success &= filterTest_runDftEngineTest(PRINT_INFO_MESSAGES);
+  // Verifies that the constant-memory power estimators make the same hit
+  // decisions as the boxcar power.
+  success &= filterTest_runPowerEstimatorTest(PRINT_INFO_MESSAGES);
+  // Verifies that the energy gate makes the same hit decisions as the full
+  // filter chain.
+  success &= filterTest_runEnergyGateTest(PRINT_INFO_MESSAGES);
+  // Verifies that state snapshots restore exactly and warm-start the filters.
+  success &= filterTest_runStateTest(PRINT_INFO_MESSAGES);
+  // Verifies that diversity combining finds a shot one sensor misses.
+  success &= filterTest_runDiversityTest(PRINT_INFO_MESSAGES);
+  // Verifies that the CIC front end passes the player frequencies like the
+  // FIR filter.
+  success &= filterTest_runCicFrontEndTest(PRINT_INFO_MESSAGES);
+  // Verifies that the SNR hit test adapts to the ambient light per channel.
+  success &= filterTest_runNoiseFloorTest(PRINT_INFO_MESSAGES);
+  // Verifies that the single-precision biquad engine tracks the direct form.
+  success &= filterTest_runBiquadEngineTest(PRINT_INFO_MESSAGES);
+  // Verifies that the integer filter chain tracks the double-precision chain.
+  success &= filterTest_runFixedPointAccuracyTest(PRINT_INFO_MESSAGES);
+  // Verifies that the float filter chain tracks the double-precision chain.
+  success &= filterTest_runSinglePrecisionAccuracyTest(PRINT_INFO_MESSAGES);
+  // Verifies the arena layout of the filter state.
+  success &= filterTest_runQueueLayoutTest(PRINT_INFO_MESSAGES);
+#endif
+  // Verifies that the coefficient designer reproduces the filter tables.
+  success &= filterTest_runFilterDesignTest(PRINT_INFO_MESSAGES);
+#ifndef FILTER_REDUCED_PRECISION // The plots read the filter queues.
   // Plots the frequency response of the FIR filter against all user and other
   // test frequencies. All frequencies are expressed as a square wave.
   filterTest_runSquareWaveFirPowerTest(PRINT_INFO_MESSAGES, PLOT_INPUT);
@@ -1005,6 +3181,7 @@ bool filter_runTest(void) {
         i, true);               // This plots the individual filter response.
     utils_msDelay(TWO_SECONDS); // Leave on the display for a few seconds.
   }
+#endif
   return success;
 }
 
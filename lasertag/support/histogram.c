@@ -17,8 +17,12 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "histogram.h"
 #include "utils.h"
 
+#if FILTER_FREQUENCY_COUNT > HISTOGRAM_MAX_BAR_COUNT
+#error "HISTOGRAM_MAX_BAR_COUNT must allow one bar per player frequency."
+#endif
+
 #define TOP_LABEL_TEXT_SIZE 1
-#define HISTOGRAM_DEFAULT_BAR_COUNT 10
+#define HISTOGRAM_DEFAULT_BAR_COUNT FILTER_FREQUENCY_COUNT
 static uint16_t histogram_barCount = HISTOGRAM_DEFAULT_BAR_COUNT;
 static uint16_t
     histogram_barWidth; // May share this with other functions in this package.
@@ -50,7 +54,11 @@ const static uint16_t histogram_defaultBarColors[HISTOGRAM_MAX_BAR_COUNT] = {
     DISPLAY_GREEN,   DISPLAY_CYAN,   DISPLAY_MAGENTA, DISPLAY_YELLOW,
     DISPLAY_WHITE,   DISPLAY_BLUE,   DISPLAY_RED,     DISPLAY_GREEN,
     DISPLAY_BLUE,    DISPLAY_RED,    DISPLAY_GREEN,   DISPLAY_CYAN,
-    DISPLAY_MAGENTA};
+    DISPLAY_MAGENTA, DISPLAY_YELLOW, DISPLAY_WHITE,   DISPLAY_BLUE,
+    DISPLAY_RED,     DISPLAY_GREEN,  DISPLAY_BLUE,    DISPLAY_RED,
+    DISPLAY_GREEN,   DISPLAY_CYAN,   DISPLAY_MAGENTA, DISPLAY_YELLOW,
+    DISPLAY_WHITE,   DISPLAY_BLUE,   DISPLAY_RED,     DISPLAY_GREEN,
+    DISPLAY_BLUE,    DISPLAY_RED,    DISPLAY_GREEN};
 static uint16_t histogram_barColors[HISTOGRAM_MAX_BAR_COUNT];
 // Default colors for the white dynamic labels.
 const static uint16_t
@@ -61,7 +69,12 @@ const static uint16_t
         DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
         DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
         DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
-        DISPLAY_WHITE};
+        DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
+        DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
+        DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
+        DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
+        DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
+        DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE};
 static uint16_t histogram_barTopLabelColors[HISTOGRAM_MAX_BAR_COUNT];
 // Default labels for the histogram bars.
 // These labels do not change during operation.
@@ -71,7 +84,12 @@ const static char histogram_defaultLabel[HISTOGRAM_MAX_BAR_COUNT]
                                             {"5"}, {"6"}, {"7"}, {"8"}, {"9"},
                                             {"A"}, {"B"}, {"C"}, {"D"}, {"E"},
                                             {"F"}, {"G"}, {"H"}, {"I"}, {"J"},
-                                            {"K"}, {"L"}, {"M"}, {"N"}, {"O"}};
+                                            {"K"}, {"L"}, {"M"}, {"N"}, {"O"},
+                                            {"P"}, {"Q"}, {"R"}, {"S"}, {"T"},
+                                            {"U"}, {"V"}, {"W"}, {"X"}, {"Y"},
+                                            {"Z"}, {"a"}, {"b"}, {"c"}, {"d"},
+                                            {"e"}, {"f"}, {"g"}, {"h"}, {"i"},
+                                            {"j"}, {"k"}, {"l"}};
 static char histogram_label[HISTOGRAM_MAX_BAR_COUNT]
                            [HISTOGRAM_MAX_BAR_LABEL_WIDTH];
 
@@ -426,7 +444,7 @@ void histogram_computeNormalizedHitValues(double normalizedHitValues[],
     normalizedHitValues[i] = (double)hitArray[i] / maxHitValue;
 }
 
-// Used to plot hits for frequencies 0-9.
+// Used to plot hits for every player frequency (FILTER_FREQUENCY_COUNT bars).
 void histogram_plotUserHits(uint16_t hitCounts[]) {
   double normalizedHitValues[FILTER_FREQUENCY_COUNT]; // Store normalized values
                                                       // here for the histogram.
@@ -43,7 +43,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 //#define HISTOGRAM_MAX_BAR_COUNT 10		// You can have up to 10 bars on
 // your histogram.
 #define HISTOGRAM_MAX_BAR_COUNT                                                \
-  25 // You can have up to 25 bars on your histogram.
+  48 // Enough for 32 player frequencies plus the filter-test frequencies.
 ///#define HISTOGRAM_BAR_COUNT 10				// This is the
 /// number of histogram bars that you want.
 //#define HISTOGRAM_BAR_X_GAP 5					// This is the
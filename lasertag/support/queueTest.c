@@ -10,7 +10,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "cycleCounter.h"
 #include "queue.h"
+#include "typedQueue.h"
 
 #define SMALL_QUEUE_SIZE 1000
 #define SMALL_QUEUE_COUNT 10
@@ -401,10 +403,23 @@ static bool queue_pushPopTest(void) {
   return testResult;
 }
 
+// Prints the error log with queue_printErrors(), which should hold exactly the
+// one error of the given kind that q has recorded. Returns false (and says why)
+// otherwise.
+static bool queue_printExpectedError(queue_t *q, queue_error_t kind) {
+  uint32_t printCount = queue_printErrors();
+  if (printCount != 1 || queue_errorCount(q, kind) != 1) {
+    printf("* Error: %u errors logged and %u counted by %s, should be 1.\n",
+           printCount, queue_errorCount(q, kind), queue_name(q));
+    return false;
+  }
+  return true;
+}
+
 #define ERROR_CONDITION_Q_SIZE 10
 #define ERROR_CONDITION_Q_NAME "errorQ"
 // Checks to see that underflow and overflow work, and that error messages are
-// printed.
+// logged and printed.
 bool queue_testErrorConditions(void) {
   bool tempResult = true; // Local test results.
   bool testResult = true; // Overall test results.
@@ -422,6 +437,9 @@ bool queue_testErrorConditions(void) {
   printf("=== + User code should print a queue empty error message-> ");
   // Check for underflow by popping an empty queue.
   queue_pop(&testQ);
+  testResult = queue_printExpectedError(&testQ, queue_underflowError_e)
+                   ? testResult
+                   : false;
   tempResult = queue_underflow(&testQ);
   if (!tempResult) {
     printf("* Error: queue_underflow(%s) returned false, should be true.\n",
@@ -433,6 +451,9 @@ bool queue_testErrorConditions(void) {
   for (uint16_t i = 0; i < ERROR_CONDITION_Q_SIZE + 1; i++) {
     queue_push(&testQ, 0.0);
   }
+  testResult = queue_printExpectedError(&testQ, queue_overflowError_e)
+                   ? testResult
+                   : false;
   // Check for overflow should be true.
   tempResult = queue_overflow(&testQ);
   if (!tempResult) {
@@ -527,6 +548,552 @@ bool queue_overwritePushTest(void) {
   return testResult;
 }
 
+#define FAST_ACCESSOR_TEST_OP_COUNT 20000
+#define FAST_ACCESSOR_TEST_MAX_SIZE 100
+#define FAST_ACCESSOR_TEST_NAME "fastQ"
+// Runs the same random pushes, pops and overwrite pushes through the checked
+// functions on one queue and through the fast accessors on another, each with
+// a capacity that is not a power of two. Checks that the element counts and
+// every element read with queue_readElementAt() and queue_fastReadElementAt()
+// agree after each operation. The fast accessors are only called where the
+// checked function would not fail.
+static bool queue_fastAccessorTest(void) {
+  bool success = true;
+  queue_size_t size = 3 + rand() % (FAST_ACCESSOR_TEST_MAX_SIZE - 3);
+  if ((size & (size - 1)) == 0)
+    size++; // Not a power of two.
+  queue_t checkedQ, fastQ;
+  queue_init(&checkedQ, size, FAST_ACCESSOR_TEST_NAME);
+  queue_init(&fastQ, size, FAST_ACCESSOR_TEST_NAME);
+  if (queue_size(&fastQ) != size || fastQ.mask + 1 < size ||
+      (fastQ.mask & (fastQ.mask + 1)) != 0) {
+    printf("Capacity %u got a mask of %u.\n", size, fastQ.mask);
+    success = false;
+  }
+  for (uint32_t op = 0; success && op < FAST_ACCESSOR_TEST_OP_COUNT; op++) {
+    queue_data_t value = (queue_data_t)rand();
+    switch (rand() % 3) {
+    case 0:
+      if (!queue_full(&checkedQ)) {
+        queue_push(&checkedQ, value);
+        queue_fastPush(&fastQ, value);
+      }
+      break;
+    case 1:
+      if (!queue_empty(&checkedQ) &&
+          queue_pop(&checkedQ) != queue_fastPop(&fastQ)) {
+        printf("queue_fastPop() returned a different value.\n");
+        success = false;
+      }
+      break;
+    default:
+      queue_overwritePush(&checkedQ, value);
+      queue_fastOverwritePush(&fastQ, value);
+      break;
+    }
+    queue_size_t count = queue_elementCount(&checkedQ);
+    if (queue_elementCount(&fastQ) != count) {
+      printf("After %u operations the fast queue holds %u elements, the "
+             "checked queue %u.\n",
+             op + 1, queue_elementCount(&fastQ), count);
+      success = false;
+      break;
+    }
+    for (queue_index_t i = 0; i < count; i++) {
+      if (queue_readElementAt(&checkedQ, i) !=
+          queue_fastReadElementAt(&fastQ, i)) {
+        printf("After %u operations element %u differs.\n", op + 1, i);
+        success = false;
+        break;
+      }
+    }
+    if (count > 0 && queue_fastReadNewest(&fastQ) !=
+                         queue_readElementAt(&checkedQ, count - 1)) {
+      printf("queue_fastReadNewest() is not the newest element.\n");
+      success = false;
+    }
+  }
+  queue_garbageCollect(&checkedQ);
+  queue_garbageCollect(&fastQ);
+  return success;
+}
+
+#define MIRRORED_TEST_OP_COUNT 5000
+#define MIRRORED_TEST_MAX_SIZE 100
+#define MIRRORED_TEST_NAME "mirroredQ"
+#define MIRRORED_TEST_PLAIN_NAME "plainQ"
+// Capacities tested: the smallest, a power of two, one more than that (the
+// most storage left over), and a random one.
+#define MIRRORED_TEST_SIZE_COUNT 4
+// Runs the same random pushes, pops and overwrite pushes (checked and fast)
+// through a plain queue and a mirrored one of the given capacity on storage.
+// After each operation, every window from queue_window() and
+// queue_fastWindow() must hold the newest elements of the plain queue, in
+// order.
+static bool queue_mirroredTestSize(queue_data_t *storage, queue_size_t size) {
+  bool success = true;
+  queue_t plainQ, mirroredQ;
+  queue_init(&plainQ, size, MIRRORED_TEST_PLAIN_NAME);
+  queue_initMirroredWithStorage(&mirroredQ, storage, size, MIRRORED_TEST_NAME);
+  for (uint32_t op = 0; success && op < MIRRORED_TEST_OP_COUNT; op++) {
+    queue_data_t value = (queue_data_t)rand();
+    switch (rand() % 4) {
+    case 0:
+      if (!queue_full(&plainQ)) {
+        queue_push(&plainQ, value);
+        queue_push(&mirroredQ, value);
+      }
+      break;
+    case 1:
+      if (!queue_empty(&plainQ)) {
+        queue_pop(&plainQ);
+        queue_fastPop(&mirroredQ);
+      }
+      break;
+    case 2:
+      queue_overwritePush(&plainQ, value);
+      queue_overwritePush(&mirroredQ, value);
+      break;
+    default:
+      queue_overwritePush(&plainQ, value);
+      queue_fastOverwritePush(&mirroredQ, value);
+      break;
+    }
+    queue_size_t count = queue_elementCount(&plainQ);
+    for (queue_size_t n = 0; n <= count && success; n++) {
+      const queue_data_t *window = queue_window(&mirroredQ, n);
+      if (window != queue_fastWindow(&mirroredQ, n)) {
+        printf("queue_window() and queue_fastWindow() disagree.\n");
+        success = false;
+        break;
+      }
+      for (queue_index_t i = 0; i < n; i++) {
+        if (window[i] != queue_readElementAt(&plainQ, (count - n) + i)) {
+          printf("After %u operations, element %u of the newest %u differs "
+                 "(capacity %u).\n",
+                 op + 1, i, n, size);
+          success = false;
+          break;
+        }
+      }
+    }
+  }
+  queue_garbageCollect(&plainQ);
+  queue_garbageCollect(&mirroredQ); // Must leave the storage alone.
+  return success;
+}
+
+// Runs queue_mirroredTestSize() for each test capacity, then checks that
+// queue_window() refuses a plain queue and a window larger than the queue.
+static bool queue_mirroredTest(void) {
+  static queue_data_t storage[QUEUE_MIRRORED_STORAGE_SIZE(
+      MIRRORED_TEST_MAX_SIZE)];
+  const queue_size_t sizes[MIRRORED_TEST_SIZE_COUNT] = {
+      1, 64, 65, 1 + rand() % MIRRORED_TEST_MAX_SIZE};
+  bool success = true;
+  for (uint16_t s = 0; s < MIRRORED_TEST_SIZE_COUNT && success; s++) {
+    success = queue_mirroredTestSize(storage, sizes[s]);
+  }
+  queue_t plainQ, mirroredQ;
+  queue_init(&plainQ, MIRRORED_TEST_MAX_SIZE, MIRRORED_TEST_PLAIN_NAME);
+  queue_initMirrored(&mirroredQ, MIRRORED_TEST_MAX_SIZE, MIRRORED_TEST_NAME);
+  printf("=== + User code should print a not-mirrored error message-> ");
+  if (queue_window(&plainQ, 0) != NULL) {
+    printf("queue_window() accepted a plain queue.\n");
+    success = false;
+  }
+  success = queue_printExpectedError(&plainQ, queue_notMirroredError_e) &&
+            success;
+  printf("=== + User code should print an out-of-bounds error message-> ");
+  if (queue_window(&mirroredQ, 1) != NULL) {
+    printf("queue_window() accepted a window larger than the queue.\n");
+    success = false;
+  }
+  success = queue_printExpectedError(&mirroredQ, queue_outOfBoundsError_e) &&
+            success;
+  queue_garbageCollect(&plainQ);
+  queue_garbageCollect(&mirroredQ);
+  return success;
+}
+
+#define BULK_TEST_OP_COUNT 5000
+#define BULK_TEST_MAX_SIZE 100
+#define BULK_TEST_NAME "bulkQ"
+#define BULK_TEST_SCALAR_NAME "scalarQ"
+// Returns true if bulkQ holds the same elements as scalarQ, read through
+// queue_span() and queue_readElementAt(), and has the same flags. A mirrored
+// queue must need only one piece.
+static bool queue_bulkMatches(queue_t *bulkQ, queue_t *scalarQ) {
+  queue_size_t count = queue_elementCount(scalarQ);
+  queue_span_t span = queue_span(bulkQ);
+  if (queue_elementCount(bulkQ) != count ||
+      span.firstCount + span.secondCount != count ||
+      (bulkQ->mirrorOffset != 0 && span.secondCount != 0) ||
+      queue_overflow(bulkQ) != queue_overflow(scalarQ) ||
+      queue_underflow(bulkQ) != queue_underflow(scalarQ))
+    return false;
+  for (queue_index_t i = 0; i < count; i++) {
+    queue_data_t expected = queue_readElementAt(scalarQ, i);
+    queue_data_t spanValue = (i < span.firstCount)
+                                 ? span.first[i]
+                                 : span.second[i - span.firstCount];
+    if (spanValue != expected || queue_readElementAt(bulkQ, i) != expected)
+      return false;
+  }
+  return true;
+}
+
+// Runs the same random operations through bulkQ with queue_pushMany(),
+// queue_popMany() and queue_fill(), and through scalarQ with the scalar
+// functions they stand for, then checks queue_bulkMatches() after each one.
+// Counts stay within what fits, so no error messages are printed.
+static bool queue_bulkTestQueue(queue_t *bulkQ, queue_t *scalarQ) {
+  queue_data_t values[BULK_TEST_MAX_SIZE];
+  queue_data_t popped[BULK_TEST_MAX_SIZE];
+  queue_size_t size = queue_size(scalarQ);
+  for (uint32_t op = 0; op < BULK_TEST_OP_COUNT; op++) {
+    queue_size_t count;
+    switch (rand() % 4) {
+    case 0: // Push as many as fit, or fewer.
+      count = rand() % (size - queue_elementCount(scalarQ) + 1);
+      for (queue_index_t i = 0; i < count; i++) {
+        values[i] = (queue_data_t)rand();
+        queue_push(scalarQ, values[i]);
+      }
+      if (queue_pushMany(bulkQ, values, count) != count) {
+        printf("queue_pushMany() did not push %u values.\n", count);
+        return false;
+      }
+      break;
+    case 1: // Pop some elements, and check their values.
+      count = rand() % (queue_elementCount(scalarQ) + 1);
+      if (queue_popMany(bulkQ, popped, count) != count) {
+        printf("queue_popMany() did not pop %u elements.\n", count);
+        return false;
+      }
+      for (queue_index_t i = 0; i < count; i++) {
+        if (popped[i] != queue_pop(scalarQ)) {
+          printf("queue_popMany() popped element %u of %u wrong.\n", i,
+                 count);
+          return false;
+        }
+      }
+      break;
+    case 2: // Drop some elements.
+      count = rand() % (queue_elementCount(scalarQ) + 1);
+      queue_popMany(bulkQ, NULL, count);
+      for (queue_index_t i = 0; i < count; i++) {
+        queue_pop(scalarQ);
+      }
+      break;
+    default: // Fill with one value.
+      values[0] = (queue_data_t)rand();
+      queue_fill(bulkQ, values[0]);
+      for (queue_index_t i = 0; i < size; i++) {
+        queue_overwritePush(scalarQ, values[0]);
+      }
+      break;
+    }
+    if (!queue_bulkMatches(bulkQ, scalarQ)) {
+      printf("After %u operations, %s does not match %s (capacity %u).\n",
+             op + 1, queue_name(bulkQ), queue_name(scalarQ), size);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks that queue_pushMany() pushes only what fits and that queue_popMany()
+// pops only what there is, each logging one error and setting the flag that
+// the scalar functions would.
+static bool queue_bulkErrorTest(void) {
+  queue_data_t values[BULK_TEST_MAX_SIZE + 2];
+  queue_data_t popped[BULK_TEST_MAX_SIZE + 2];
+  for (queue_index_t i = 0; i < BULK_TEST_MAX_SIZE + 2; i++) {
+    values[i] = (queue_data_t)rand();
+  }
+  bool success = true;
+  queue_t q;
+  queue_init(&q, BULK_TEST_MAX_SIZE, BULK_TEST_NAME);
+  printf("=== + User code should print a queue full error message-> ");
+  if (queue_pushMany(&q, values, BULK_TEST_MAX_SIZE + 2) !=
+          BULK_TEST_MAX_SIZE ||
+      !queue_overflow(&q) || queue_underflow(&q)) {
+    printf("queue_pushMany() did not stop at a full queue.\n");
+    success = false;
+  }
+  success = queue_printExpectedError(&q, queue_overflowError_e) && success;
+  printf("=== + User code should print a queue empty error message-> ");
+  if (queue_popMany(&q, popped, BULK_TEST_MAX_SIZE + 2) !=
+          BULK_TEST_MAX_SIZE ||
+      queue_overflow(&q) || !queue_underflow(&q)) {
+    printf("queue_popMany() did not stop at an empty queue.\n");
+    success = false;
+  }
+  success = queue_printExpectedError(&q, queue_underflowError_e) && success;
+  for (queue_index_t i = 0; success && i < BULK_TEST_MAX_SIZE; i++) {
+    if (popped[i] != values[i]) {
+      printf("queue_popMany() popped element %u wrong after an overflow.\n",
+             i);
+      success = false;
+    }
+  }
+  queue_garbageCollect(&q);
+  return success;
+}
+
+// Runs queue_bulkTestQueue() on a plain and a mirrored queue of each capacity
+// in queue_mirroredTest(), then queue_bulkErrorTest().
+static bool queue_bulkTest(void) {
+  const queue_size_t sizes[MIRRORED_TEST_SIZE_COUNT] = {
+      1, 64, 65, 1 + rand() % BULK_TEST_MAX_SIZE};
+  bool success = true;
+  for (uint16_t s = 0; s < MIRRORED_TEST_SIZE_COUNT && success; s++) {
+    for (uint16_t mirrored = 0; mirrored < 2 && success; mirrored++) {
+      queue_t bulkQ, scalarQ;
+      if (mirrored)
+        queue_initMirrored(&bulkQ, sizes[s], BULK_TEST_NAME);
+      else
+        queue_init(&bulkQ, sizes[s], BULK_TEST_NAME);
+      queue_init(&scalarQ, sizes[s], BULK_TEST_SCALAR_NAME);
+      success = queue_bulkTestQueue(&bulkQ, &scalarQ);
+      queue_garbageCollect(&bulkQ);
+      queue_garbageCollect(&scalarQ);
+    }
+  }
+  return queue_bulkErrorTest() && success;
+}
+
+#define TYPED_TEST_OP_COUNT 20000
+#define TYPED_TEST_MAX_SIZE 1000
+#define TYPED_TEST_NAME "referenceQ"
+TYPED_QUEUE_DEFINE(int16Queue, int16_t)
+TYPED_QUEUE_DEFINE(floatQueue, float)
+TYPED_QUEUE_DEFINE(doubleQueue, double)
+// Runs the same random overwrite pushes and pops through queue_t and through
+// int16_t, float and double typed queues on static storage, with a capacity
+// that is not a power of two. The values fit in 16 bits, so every queue must
+// hold exactly the same elements after each operation. Then checks that popping
+// and reading past the end return 0, and that name_push() fills the queue and
+// then refuses new elements without changing it.
+static bool queue_typedTest(void) {
+  static int16_t int16Storage[QUEUE_STORAGE_SIZE(TYPED_TEST_MAX_SIZE)];
+  static float floatStorage[QUEUE_STORAGE_SIZE(TYPED_TEST_MAX_SIZE)];
+  static double doubleStorage[QUEUE_STORAGE_SIZE(TYPED_TEST_MAX_SIZE)];
+  queue_size_t size = 1 + rand() % TYPED_TEST_MAX_SIZE;
+  queue_t referenceQ;
+  int16Queue_t int16Q;
+  floatQueue_t floatQ;
+  doubleQueue_t doubleQ;
+  queue_init(&referenceQ, size, TYPED_TEST_NAME);
+  int16Queue_init(&int16Q, int16Storage, size);
+  floatQueue_init(&floatQ, floatStorage, size);
+  doubleQueue_init(&doubleQ, doubleStorage, size);
+  bool success = true;
+  for (uint32_t op = 0; success && op < TYPED_TEST_OP_COUNT; op++) {
+    if (rand() % 2 == 0 || queue_empty(&referenceQ)) {
+      int16_t value = (int16_t)(rand() % 65536 - 32768);
+      queue_overwritePush(&referenceQ, value);
+      int16Queue_overwritePush(&int16Q, value);
+      floatQueue_overwritePush(&floatQ, value);
+      doubleQueue_overwritePush(&doubleQ, value);
+    } else {
+      queue_data_t value = queue_pop(&referenceQ);
+      if (int16Queue_pop(&int16Q) != value ||
+          floatQueue_pop(&floatQ) != value ||
+          doubleQueue_pop(&doubleQ) != value) {
+        printf("After %u operations, a typed queue popped the wrong value.\n",
+               op + 1);
+        success = false;
+      }
+    }
+    queue_size_t count = queue_elementCount(&referenceQ);
+    if (int16Queue_elementCount(&int16Q) != count ||
+        floatQueue_elementCount(&floatQ) != count ||
+        doubleQueue_elementCount(&doubleQ) != count ||
+        int16Queue_full(&int16Q) != queue_full(&referenceQ) ||
+        int16Queue_empty(&int16Q) != queue_empty(&referenceQ)) {
+      printf("After %u operations, a typed queue holds %u elements, "
+             "should be %u.\n",
+             op + 1, int16Queue_elementCount(&int16Q), count);
+      success = false;
+    }
+    for (queue_index_t i = 0; success && i < count; i++) {
+      queue_data_t value = queue_readElementAt(&referenceQ, i);
+      if (int16Queue_readElementAt(&int16Q, i) != value ||
+          floatQueue_readElementAt(&floatQ, i) != value ||
+          doubleQueue_readElementAt(&doubleQ, i) != value) {
+        printf("After %u operations, element %u of a typed queue differs "
+               "(capacity %u).\n",
+               op + 1, i, size);
+        success = false;
+      }
+    }
+  }
+  while (!int16Queue_empty(&int16Q)) {
+    int16Queue_pop(&int16Q);
+  }
+  if (int16Queue_pop(&int16Q) != 0 ||
+      int16Queue_readElementAt(&int16Q, 0) != 0) {
+    printf("An empty typed queue did not return 0.\n");
+    success = false;
+  }
+  for (queue_size_t i = 0; i < size; i++) {
+    if (!int16Queue_push(&int16Q, (int16_t)i)) {
+      printf("A typed queue refused push %u of %u.\n", i + 1, size);
+      success = false;
+    }
+  }
+  if (int16Queue_push(&int16Q, -1) ||
+      int16Queue_elementCount(&int16Q) != size ||
+      int16Queue_readElementAt(&int16Q, 0) != 0 ||
+      int16Queue_readElementAt(&int16Q, size - 1) != (int16_t)(size - 1)) {
+    printf("A push to a full typed queue changed it.\n");
+    success = false;
+  }
+  queue_garbageCollect(&referenceQ);
+  return success;
+}
+
+#define ERROR_LOG_TEST_EXTRA_COUNT 3
+#define ERROR_LOG_TEST_NAME "logQ"
+// Pops an empty queue until the error log overflows, checks the counter of the
+// queue and that queue_printErrors() prints the newest QUEUE_ERROR_LOG_SIZE
+// errors and then nothing, and prints what recording an error costs.
+static bool queue_errorLogTest(void) {
+  bool success = true;
+  queue_t q;
+  queue_init(&q, 1, ERROR_LOG_TEST_NAME);
+  queue_printErrors(); // Start from an empty log.
+  uint32_t errorCount = QUEUE_ERROR_LOG_SIZE + ERROR_LOG_TEST_EXTRA_COUNT;
+  uint64_t start = cycleCounter_read();
+  for (uint32_t i = 0; i < errorCount; i++) {
+    queue_pop(&q);
+  }
+  uint64_t elapsed = cycleCounter_read() - start;
+  if (queue_errorCount(&q, queue_underflowError_e) != errorCount) {
+    printf("* Error: %s counted %u underflows, should be %u.\n",
+           queue_name(&q), queue_errorCount(&q, queue_underflowError_e),
+           errorCount);
+    success = false;
+  }
+  printf("=== + User code should print %d queue empty errors, then %d "
+         "dropped->\n",
+         QUEUE_ERROR_LOG_SIZE, ERROR_LOG_TEST_EXTRA_COUNT);
+  if (queue_printErrors() != QUEUE_ERROR_LOG_SIZE ||
+      queue_printErrors() != 0) {
+    printf("* Error: queue_printErrors() did not drain %d errors.\n",
+           QUEUE_ERROR_LOG_SIZE);
+    success = false;
+  }
+  printf("=== Queue: recording an error takes %.1f counts.\n",
+         (double)elapsed / errorCount);
+  queue_garbageCollect(&q);
+  return success;
+}
+
+// Capacity of the benchmark queue, as deep as the filter output queues, and the
+// number of each operation timed.
+#define QUEUE_BENCHMARK_SIZE 2000
+#define QUEUE_BENCHMARK_OP_COUNT 1000000
+#define QUEUE_BENCHMARK_NAME "benchmarkQ"
+
+// queue_push(), queue_pop() and queue_readElementAt() as queue.c had them,
+// wrapping with a divide by the capacity, as the baseline for
+// queue_runBenchmark(). Kept out of line like calls into queue.c.
+static __attribute__((noinline)) void moduloPush(queue_t *q,
+                                                 queue_data_t value) {
+  if (q->elementCount < q->size) {
+    q->data[q->indexIn] = value;
+    q->indexIn = (q->indexIn + 1) % q->size;
+    q->elementCount++;
+    q->underflowFlag = false;
+  } else {
+    q->overflowFlag = true;
+    printf("Error: the queue is full.\n");
+  }
+}
+
+static __attribute__((noinline)) queue_data_t moduloPop(queue_t *q) {
+  if (q->elementCount > 0) {
+    queue_data_t value = q->data[q->indexOut];
+    q->indexOut = (q->indexOut + 1) % q->size;
+    q->elementCount--;
+    q->overflowFlag = false;
+    return value;
+  }
+  q->underflowFlag = true;
+  printf("Error: the queue is empty.\n");
+  return 0;
+}
+
+static __attribute__((noinline)) queue_data_t
+moduloReadElementAt(queue_t *q, queue_index_t index) {
+  if (index < q->elementCount)
+    return q->data[(q->indexOut + index) % q->size];
+  printf("Error: Index %d is out of bounds\n", index);
+  return 0;
+}
+
+// Prints the cycleCounter counts per push, pop and readElementAt on a
+// QUEUE_BENCHMARK_SIZE queue with divide indexing (queue.c before masks), the
+// checked functions and the fast accessors. Each push pass fills the queue,
+// each pop pass empties it and each read pass reads every element of the full
+// queue, in a rolling order like the FIR filter.
+static void queue_runBenchmark(void) {
+  const char *names[] = {"divide", "checked", "fast"};
+  queue_t q;
+  queue_init(&q, QUEUE_BENCHMARK_SIZE, QUEUE_BENCHMARK_NAME);
+  volatile queue_data_t sink = 0;
+  for (uint16_t v = 0; v < 3; v++) {
+    uint64_t pushCycles = 0, popCycles = 0, readCycles = 0;
+    queue_data_t sum = 0;
+    for (uint32_t pass = 0;
+         pass < QUEUE_BENCHMARK_OP_COUNT / QUEUE_BENCHMARK_SIZE; pass++) {
+      q.indexOut = pass % QUEUE_BENCHMARK_SIZE; // Start anywhere in the ring.
+      q.indexIn = q.indexOut;
+      uint64_t start = cycleCounter_read();
+      for (uint32_t i = 0; i < QUEUE_BENCHMARK_SIZE; i++) {
+        if (v == 0)
+          moduloPush(&q, i);
+        else if (v == 1)
+          queue_push(&q, i);
+        else
+          queue_fastPush(&q, i);
+      }
+      uint64_t middle = cycleCounter_read();
+      for (uint32_t i = 0; i < QUEUE_BENCHMARK_SIZE; i++) {
+        if (v == 0)
+          sum += moduloReadElementAt(&q, i);
+        else if (v == 1)
+          sum += queue_readElementAt(&q, i);
+        else
+          sum += queue_fastReadElementAt(&q, i);
+      }
+      uint64_t end = cycleCounter_read();
+      for (uint32_t i = 0; i < QUEUE_BENCHMARK_SIZE; i++) {
+        if (v == 0)
+          sum += moduloPop(&q);
+        else if (v == 1)
+          sum += queue_pop(&q);
+        else
+          sum += queue_fastPop(&q);
+      }
+      popCycles += cycleCounter_read() - end;
+      pushCycles += middle - start;
+      readCycles += end - middle;
+    }
+    sink = sum;
+    printf("%s: %.2lf counts per push, %.2lf per pop, %.2lf per "
+           "readElementAt.\n",
+           names[v], (double)pushCycles / QUEUE_BENCHMARK_OP_COUNT,
+           (double)popCycles / QUEUE_BENCHMARK_OP_COUNT,
+           (double)readCycles / QUEUE_BENCHMARK_OP_COUNT);
+  }
+  (void)sink;
+  queue_garbageCollect(&q);
+}
+
 #define QUEUE_TEST_MAX_QUEUE_SIZE 100 // Used for the fill/empty tests.
 #define QUEUE_TEST_MAX_LOOP_COUNT                                              \
   10 // All tests will be invoked this many times.
@@ -544,6 +1111,13 @@ bool queue_overwritePushTest(void) {
 // 5. Refill the array with the previous random values.
 // 6. Use queue_overwritePush() to write over all of the elements of the array,
 // checking the contents.
+// 7. Check the fast accessors in queue.h against the checked functions.
+// 8. Check the windows of a mirrored queue against a plain queue.
+// 9. Check the bulk operations and spans against the scalar functions.
+// 10. Check int16_t, float and double typed queues against queue_t.
+// 11. Check the error log and counters.
+// 12. Print the cost of push, pop and readElementAt with divide indexing, the
+// checked functions and the fast accessors.
 bool queue_runTest(void) {
   bool testResult = true; // Be optimistic.
   // Overall test will be executed QUEUE_TEST_MAX_LOOP_COUNT times.
@@ -641,5 +1215,46 @@ bool queue_runTest(void) {
     queue_garbageCollect(&testQ);
     free(dataArray);
   }
+  printf("=== Commencing fast-accessor test (same operations through the "
+         "checked and the fast functions) === \n");
+  if (queue_fastAccessorTest()) {
+    printf("=== Queue: fast accessors match the checked functions.\n");
+  } else {
+    printf("=== Queue: fast accessors do not match the checked functions.\n");
+    testResult = false;
+  }
+  printf("=== Commencing mirrored test (windows of a mirrored queue against a "
+         "plain queue) === \n");
+  if (queue_mirroredTest()) {
+    printf("=== Queue: mirrored windows match the plain queue.\n");
+  } else {
+    printf("=== Queue: mirrored windows do not match the plain queue.\n");
+    testResult = false;
+  }
+  printf("=== Commencing bulk test (bulk operations against the scalar "
+         "functions) === \n");
+  if (queue_bulkTest()) {
+    printf("=== Queue: bulk operations match the scalar functions.\n");
+  } else {
+    printf("=== Queue: bulk operations do not match the scalar functions.\n");
+    testResult = false;
+  }
+  printf("=== Commencing typed-queue test (int16_t, float and double typed "
+         "queues against queue_t) === \n");
+  if (queue_typedTest()) {
+    printf("=== Queue: typed queues match queue_t.\n");
+  } else {
+    printf("=== Queue: typed queues do not match queue_t.\n");
+    testResult = false;
+  }
+  printf("=== Commencing error-log test (more errors than the log holds) "
+         "=== \n");
+  if (queue_errorLogTest()) {
+    printf("=== Queue: the error log and counters are correct.\n");
+  } else {
+    printf("=== Queue: the error log or counters are wrong.\n");
+    testResult = false;
+  }
+  queue_runBenchmark();
   return testResult;
 }
@@ -24,7 +24,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "intervalTimer.h"
 #include "isr.h"
 #include "lockoutTimer.h"
+#include "queue.h"
 #include "runningModes.h"
+#include "sensors.h"
 #include "switches.h"
 #include "transmitter.h"
 #include "trigger.h"
@@ -72,6 +74,21 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define INTERRUPTS_CURRENTLY_ENABLED true
 #define INTERRUPTS_CURRENTLY_DISABLE false
 
+// Prints the calls and cycles per call of one FIR path, if it was used.
+static void runningModes_printFirPath(const char *label, uint32_t callCount,
+                                      double cyclesPerCall) {
+  char sprintfBuffer[MAX_BUFFER_SIZE];
+  if (callCount == 0)
+    return;
+  display_print(label);
+  display_print(": ");
+  display_printDecimalInt(callCount);
+  display_print(" calls, ");
+  sprintf(sprintfBuffer, "%.0f", cyclesPerCall);
+  display_print(sprintfBuffer);
+  display_print(" cycles each\n");
+}
+
 // Prints out various run-time statistics on the TFT display.
 // Assumes the following:
 // detected interrupts is retrieved with interrupts_isrInvocationCount(),
@@ -148,6 +165,44 @@ void runningModes_printRunTimeStatistics(void) {
   display_print(sprintfBuffer);
   display_print("\n\n");
 
+  // Print out FIR cost per call on each path and what the folded kernel saves.
+  filter_firStatistics_t firStatistics;
+  filter_getFirStatistics(&firStatistics);
+  runningModes_printFirPath("FIR per sample", firStatistics.sampleCallCount,
+                            firStatistics.sampleCyclesPerCall);
+  runningModes_printFirPath("FIR per block", firStatistics.blockCallCount,
+                            firStatistics.blockCyclesPerCall);
+  runningModes_printFirPath("CIC", firStatistics.cicCallCount,
+                            firStatistics.cicCyclesPerCall);
+  if (firStatistics.comparisonCount > 0) {
+    display_print("Folded FIR kernel: ");
+    sprintf(sprintfBuffer, "%.0f", firStatistics.foldedCyclesPerCall);
+    display_print(sprintfBuffer);
+    display_print(" cycles, generic: ");
+    sprintf(sprintfBuffer, "%.0f", firStatistics.genericCyclesPerCall);
+    display_print(sprintfBuffer);
+    display_print("\n");
+  }
+  display_print("\n");
+
+  // Print out the largest drift the power resync has corrected.
+  filter_powerDriftStatistics_t driftStatistics;
+  filter_getPowerDriftStatistics(&driftStatistics);
+  display_print("Power resyncs: ");
+  display_printDecimalInt(driftStatistics.resyncCount);
+  display_print(", max drift: ");
+  sprintf(sprintfBuffer, "%.2e", driftStatistics.maxRelativeDrift);
+  display_print(sprintfBuffer);
+  display_print("\n\n");
+
+  // Print out how much of the time the energy gate idled the IIR filters.
+  if (filter_getEnergyGate()) {
+    display_print("Filter idle time: ");
+    sprintf(sprintfBuffer, "%.2f", filter_getIdleFraction() * 100);
+    display_print(sprintfBuffer);
+    display_print("%\n\n");
+  }
+
   // If the detector invocation rate is too low, inform the user.
   if (detectorInvocationCount / runningSeconds <
       SUGGESTED_DETECTOR_INVOCATIONS_PER_SECOND) {
@@ -172,6 +227,9 @@ void runningModes_printRunTimeStatistics(void) {
 void runningModes_initAll(void) {
   // Assume mio, leds, buttons, switches, & display initialized previously
   histogram_init(HISTOGRAM_BAR_COUNT);
+#if INTERRUPTS_XADC_SENSOR_COUNT == 1 && defined(FILTER_CIC_IN_ISR)
+  filter_setFrontEnd(filter_cicFrontEnd_e); // isr_function() decimates.
+#endif
   filter_init();
   detector_init();
   // isr_init() should include calls to: transmitter, trigger,
@@ -181,6 +239,7 @@ void runningModes_initAll(void) {
   // Init all interrupts (but does not enable the interrupts at the devices).
   // Call last
   interrupts_initAll(false); // A true argument enables error messages
+  sensors_init(); // After interrupts_initAll(), which resets the XADC.
 }
 
 // Returns the current switch-setting
@@ -246,11 +305,13 @@ void runningModes_continuous(void) {
           powerValues); // Plot the power values on the TFT.
       histogramSystemTicks =
           0; // Reset the tick count and wait for the next update time.
+      queue_printErrors(); // Print queue errors here, not in detector().
     }
   }
   interrupts_disableArmInts();           // Stop interrupts.
   hitLedTimer_turnLedOff();              // Save power :-)
   runningModes_printRunTimeStatistics(); // Print the run-time statistics.
+  queue_printErrors();                   // Print any queue errors left.
   printf("Continuous mode terminated.\n");
 }
 
@@ -311,6 +372,7 @@ void runningModes_shooter(void) {
   interrupts_disableArmInts();           // Done with loop, disable the interrupts.
   hitLedTimer_turnLedOff();              // Save power :-)
   runningModes_printRunTimeStatistics(); // Print the run-time statistics.
+  queue_printErrors();                   // Print any queue errors.
   printf("Shooter mode terminated after detecting %d hits.\n", hitCount);
 }
 
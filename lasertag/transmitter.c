@@ -137,6 +137,12 @@ bool transmitter_running() {
 // transmitter is running, the frequency will not be updated until the
 // transmitter stops and transmitter_run() is called again.
 void transmitter_setFrequencyNumber(uint16_t frequencyNumber) {
+  if (frequencyNumber >= FILTER_FREQUENCY_COUNT) {
+    printf("transmitter_setFrequencyNumber(): frequency %d is out of range (0 "
+           "to %d).\n",
+           frequencyNumber, FILTER_FREQUENCY_COUNT - 1);
+    return;
+  }
   currentFrequency = frequencyNumber;
 }
 
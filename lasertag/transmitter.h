@@ -34,7 +34,9 @@ bool transmitter_running();
 
 // Sets the frequency number. If this function is called while the
 // transmitter is running, the frequency will not be updated until the
-// transmitter stops and transmitter_run() is called again.
+// transmitter stops and transmitter_run() is called again. Frequency numbers
+// run from 0 to FILTER_FREQUENCY_COUNT - 1 and index filter_frequencyTickTable;
+// others are rejected.
 void transmitter_setFrequencyNumber(uint16_t frequencyNumber);
 
 // Returns the current frequency setting.
@@ -0,0 +1,108 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TYPEDQUEUE_H_
+#define TYPEDQUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+// TYPED_QUEUE_DEFINE(name, type) defines name_t, a circular queue of type
+// elements, and these static inline functions for it:
+//   void name_init(q, type storage[], queue_size_t size)
+//   queue_size_t name_size(q)
+//   queue_size_t name_elementCount(q)
+//   bool name_empty(q)
+//   bool name_full(q)
+//   bool name_push(q, type value)
+//   void name_overwritePush(q, type value)
+//   type name_pop(q)
+//   type name_readElementAt(q, queue_index_t index)
+// Unlike queue_t, it stores any element type, never allocates and never
+// prints: name_init() takes caller storage of QUEUE_STORAGE_SIZE(size)
+// elements (indexes wrap with a mask, as in queue_t), so it can sit in an ISR.
+// name_push() returns false, and leaves the queue unchanged, if the queue is
+// full; name_overwritePush() drops the oldest element instead;
+// name_pop() and name_readElementAt() return 0 if there is no such element.
+// The functions take volatile pointers, so a queue shared with an ISR can be
+// declared volatile.
+#define TYPED_QUEUE_DEFINE(name, type)                                         \
+  typedef struct {                                                             \
+    volatile type *data;      /* QUEUE_STORAGE_SIZE(size) elements. */         \
+    queue_index_t indexIn;    /* Next open slot. */                            \
+    queue_index_t indexOut;   /* Oldest element. */                            \
+    queue_size_t elementCount;                                                 \
+    queue_size_t size;        /* Capacity. */                                  \
+    queue_index_t mask;       /* QUEUE_STORAGE_SIZE(size) - 1. */              \
+  } name##_t;                                                                  \
+                                                                               \
+  static inline void name##_init(volatile name##_t *q, type storage[],         \
+                                 queue_size_t size) {                          \
+    q->data = storage;                                                         \
+    q->indexIn = 0;                                                            \
+    q->indexOut = 0;                                                           \
+    q->elementCount = 0;                                                       \
+    q->size = size;                                                            \
+    q->mask = QUEUE_STORAGE_SIZE(size) - 1;                                    \
+  }                                                                            \
+                                                                               \
+  static inline queue_size_t name##_size(const volatile name##_t *q) {         \
+    return q->size;                                                            \
+  }                                                                            \
+                                                                               \
+  static inline queue_size_t name##_elementCount(const volatile name##_t *q) { \
+    return q->elementCount;                                                    \
+  }                                                                            \
+                                                                               \
+  static inline bool name##_empty(const volatile name##_t *q) {                \
+    return q->elementCount == 0;                                               \
+  }                                                                            \
+                                                                               \
+  static inline bool name##_full(const volatile name##_t *q) {                 \
+    return q->elementCount >= q->size;                                         \
+  }                                                                            \
+                                                                               \
+  static inline bool name##_push(volatile name##_t *q, type value) {          \
+    if (q->elementCount >= q->size)                                            \
+      return false;                                                            \
+    q->data[q->indexIn] = value;                                               \
+    q->indexIn = (q->indexIn + 1) & q->mask;                                   \
+    q->elementCount++;                                                         \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline void name##_overwritePush(volatile name##_t *q, type value) {  \
+    if (q->elementCount >= q->size) {                                          \
+      q->indexOut = (q->indexOut + 1) & q->mask;                               \
+      q->elementCount--;                                                       \
+    }                                                                          \
+    q->data[q->indexIn] = value;                                               \
+    q->indexIn = (q->indexIn + 1) & q->mask;                                   \
+    q->elementCount++;                                                         \
+  }                                                                            \
+                                                                               \
+  static inline type name##_pop(volatile name##_t *q) {                        \
+    if (q->elementCount == 0)                                                  \
+      return (type)0;                                                          \
+    type value = q->data[q->indexOut];                                         \
+    q->indexOut = (q->indexOut + 1) & q->mask;                                 \
+    q->elementCount--;                                                         \
+    return value;                                                              \
+  }                                                                            \
+                                                                               \
+  static inline type name##_readElementAt(const volatile name##_t *q,          \
+                                          queue_index_t index) {               \
+    if (index >= q->elementCount)                                              \
+      return (type)0;                                                          \
+    return q->data[(q->indexOut + index) & q->mask];                           \
+  }
+
+#endif /* TYPEDQUEUE_H_ */
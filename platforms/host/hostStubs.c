@@ -0,0 +1,34 @@
+// Stand-ins for the board drivers that the filter and queue tests call, so they
+// link on the host. The display draws nothing and the timers never run.
+
+#include "display.h"
+#include "hitLedTimer.h"
+#include "interrupts.h"
+#include "lockoutTimer.h"
+#include "utils.h"
+
+#define HOST_DISPLAY_WIDTH 320
+#define HOST_DISPLAY_HEIGHT 240
+
+void display_drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                      uint16_t color) {}
+void display_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {}
+void display_fillScreen(uint16_t color) {}
+void display_setCursor(int16_t x, int16_t y) {}
+void display_setTextColor(uint16_t c) {}
+void display_setTextSize(uint8_t s) {}
+void display_setRotation(uint8_t r) {}
+int16_t display_height() { return HOST_DISPLAY_HEIGHT; }
+int16_t display_width() { return HOST_DISPLAY_WIDTH; }
+size_t display_print(const char str[]) { return 0; }
+
+void utils_msDelay(long ms) {}
+
+int interrupts_enableArmInts() { return 0; }
+int interrupts_disableArmInts() { return 0; }
+
+void lockoutTimer_start() {}
+bool lockoutTimer_running() { return false; }
+
+void hitLedTimer_start() {}
@@ -0,0 +1,15 @@
+// Runs the queue and filter tests on the host. Exits with 0 if they pass.
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "filterTest.h"
+#include "queueTest.h"
+
+int main() {
+  bool success = true;
+  success &= queue_runTest();
+  success &= filter_runTest();
+  printf("Host tests %s.\n", success ? "passed" : "failed");
+  return success ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef XIL_TYPES_H_
+#define XIL_TYPES_H_
+
+// The Xilinx integer types that interrupts.h uses, for the host build of the
+// tests (see platforms/host/CMakeLists.txt).
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#endif /* XIL_TYPES_H_ */
@@ -0,0 +1,101 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host program that designs the filter tables for a plan and writes them as a
+// header (see FILTER_GENERATED_COEFFICIENTS in filter.h). Built and run by
+// lasertag/CMakeLists.txt when FILTER_PLAN is set:
+//   filterDesignTool <header> <sample rate in kHz> <decimation factor> <Hz>...
+// Exits with 1, and writes no header, if the plan is invalid or the tables miss
+// the specs in filterDesign.h.
+
+#include "filterDesign.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Every IIR filter passes this many Hz around its player frequency.
+#define BANDWIDTH_HZ 50.0
+#define FIRST_FREQUENCY_ARGUMENT 4
+
+// Prints values as a brace initializer.
+static void printValues(FILE *file, const double values[], uint16_t count) {
+  fprintf(file, "{");
+  for (uint16_t i = 0; i < count; i++) {
+    fprintf(file, "%s%.16e", (i == 0) ? "" : ", ", values[i]);
+  }
+  fprintf(file, "}");
+}
+
+static void printHeader(FILE *file, const filterDesign_plan_t *plan,
+                        const filterDesign_tables_t *tables) {
+  fprintf(file, "// Generated by tools/filterDesign/filterDesignTool.c. "
+                "Do not edit.\n");
+  fprintf(file,
+          "#ifndef FILTERCOEFFICIENTS_H_\n#define FILTERCOEFFICIENTS_H_\n\n");
+  fprintf(file, "#define FILTER_SAMPLE_FREQUENCY_IN_KHZ %g\n",
+          plan->sampleFrequencyHz / 1000.0);
+  fprintf(file, "#define FILTER_FREQUENCY_COUNT %d\n", plan->channelCount);
+  fprintf(file, "#define FILTER_FIR_DECIMATION_FACTOR %d\n",
+          plan->decimationFactor);
+  fprintf(file, "#define FILTER_INPUT_PULSE_WIDTH %u\n", tables->pulseWidth);
+  fprintf(file, "#define FILTER_FIR_COEFFICIENT_COUNT %d\n",
+          tables->firCoefficientCount);
+  fprintf(file, "#define FILTER_IIR_ORDER %d\n\n", FILTER_DESIGN_IIR_ORDER);
+
+  fprintf(file, "#define FILTER_GENERATED_TICK_TABLE {");
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    fprintf(file, "%s%d", (i == 0) ? "" : ", ", tables->tickCount[i]);
+  }
+  fprintf(file, "}\n\n#define FILTER_GENERATED_FIR_COEFFICIENTS ");
+  printValues(file, tables->fir, tables->firCoefficientCount);
+
+  fprintf(file, "\n\n#define FILTER_GENERATED_IIR_A_COEFFICIENTS {");
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    fprintf(file, "%s\\\n    ", (i == 0) ? "" : ",");
+    printValues(file, tables->iirA[i], FILTER_DESIGN_IIR_ORDER);
+  }
+  fprintf(file, "}\n\n#define FILTER_GENERATED_IIR_B_COEFFICIENTS {");
+  for (uint16_t i = 0; i < plan->channelCount; i++) {
+    fprintf(file, "%s\\\n    ", (i == 0) ? "" : ",");
+    printValues(file, tables->iirB[i], FILTER_DESIGN_IIR_ORDER + 1);
+  }
+  fprintf(file, "}\n\n#endif /* FILTERCOEFFICIENTS_H_ */\n");
+}
+
+int main(int argc, char *argv[]) {
+  if (argc <= FIRST_FREQUENCY_ARGUMENT ||
+      argc - FIRST_FREQUENCY_ARGUMENT > FILTER_DESIGN_MAX_CHANNEL_COUNT) {
+    printf("usage: %s <header> <sample rate in kHz> <decimation factor> <1 to "
+           "%d player frequencies in Hz>\n",
+           argv[0], FILTER_DESIGN_MAX_CHANNEL_COUNT);
+    return 1;
+  }
+  filterDesign_plan_t plan;
+  plan.sampleFrequencyHz = atof(argv[2]) * 1000.0;
+  plan.decimationFactor = atoi(argv[3]);
+  plan.channelCount = argc - FIRST_FREQUENCY_ARGUMENT;
+  for (uint16_t i = 0; i < plan.channelCount; i++) {
+    plan.channelFrequencyHz[i] = atof(argv[FIRST_FREQUENCY_ARGUMENT + i]);
+  }
+  plan.bandwidthHz = BANDWIDTH_HZ;
+
+  static filterDesign_tables_t tables;
+  if (!filterDesign_design(&plan, &tables) ||
+      !filterDesign_check(&plan, &tables, true)) {
+    printf("%s: the plan does not meet the filter specs.\n", argv[0]);
+    return 1;
+  }
+  FILE *file = fopen(argv[1], "w");
+  if (file == NULL) {
+    printf("%s: cannot write %s.\n", argv[0], argv[1]);
+    return 1;
+  }
+  printHeader(file, &plan, &tables);
+  fclose(file);
+  return 0;
+}